@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ast
+{
+    // List of child nodes, its storage comes from the arena of the program the nodes belong to
+    template <class T>
+    using NodeList = std::pmr::vector<T *>;
+
+    // Bump allocator the nodes of a program are created in. Memory is handed out in growing blocks
+    // and released all at once when the arena is destroyed, nodes are never destroyed one by one.
+    // Nodes made by an arena must therefore not own anything outside of it.
+    class Arena
+    {
+    public:
+        static constexpr size_t INITIAL_BLOCK_SIZE = 4 * 1024;
+
+        Arena() : resource{INITIAL_BLOCK_SIZE}
+        {
+        }
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        // Constructs a T in the arena
+        template <class T, class... Args>
+        T *make(Args &&...args)
+        {
+            return new (resource.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Returns an empty node list that grows inside the arena
+        template <class T>
+        NodeList<T> list()
+        {
+            return NodeList<T>(&resource);
+        }
+
+        // Copies text into the arena, for literals of nodes that are made after the source was parsed
+        std::string_view copy(std::string_view text)
+        {
+            auto *copied = static_cast<char *>(resource.allocate(text.size(), alignof(char)));
+            std::copy(text.begin(), text.end(), copied);
+            return std::string_view(copied, text.size());
+        }
+
+        std::pmr::memory_resource *memoryResource()
+        {
+            return &resource;
+        }
+
+    private:
+        std::pmr::monotonic_buffer_resource resource;
+    };
+}
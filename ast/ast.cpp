@@ -5,7 +5,7 @@ using namespace ast;
 
 // Pushes elements of the given array to the string stream buffer with elements being seperated with commas
 template <class T>
-void pushElementsToBuffer(std::ostringstream &oss, const std::vector<T *> &arr)
+void pushElementsToBuffer(std::ostringstream &oss, const NodeList<T> &arr)
 {
     oss << "(";
     for (size_t i = 0; i < arr.size(); ++i)
@@ -120,6 +120,22 @@ std::string ast::BlockStatement::toString() const
     return oss.str();
 }
 
+uint32_t FunctionLiteral::slotOf(token::Symbol name) const
+{
+    for (const NodeList<Identifier> *names : {&parameters, &locals})
+    {
+        for (const Identifier *identifier : *names)
+        {
+            if (identifier->symbol == name)
+            {
+                return identifier->slot;
+            }
+        }
+    }
+
+    return NO_SLOT;
+}
+
 std::string FunctionLiteral::toString() const
 {
     std::ostringstream oss;
@@ -1,15 +1,49 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
-#include <vector>
+#include <string_view>
+#include "arena.hpp"
+#include "operator.hpp"
 #include "token.hpp"
 
+namespace object
+{
+    class Object;
+}
+
 namespace ast
 {
+    // Concrete type of a node, passes over the tree switch on it instead of trying casts one after another
+    enum class NodeKind : uint8_t
+    {
+        PROGRAM,
+        IDENTIFIER,
+        VAR_STATEMENT,
+        RETURN_STATEMENT,
+        EXPRESSION_STATEMENT,
+        INTEGER_LITERAL,
+        PREFIX_EXPRESSION,
+        INFIX_EXPRESSION,
+        BOOLEAN,
+        BLOCK_STATEMENT,
+        IF_EXPRESSION,
+        FUNCTION_LITERAL,
+        CALL_EXPRESSION,
+    };
+
     // Base class for a node in AST
     class Node
     {
     public:
+        const NodeKind kind;
+
+        explicit Node(NodeKind nodeKind) : kind{nodeKind}
+        {
+        }
+
         virtual std::string tokenLiteral() const = 0;
         virtual std::string toString() const = 0;
         virtual ~Node() = default;
@@ -19,6 +53,8 @@ namespace ast
     class Statement : public Node
     {
     public:
+        using Node::Node;
+
         virtual void statementNode() const = 0;
     };
 
@@ -26,21 +62,33 @@ namespace ast
     class Expression : public Node
     {
     public:
+        using Node::Node;
+
         virtual void expressionNode() const = 0;
     };
 
     // Program node is the root node of AST. Every statement produced is stored in this node.
+    // Deleting the program frees every node in it at once by releasing the arena they were made in.
     class Program : public Node
     {
     public:
-        std::vector<Statement *> statements;
+        // Arena every node of the program lives in, shared with the parser that builds it
+        std::shared_ptr<Arena> arena;
+        NodeList<Statement> statements;
 
-        ~Program() override
+        // Keeps the source buffer alive, token literals of every node in the program point into it
+        std::shared_ptr<const void> source;
+
+        // Set once the resolver has annotated the variables of the program
+        bool resolved = false;
+
+        Program() : Program(std::make_shared<Arena>())
+        {
+        }
+
+        explicit Program(std::shared_ptr<Arena> nodeArena)
+            : Node(NodeKind::PROGRAM), arena{std::move(nodeArena)}, statements{arena->list<Statement>()}
         {
-            for (auto stmt : statements)
-            {
-                delete stmt;
-            }
         }
 
         std::string tokenLiteral() const override;
@@ -51,21 +99,54 @@ namespace ast
         std::string toString() const override;
     };
 
+    // Depth of an identifier the resolver hasn't seen, it is looked up by its symbol
+    constexpr uint32_t UNRESOLVED_DEPTH = std::numeric_limits<uint32_t>::max();
+
+    // Depth of an identifier no enclosing function declares, it is looked up in the global environment
+    constexpr uint32_t GLOBAL_DEPTH = UNRESOLVED_DEPTH - 1;
+
+    // Slot of a name a function doesn't declare
+    constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
     // Identifier node that holds the corresponding token and value of the identifier.
+    // The value is the name of the identifier's interned symbol, environments are keyed by the symbol.
     class Identifier : public Expression
     {
     public:
         token::Token token;
-        std::string value;
+        token::Symbol symbol;
+        std::string_view value;
 
-        Identifier() = default;
-        Identifier(token::Token tkn, std::string val) : token{tkn}, value{val}
+        // Where the resolver found the variable: the number of function calls out from the one the identifier is
+        // evaluated in and the slot in that call's environment. Parameters and var statement names get depth 0.
+        uint32_t depth = UNRESOLVED_DEPTH;
+        uint32_t slot = NO_SLOT;
+
+        // Inline cache of the evaluator: the value the variable was last read as, valid while the identifier is read
+        // through the environment with the id cacheKey, 0 while nothing is cached. See evaluator::evaluateIdentifier.
+        uint64_t cacheKey = 0;
+        object::Object *cachedValue = nullptr;
+
+        Identifier() : Expression(NodeKind::IDENTIFIER)
+        {
+        }
+
+        // Identifier for a token the lexer has already interned
+        Identifier(token::Token tkn)
+            : Expression(NodeKind::IDENTIFIER),
+              token{tkn}, symbol{tkn.symbol}, value{token::symbolName(tkn.symbol)}
+        {
+        }
+
+        Identifier(token::Token tkn, std::string_view val)
+            : Expression(NodeKind::IDENTIFIER),
+              token{tkn}, symbol{token::intern(val)}, value{token::symbolName(symbol)}
         {
         }
 
         void expressionNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
-        std::string toString() const override { return value; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
+        std::string toString() const override { return std::string(value); };
     };
 
     // Var statement that has a tokentype of TokenType::Var and points to the identifier and expression in the statement.
@@ -76,20 +157,16 @@ namespace ast
         Identifier *name;
         Expression *expression;
 
-        VarStatement() = default;
-        VarStatement(token::Token tkn, Identifier *ident, Expression *expression)
-            : token{tkn}, name{ident}, expression{expression}
+        VarStatement() : Statement(NodeKind::VAR_STATEMENT)
         {
         }
-
-        ~VarStatement() override
+        VarStatement(token::Token tkn, Identifier *ident, Expression *expression)
+            : Statement(NodeKind::VAR_STATEMENT), token{tkn}, name{ident}, expression{expression}
         {
-            delete name;
-            delete expression;
         }
 
         void statementNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Returns the var statement as a string in a format of "identifier name = expression;"
         // Helpful function for debugging and comparing to other statements
@@ -102,19 +179,16 @@ namespace ast
         token::Token token;
         Expression *returnValue;
 
-        ReturnStatement() = default;
-        ReturnStatement(token::Token tkn, Expression *expression)
-            : token{token}, returnValue{expression}
+        ReturnStatement() : Statement(NodeKind::RETURN_STATEMENT)
         {
         }
-
-        ~ReturnStatement() override
+        ReturnStatement(token::Token tkn, Expression *expression)
+            : Statement(NodeKind::RETURN_STATEMENT), token{tkn}, returnValue{expression}
         {
-            delete returnValue;
         }
 
         void statementNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Returns the return statement in a format of "return expression;"
         // Helpful function for debugging and comparing to other statements
@@ -127,19 +201,16 @@ namespace ast
         token::Token token;
         Expression *expression;
 
-        ExpressionStatement() = default;
-        ExpressionStatement(token::Token tkn, Expression *expression)
-            : token{token}, expression{expression}
+        ExpressionStatement() : Statement(NodeKind::EXPRESSION_STATEMENT)
         {
         }
-
-        ~ExpressionStatement() override
+        ExpressionStatement(token::Token tkn, Expression *expression)
+            : Statement(NodeKind::EXPRESSION_STATEMENT), token{tkn}, expression{expression}
         {
-            delete expression;
         }
 
         void statementNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Returns the expression as a string
         std::string toString() const override;
@@ -151,35 +222,38 @@ namespace ast
         token::Token token;
         int64_t value;
 
-        IntegerLiteral() = default;
-        IntegerLiteral(token::Token tkn, int64_t val) : token{tkn}, value{val}
+        IntegerLiteral() : Expression(NodeKind::INTEGER_LITERAL)
+        {
+        }
+        IntegerLiteral(token::Token tkn, int64_t val)
+            : Expression(NodeKind::INTEGER_LITERAL), token{tkn}, value{val}
         {
         }
 
         void expressionNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Return the integer as string
-        std::string toString() const override { return token.literal; };
+        std::string toString() const override { return std::string(token.literal); };
     };
 
     class PrefixExpression : public Expression
     {
     public:
         token::Token token;
-        std::string op;
+        Operator op;
         Expression *right;
 
-        PrefixExpression() = default;
-        PrefixExpression(token::Token tkn, std::string prefixOperator, Expression *rightExpression)
-            : token{tkn}, op{prefixOperator}, right{rightExpression}
+        PrefixExpression() : Expression(NodeKind::PREFIX_EXPRESSION)
+        {
+        }
+        PrefixExpression(token::Token tkn, Operator prefixOperator, Expression *rightExpression)
+            : Expression(NodeKind::PREFIX_EXPRESSION), token{tkn}, op{prefixOperator}, right{rightExpression}
         {
         }
-
-        ~PrefixExpression() override { delete right; };
 
         void expressionNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Returns the expression in a format of (<prefixOperator><expression>) in string
         std::string toString() const override;
@@ -190,26 +264,23 @@ namespace ast
     public:
         token::Token token;
         Expression *left;
-        std::string op;
+        Operator op;
         Expression *right;
 
-        InfixExpression() = default;
+        InfixExpression() : Expression(NodeKind::INFIX_EXPRESSION)
+        {
+        }
         InfixExpression(token::Token tkn,
                         Expression *leftExpression,
-                        std::string infixOp,
+                        Operator infixOp,
                         Expression *rightExpression)
-            : token{tkn}, left{leftExpression}, op{infixOp}, right{rightExpression}
-        {
-        }
-
-        ~InfixExpression() override
+            : Expression(NodeKind::INFIX_EXPRESSION),
+              token{tkn}, left{leftExpression}, op{infixOp}, right{rightExpression}
         {
-            delete left;
-            delete right;
         }
 
         void expressionNode() const override {};
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Returns the expression in a format of (<expression><operator><expression>) in string
         std::string toString() const override;
@@ -221,40 +292,34 @@ namespace ast
         token::Token token;
         bool value;
 
-        Boolean() = default;
-        Boolean(token::Token tkn, bool val) : token{tkn}, value{val}
+        Boolean() : Expression(NodeKind::BOOLEAN)
+        {
+        }
+        Boolean(token::Token tkn, bool val) : Expression(NodeKind::BOOLEAN), token{tkn}, value{val}
         {
         }
 
         void expressionNode() const override {};
 
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
-        std::string toString() const override { return token.literal; };
+        std::string toString() const override { return std::string(token.literal); };
     };
 
     class BlockStatement : public Statement
     {
     public:
         token::Token token;
-        std::vector<Statement *> statements;
-
-        BlockStatement() = default;
-        BlockStatement(token::Token tkn, std::vector<Statement *> stmts) : token{tkn}, statements{stmts}
-        {
-        }
+        NodeList<Statement> statements;
 
-        ~BlockStatement()
+        BlockStatement(token::Token tkn, NodeList<Statement> stmts)
+            : Statement(NodeKind::BLOCK_STATEMENT), token{tkn}, statements{std::move(stmts)}
         {
-            for (auto *stmt : statements)
-            {
-                delete stmt;
-            }
         }
 
         void statementNode() const override {};
 
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         std::string toString() const override;
     };
@@ -267,25 +332,21 @@ namespace ast
         BlockStatement *consequence;
         BlockStatement *alternative;
 
-        IfExpression() = default;
+        IfExpression() : Expression(NodeKind::IF_EXPRESSION)
+        {
+        }
         IfExpression(token::Token tkn,
                      Expression *condition,
                      BlockStatement *conseq,
                      BlockStatement *alt)
-            : token{tkn}, condition{condition}, consequence{conseq}, alternative{alt}
+            : Expression(NodeKind::IF_EXPRESSION),
+              token{tkn}, condition{condition}, consequence{conseq}, alternative{alt}
         {
         }
 
-        ~IfExpression() override
-        {
-            delete condition;
-            delete consequence;
-            delete alternative;
-        }
-
         void expressionNode() const override {};
 
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Returns the if expression in a format if (<condition>) <consequence> else <alternative> in a string
         std::string toString() const override;
@@ -295,30 +356,29 @@ namespace ast
     {
     public:
         token::Token token;
-        std::vector<Identifier *> parameters;
+        NodeList<Identifier> parameters;
         BlockStatement *body;
 
-        FunctionLiteral() = default;
+        // Filled in by the resolver. A call of the function has a slot for every distinct name among the parameters
+        // and the var statements of its body, locals holds the first var statement name of each that isn't a parameter.
+        NodeList<Identifier> locals;
+        uint32_t slotCount = 0;
+        bool resolved = false;
+
         FunctionLiteral(token::Token tkn,
-                        std::vector<Identifier *> parameters,
+                        NodeList<Identifier> parameters,
                         BlockStatement *body)
-            : token{tkn}, parameters{parameters}, body{body}
+            : Expression(NodeKind::FUNCTION_LITERAL),
+              token{tkn}, parameters{std::move(parameters)}, body{body}, locals{this->parameters.get_allocator()}
         {
         }
 
-        ~FunctionLiteral()
-        {
-            for (auto *param : parameters)
-            {
-                delete param;
-            }
-
-            delete body;
-        }
+        // Returns the slot of the parameter or local with the given name, NO_SLOT if the function declares none
+        uint32_t slotOf(token::Symbol name) const;
 
         void expressionNode() const override {};
 
-        std::string tokenLiteral() const override { return token.literal; };
+        std::string tokenLiteral() const override { return std::string(token.literal); };
 
         // Return the function literal in a format funksion <parameters> <function body>
         std::string toString() const override;
@@ -329,17 +389,16 @@ namespace ast
     public:
         token::Token token;
         Expression *function;
-        std::vector<Expression *> arguments;
+        NodeList<Expression> arguments;
 
-        CallExpression() = default;
-        CallExpression(token::Token tkn, Expression *func, std::vector<Expression *> args)
-            : token{tkn}, function{func}, arguments{args}
+        CallExpression(token::Token tkn, Expression *func, NodeList<Expression> args)
+            : Expression(NodeKind::CALL_EXPRESSION), token{tkn}, function{func}, arguments{std::move(args)}
         {
         }
 
         void expressionNode() const override{};
 
-        std::string tokenLiteral() const override {return token.literal;};
+        std::string tokenLiteral() const override { return std::string(token.literal); };
         
         // Returns the call expression in a format <expression>(<comma seperated arguments>) in a string
         std::string toString() const override;
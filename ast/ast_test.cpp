@@ -6,14 +6,17 @@
 void testString()
 {
     // var myVar = anotherVar;
-    auto varStatement = ast::VarStatement(
-        {token::VAR, "var"},
-        new ast::Identifier({token::IDENT, "myVar"}, "myVar"),
-        new ast::Identifier({token::IDENT, "anotherVar"}, "anotherVar"));
     auto *program = new ast::Program();
-    program->statements.push_back(dynamic_cast<ast::Statement *>(&varStatement));
+    ast::Arena &arena = *program->arena;
+    auto *varStatement = arena.make<ast::VarStatement>(
+        token::Token{token::VAR, "var"},
+        arena.make<ast::Identifier>(token::Token{token::IDENT, "myVar"}, "myVar"),
+        arena.make<ast::Identifier>(token::Token{token::IDENT, "anotherVar"}, "anotherVar"));
+    program->statements.push_back(varStatement);
 
     assert(program->toString() == "var myVar = anotherVar;" && "program.toString() wrong!");
+
+    delete program;
 }
 
 int main()
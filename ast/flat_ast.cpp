@@ -0,0 +1,411 @@
+#include "flat_ast.hpp"
+
+using namespace ast;
+
+namespace
+{
+    // Returns the token of the given type spelled the way the lexer would have read it
+    token::Token spelledToken(token::TokenType type)
+    {
+        for (const token::Keyword &keyword : token::keywords)
+        {
+            if (keyword.type == type)
+            {
+                return {type, keyword.literal};
+            }
+        }
+
+        return {type, token::toString(type)};
+    }
+
+    class Flattener
+    {
+    public:
+        FlatProgram flat;
+
+        NodeIndex add(FlatKind kind, token::TokenType op = token::ILLEGAL)
+        {
+            flat.nodes.push_back({kind, op, NO_NODE, NO_NODE, NO_NODE});
+            return static_cast<NodeIndex>(flat.nodes.size() - 1);
+        }
+
+        // Flattens the list and returns where it starts in flat.lists. Nested lists are flattened first,
+        // so the list is collected before it is appended to stay contiguous.
+        template <class T>
+        NodeIndex flattenList(const NodeList<T> &list)
+        {
+            std::vector<NodeIndex> indices;
+            indices.reserve(list.size());
+            for (T *node : list)
+            {
+                indices.push_back(flattenNode(node));
+            }
+
+            const NodeIndex first = static_cast<NodeIndex>(flat.lists.size());
+            flat.lists.insert(flat.lists.end(), indices.begin(), indices.end());
+            return first;
+        }
+
+        NodeIndex flattenBlock(const NodeList<Statement> &statements)
+        {
+            const NodeIndex index = add(FlatKind::BLOCK);
+            const NodeIndex first = flattenList(statements);
+            flat.nodes[index].a = first;
+            flat.nodes[index].b = static_cast<NodeIndex>(statements.size());
+            return index;
+        }
+
+        NodeIndex flattenNode(const Node *node)
+        {
+            if (!node)
+            {
+                return NO_NODE;
+            }
+
+            // Children are flattened after their parent was added, which lays the nodes out in pre-order.
+            // flat.nodes may grow while a child is flattened, so parents are written back through their index.
+            if (auto *statement = dynamic_cast<const VarStatement *>(node))
+            {
+                const NodeIndex index = add(FlatKind::VAR);
+                const NodeIndex value = flattenNode(statement->expression);
+                flat.nodes[index].a = statement->name->symbol;
+                flat.nodes[index].b = value;
+                return index;
+            }
+            else if (auto *statement = dynamic_cast<const ReturnStatement *>(node))
+            {
+                const NodeIndex index = add(FlatKind::RETURN);
+                const NodeIndex value = flattenNode(statement->returnValue);
+                flat.nodes[index].a = value;
+                return index;
+            }
+            else if (auto *statement = dynamic_cast<const ExpressionStatement *>(node))
+            {
+                const NodeIndex index = add(FlatKind::EXPRESSION);
+                const NodeIndex expression = flattenNode(statement->expression);
+                flat.nodes[index].a = expression;
+                return index;
+            }
+            else if (auto *block = dynamic_cast<const BlockStatement *>(node))
+            {
+                return flattenBlock(block->statements);
+            }
+            else if (auto *identifier = dynamic_cast<const Identifier *>(node))
+            {
+                const NodeIndex index = add(FlatKind::IDENTIFIER);
+                flat.nodes[index].a = identifier->symbol;
+                return index;
+            }
+            else if (auto *integer = dynamic_cast<const IntegerLiteral *>(node))
+            {
+                const NodeIndex index = add(FlatKind::INTEGER);
+                flat.nodes[index].a = static_cast<NodeIndex>(flat.integers.size());
+                flat.integers.push_back({integer->value, integer->token.literal});
+                return index;
+            }
+            else if (auto *boolean = dynamic_cast<const Boolean *>(node))
+            {
+                const NodeIndex index = add(FlatKind::BOOLEAN);
+                flat.nodes[index].a = boolean->value ? 1 : 0;
+                return index;
+            }
+            else if (auto *prefix = dynamic_cast<const PrefixExpression *>(node))
+            {
+                const NodeIndex index = add(FlatKind::PREFIX, prefix->token.type);
+                const NodeIndex right = flattenNode(prefix->right);
+                flat.nodes[index].a = right;
+                return index;
+            }
+            else if (auto *infix = dynamic_cast<const InfixExpression *>(node))
+            {
+                const NodeIndex index = add(FlatKind::INFIX, infix->token.type);
+                const NodeIndex left = flattenNode(infix->left);
+                const NodeIndex right = flattenNode(infix->right);
+                flat.nodes[index].a = left;
+                flat.nodes[index].b = right;
+                return index;
+            }
+            else if (auto *ifExpression = dynamic_cast<const IfExpression *>(node))
+            {
+                const NodeIndex index = add(FlatKind::IF);
+                const NodeIndex condition = flattenNode(ifExpression->condition);
+                const NodeIndex consequence = flattenNode(ifExpression->consequence);
+                const NodeIndex alternative = flattenNode(ifExpression->alternative);
+                flat.nodes[index].a = condition;
+                flat.nodes[index].b = consequence;
+                flat.nodes[index].c = alternative;
+                return index;
+            }
+            else if (auto *function = dynamic_cast<const FunctionLiteral *>(node))
+            {
+                const NodeIndex index = add(FlatKind::FUNCTION);
+                const NodeIndex first = flattenList(function->parameters);
+                const NodeIndex body = flattenNode(function->body);
+                flat.nodes[index].a = first;
+                flat.nodes[index].b = static_cast<NodeIndex>(function->parameters.size());
+                flat.nodes[index].c = body;
+                return index;
+            }
+            else if (auto *call = dynamic_cast<const CallExpression *>(node))
+            {
+                const NodeIndex index = add(FlatKind::CALL);
+                const NodeIndex function = flattenNode(call->function);
+                const NodeIndex first = flattenList(call->arguments);
+                flat.nodes[index].a = function;
+                flat.nodes[index].b = first;
+                flat.nodes[index].c = static_cast<NodeIndex>(call->arguments.size());
+                return index;
+            }
+
+            return NO_NODE;
+        }
+    };
+
+    class Unflattener
+    {
+    public:
+        const FlatProgram &flat;
+        Arena &arena;
+
+        template <class T>
+        T *as(NodeIndex index)
+        {
+            return static_cast<T *>(unflattenNode(index));
+        }
+
+        template <class T>
+        NodeList<T> unflattenList(NodeIndex first, NodeIndex count)
+        {
+            NodeList<T> list = arena.list<T>();
+            list.reserve(count);
+            for (NodeIndex i = 0; i < count; ++i)
+            {
+                list.push_back(as<T>(flat.lists[first + i]));
+            }
+
+            return list;
+        }
+
+        Identifier *identifier(token::Symbol symbol)
+        {
+            return arena.make<Identifier>(token::Token{token::IDENT, token::symbolName(symbol), symbol});
+        }
+
+        Node *unflattenNode(NodeIndex index)
+        {
+            if (index == NO_NODE)
+            {
+                return nullptr;
+            }
+
+            const FlatNode &node = flat[index];
+            switch (node.kind)
+            {
+            case FlatKind::VAR:
+                return arena.make<VarStatement>(spelledToken(token::VAR), identifier(node.a), as<Expression>(node.b));
+            case FlatKind::RETURN:
+                return arena.make<ReturnStatement>(spelledToken(token::RETURN), as<Expression>(node.a));
+            case FlatKind::EXPRESSION:
+            {
+                Expression *expression = as<Expression>(node.a);
+                const token::Token first = node.a == NO_NODE ? token::Token{token::ILLEGAL, {}} : firstToken(node.a);
+                return arena.make<ExpressionStatement>(first, expression);
+            }
+            case FlatKind::BLOCK:
+                return arena.make<BlockStatement>(spelledToken(token::LBRACE), unflattenList<Statement>(node.a, node.b));
+            case FlatKind::IDENTIFIER:
+                return identifier(node.a);
+            case FlatKind::INTEGER:
+            {
+                const IntegerConstant &integer = flat.integers[node.a];
+                return arena.make<IntegerLiteral>(token::Token{token::INT, integer.literal}, integer.value);
+            }
+            case FlatKind::BOOLEAN:
+                return arena.make<Boolean>(spelledToken(node.a ? token::TRUE : token::FALSE), node.a != 0);
+            case FlatKind::PREFIX:
+            {
+                const token::Token op = spelledToken(node.op);
+                return arena.make<PrefixExpression>(op, operatorOf(op.type), as<Expression>(node.a));
+            }
+            case FlatKind::INFIX:
+            {
+                const token::Token op = spelledToken(node.op);
+                return arena.make<InfixExpression>(op, as<Expression>(node.a), operatorOf(op.type),
+                                                   as<Expression>(node.b));
+            }
+            case FlatKind::IF:
+                return arena.make<IfExpression>(spelledToken(token::IF),
+                                                as<Expression>(node.a),
+                                                as<BlockStatement>(node.b),
+                                                as<BlockStatement>(node.c));
+            case FlatKind::FUNCTION:
+                return arena.make<FunctionLiteral>(spelledToken(token::FUNCTION),
+                                                   unflattenList<Identifier>(node.a, node.b),
+                                                   as<BlockStatement>(node.c));
+            case FlatKind::CALL:
+                return arena.make<CallExpression>(spelledToken(token::LPAREN),
+                                                  as<Expression>(node.a),
+                                                  unflattenList<Expression>(node.b, node.c));
+            }
+
+            return nullptr;
+        }
+
+        // Returns the token the parser started the expression statement with, the leftmost token of the expression
+        token::Token firstToken(NodeIndex index)
+        {
+            const FlatNode &node = flat[index];
+            switch (node.kind)
+            {
+            case FlatKind::IDENTIFIER:
+                return {token::IDENT, token::symbolName(node.a), node.a};
+            case FlatKind::INTEGER:
+                return {token::INT, flat.integers[node.a].literal};
+            case FlatKind::BOOLEAN:
+                return spelledToken(node.a ? token::TRUE : token::FALSE);
+            case FlatKind::PREFIX:
+                return spelledToken(node.op);
+            case FlatKind::INFIX:
+                return node.a == NO_NODE ? spelledToken(node.op) : firstToken(node.a);
+            case FlatKind::CALL:
+                return node.a == NO_NODE ? spelledToken(token::LPAREN) : firstToken(node.a);
+            case FlatKind::IF:
+                return spelledToken(token::IF);
+            case FlatKind::FUNCTION:
+                return spelledToken(token::FUNCTION);
+            default:
+                return {token::ILLEGAL, {}};
+            }
+        }
+    };
+}
+
+std::string FlatProgram::toString() const
+{
+    return toString(root);
+}
+
+std::string FlatProgram::toString(NodeIndex index) const
+{
+    std::string out;
+    write(out, index);
+    return out;
+}
+
+void FlatProgram::write(std::string &out, NodeIndex index) const
+{
+    if (index == NO_NODE)
+    {
+        return;
+    }
+
+    const FlatNode &node = nodes[index];
+    switch (node.kind)
+    {
+    case FlatKind::VAR:
+        out += spelledToken(token::VAR).literal;
+        out += " ";
+        out += token::symbolName(node.a);
+        out += " = ";
+        write(out, node.b);
+        out += ";";
+        break;
+    case FlatKind::RETURN:
+        out += spelledToken(token::RETURN).literal;
+        out += " ";
+        write(out, node.a);
+        out += ";";
+        break;
+    case FlatKind::EXPRESSION:
+        write(out, node.a);
+        break;
+    case FlatKind::BLOCK:
+        writeList(out, node.a, node.b, "");
+        break;
+    case FlatKind::IDENTIFIER:
+        out += token::symbolName(node.a);
+        break;
+    case FlatKind::INTEGER:
+        out += integers[node.a].literal;
+        break;
+    case FlatKind::BOOLEAN:
+        out += spelledToken(node.a ? token::TRUE : token::FALSE).literal;
+        break;
+    case FlatKind::PREFIX:
+        out += "(";
+        out += token::toString(node.op);
+        write(out, node.a);
+        out += ")";
+        break;
+    case FlatKind::INFIX:
+        out += "(";
+        write(out, node.a);
+        out += " ";
+        out += token::toString(node.op);
+        out += " ";
+        write(out, node.b);
+        out += ")";
+        break;
+    case FlatKind::IF:
+        out += "nese";
+        write(out, node.a);
+        out += " ";
+        write(out, node.b);
+        if (node.c != NO_NODE)
+        {
+            out += "perndryshe";
+            write(out, node.c);
+        }
+        break;
+    case FlatKind::FUNCTION:
+        out += spelledToken(token::FUNCTION).literal;
+        out += "(";
+        writeList(out, node.a, node.b, ", ");
+        out += ")";
+        write(out, node.c);
+        break;
+    case FlatKind::CALL:
+        write(out, node.a);
+        out += "(";
+        writeList(out, node.b, node.c, ", ");
+        out += ")";
+        break;
+    }
+}
+
+void FlatProgram::writeList(std::string &out, NodeIndex first, NodeIndex count, std::string_view separator) const
+{
+    for (NodeIndex i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            out += separator;
+        }
+
+        write(out, lists[first + i]);
+    }
+}
+
+FlatProgram ast::flatten(const Program &program)
+{
+    Flattener flattener;
+    flattener.flat.source = program.source;
+    flattener.flat.root = flattener.flattenBlock(program.statements);
+
+    return std::move(flattener.flat);
+}
+
+Program *ast::unflatten(const FlatProgram &flat)
+{
+    auto *program = new Program();
+    program->source = flat.source;
+
+    if (flat.root != NO_NODE)
+    {
+        const FlatNode &root = flat[flat.root];
+        Unflattener unflattener{flat, *program->arena};
+        program->statements = unflattener.unflattenList<Statement>(root.a, root.b);
+    }
+
+    return program;
+}
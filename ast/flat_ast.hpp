@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+#include "token.hpp"
+
+namespace ast
+{
+    // Index of a node in FlatProgram::nodes
+    using NodeIndex = uint32_t;
+
+    // Marks a missing child, an if without an alternative or an expression the parser gave up on
+    constexpr NodeIndex NO_NODE = std::numeric_limits<NodeIndex>::max();
+
+    // Kind of a flat node, decides what its a, b and c fields hold
+    enum class FlatKind : uint8_t
+    {
+        VAR,        // a: symbol of the name, b: value
+        RETURN,     // a: returned value
+        EXPRESSION, // a: expression of the expression statement
+        BLOCK,      // a: first statement in lists, b: statement count
+        IDENTIFIER, // a: symbol
+        INTEGER,    // a: index in integers
+        BOOLEAN,    // a: 1 for vertet, 0 for falso
+        PREFIX,     // op: operator, a: right operand
+        INFIX,      // op: operator, a: left operand, b: right operand
+        IF,         // a: condition, b: consequence block, c: alternative block
+        FUNCTION,   // a: first parameter in lists, b: parameter count, c: body block
+        CALL,       // a: called function, b: first argument in lists, c: argument count
+    };
+
+    // A node of the flat AST, 16 bytes no matter its kind
+    struct FlatNode
+    {
+        FlatKind kind;
+        token::TokenType op; // Operator of prefix and infix nodes, the token type interns its spelling
+        NodeIndex a;
+        NodeIndex b;
+        NodeIndex c;
+    };
+
+    struct IntegerConstant
+    {
+        int64_t value;
+        std::string_view literal; // Spelling in the source, toString prints it as written
+    };
+
+    // A program stored as contiguous arrays instead of a pointer tree. Nodes refer to their children by index
+    // and are laid out in pre-order, so walking the program in evaluation order reads the arrays front to back.
+    class FlatProgram
+    {
+    public:
+        std::vector<FlatNode> nodes;
+        std::vector<NodeIndex> lists;          // Statement, parameter and argument lists, nodes refer to a range
+        std::vector<IntegerConstant> integers; // Values of the INTEGER nodes
+        NodeIndex root = NO_NODE;              // BLOCK holding the statements of the program
+
+        // Keeps the source buffer alive, integer literals point into it
+        std::shared_ptr<const void> source;
+
+        const FlatNode &operator[](NodeIndex index) const { return nodes[index]; }
+
+        // Returns the same string as Program::toString of the program this was flattened from
+        std::string toString() const;
+
+        // Returns the given node in the format of the toString method of its pointer tree counterpart
+        std::string toString(NodeIndex index) const;
+
+    private:
+        void write(std::string &out, NodeIndex index) const;
+        void writeList(std::string &out, NodeIndex first, NodeIndex count, std::string_view separator) const;
+    };
+
+    // Copies a parsed program into a flat program
+    FlatProgram flatten(const Program &program);
+
+    // Rebuilds the pointer tree of a flat program in a new arena. Tokens are recreated from the node kinds,
+    // identifier and integer literals keep pointing to where the flat program's literals point.
+    Program *unflatten(const FlatProgram &flat);
+}
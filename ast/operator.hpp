@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include "token.hpp"
+
+namespace ast
+{
+    // Operator of a prefix or infix expression, resolved from its token once while parsing
+    enum class Operator : uint8_t
+    {
+        PLUS,
+        MINUS,
+        MULTIPLY,
+        DIVIDE,
+        NOT,
+        LESS,
+        GREATER,
+        EQUAL,
+        NOT_EQUAL,
+        LESS_EQUAL,
+        GREATER_EQUAL,
+
+        NONE, // A token type that doesn't spell an operator
+    };
+
+    // Number of operators, NONE excluded, tables indexed by operator have this many entries
+    constexpr size_t OPERATOR_COUNT = static_cast<size_t>(Operator::NONE);
+
+    // Spelling of every operator, indexed by the operator
+    constexpr std::array<std::string_view, OPERATOR_COUNT + 1> operatorSymbols{
+        "+", "-", "*", "/", "!", "<", ">", "==", "!=", "<=", ">=", ""};
+
+    // Returns the operator as it is written in the source
+    constexpr std::string_view toString(Operator op)
+    {
+        return operatorSymbols[static_cast<size_t>(op)];
+    }
+
+    // Returns the operator the token type spells, or NONE for any other token type
+    constexpr Operator operatorOf(token::TokenType type)
+    {
+        switch (type)
+        {
+        case token::PLUS:
+            return Operator::PLUS;
+        case token::MINUS:
+            return Operator::MINUS;
+        case token::ASTERISK:
+            return Operator::MULTIPLY;
+        case token::SLASH:
+            return Operator::DIVIDE;
+        case token::BANG:
+            return Operator::NOT;
+        case token::LT:
+            return Operator::LESS;
+        case token::GT:
+            return Operator::GREATER;
+        case token::EQ:
+            return Operator::EQUAL;
+        case token::NOT_EQ:
+            return Operator::NOT_EQUAL;
+        case token::LT_EQ:
+            return Operator::LESS_EQUAL;
+        case token::GT_EQ:
+            return Operator::GREATER_EQUAL;
+        default:
+            return Operator::NONE;
+        }
+    }
+
+    inline std::ostream &operator<<(std::ostream &out, Operator op)
+    {
+        return out << toString(op);
+    }
+}
@@ -0,0 +1,72 @@
+#include "code.hpp"
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+void code::emit(Instructions &instructions, Opcode op, std::initializer_list<uint32_t> operands)
+{
+    const Definition &definition = definitions[op];
+    instructions.push_back(op);
+
+    const uint32_t *operand = operands.begin();
+    for (uint8_t index = 0; index < definition.operandCount; ++index, ++operand)
+    {
+        const uint32_t value = operand < operands.end() ? *operand : 0;
+        if (definition.operandWidths[index] == 2)
+        {
+            if (value > std::numeric_limits<uint16_t>::max())
+            {
+                throw std::length_error("operand of " + std::string(definition.name) + " is too large");
+            }
+
+            const auto narrow = static_cast<uint16_t>(value);
+            const auto *bytes = reinterpret_cast<const uint8_t *>(&narrow);
+            instructions.insert(instructions.end(), bytes, bytes + sizeof(narrow));
+        }
+        else
+        {
+            const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+            instructions.insert(instructions.end(), bytes, bytes + sizeof(value));
+        }
+    }
+}
+
+code::Instructions code::make(Opcode op, std::initializer_list<uint32_t> operands)
+{
+    Instructions instruction;
+    emit(instruction, op, operands);
+    return instruction;
+}
+
+std::string code::toString(const Instructions &instructions)
+{
+    std::ostringstream oss;
+
+    for (size_t offset = 0; offset < instructions.size();)
+    {
+        const auto op = static_cast<Opcode>(instructions[offset]);
+        if (op >= OPCODE_COUNT)
+        {
+            oss << std::setw(4) << std::setfill('0') << offset << " UNKNOWN " << int(op) << "\n";
+            ++offset;
+            continue;
+        }
+
+        const Definition &definition = definitions[op];
+        oss << std::setw(4) << std::setfill('0') << offset << " " << definition.name;
+
+        size_t operandOffset = offset + 1;
+        for (uint8_t index = 0; index < definition.operandCount; ++index)
+        {
+            const uint8_t width = definition.operandWidths[index];
+            oss << " " << (width == 2 ? readUint16(&instructions[operandOffset]) : readUint32(&instructions[operandOffset]));
+            operandOffset += width;
+        }
+        oss << "\n";
+
+        offset += instructionWidth(op);
+    }
+
+    return oss.str();
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+
+namespace code
+{
+    // Bytecode of one function or of a whole program: opcodes, each followed by its operands in native byte order.
+    // Bytecode only lives in memory, so operands are read and written with plain copies.
+    using Instructions = std::vector<uint8_t>;
+
+    enum Opcode : uint8_t
+    {
+        CONSTANT,      // Pushes the integer constant at the index of the operand
+        TRUE_VALUE,    // Pushes vertet
+        FALSE_VALUE,   // Pushes falso
+        NULL_VALUE,    // Pushes null, the value of an if expression that took no branch
+        NOTHING,       // Pushes the value of statements that produce none, such as a var statement
+        POP,           // Drops the value on top of the stack
+        ADD,           // Binary operators pop the right then the left operand and push the result
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        LESS,
+        GREATER,
+        EQUAL,
+        NOT_EQUAL,
+        LESS_EQUAL,
+        GREATER_EQUAL,
+        MINUS,         // Prefix operators replace the value on top of the stack
+        NOT,
+        JUMP,          // Continues at the instruction offset of the operand
+        JUMP_IF_FALSE, // Pops the condition, continues at the operand offset if it isn't truthy
+        GET_GLOBAL,    // Pushes the global with the symbol of the operand
+        SET_GLOBAL,    // Pops a value and binds it to the global with the symbol of the operand
+        GET_LOCAL,     // Pushes the slot of the current call that the operand names
+        SET_LOCAL,     // Pops a value and binds it to the slot of the current call
+        GET_SCOPED,    // Pushes the slot of the second operand, the first many scopes out from the current one
+        SET_SCOPED,    // Pops a value and binds it to the slot of the current call's scope
+        GET_NAME,      // Pushes the variable with the symbol of the operand, searched for in every scope by name
+        CLOSURE,       // Pushes a closure of the function at the index of the operand over the current scope
+        CALL,          // Calls the function below as many arguments as the operand, leaving the result in its place
+        RETURN_VALUE,  // Returns the value on top of the stack from the current call or the program
+
+        // Superinstructions do the work of the sequence of instructions superinstructions lists for them in one
+        // dispatch. Their operands are those of the sequence in order.
+        GET_LOCAL_GET_LOCAL,
+        ADD_CONSTANT,
+        SUBTRACT_CONSTANT,
+        MULTIPLY_CONSTANT,
+        LESS_JUMP_IF_FALSE,
+        GET_LOCAL_ADD_CONSTANT,
+        GET_LOCAL_SUBTRACT_CONSTANT,
+        GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE,
+        GET_SCOPED_ADD,
+        GET_SCOPED_SUBTRACT,
+
+        OPCODE_COUNT
+    };
+
+    // Name and operand widths in bytes of an opcode
+    struct Definition
+    {
+        std::string_view name;
+        uint8_t operandCount;
+        std::array<uint8_t, 3> operandWidths;
+    };
+
+    // Definition of every opcode, indexed by the opcode
+    constexpr std::array<Definition, OPCODE_COUNT> definitions{{
+        {"CONSTANT", 1, {4}},
+        {"TRUE_VALUE", 0, {}},
+        {"FALSE_VALUE", 0, {}},
+        {"NULL_VALUE", 0, {}},
+        {"NOTHING", 0, {}},
+        {"POP", 0, {}},
+        {"ADD", 0, {}},
+        {"SUBTRACT", 0, {}},
+        {"MULTIPLY", 0, {}},
+        {"DIVIDE", 0, {}},
+        {"LESS", 0, {}},
+        {"GREATER", 0, {}},
+        {"EQUAL", 0, {}},
+        {"NOT_EQUAL", 0, {}},
+        {"LESS_EQUAL", 0, {}},
+        {"GREATER_EQUAL", 0, {}},
+        {"MINUS", 0, {}},
+        {"NOT", 0, {}},
+        {"JUMP", 1, {4}},
+        {"JUMP_IF_FALSE", 1, {4}},
+        {"GET_GLOBAL", 1, {4}},
+        {"SET_GLOBAL", 1, {4}},
+        {"GET_LOCAL", 1, {2}},
+        {"SET_LOCAL", 1, {2}},
+        {"GET_SCOPED", 2, {2, 2}},
+        {"SET_SCOPED", 1, {2}},
+        {"GET_NAME", 1, {4}},
+        {"CLOSURE", 1, {4}},
+        {"CALL", 1, {2}},
+        {"RETURN_VALUE", 0, {}},
+        {"GET_LOCAL_GET_LOCAL", 2, {2, 2}},
+        {"ADD_CONSTANT", 1, {4}},
+        {"SUBTRACT_CONSTANT", 1, {4}},
+        {"MULTIPLY_CONSTANT", 1, {4}},
+        {"LESS_JUMP_IF_FALSE", 1, {4}},
+        {"GET_LOCAL_ADD_CONSTANT", 2, {2, 4}},
+        {"GET_LOCAL_SUBTRACT_CONSTANT", 2, {2, 4}},
+        {"GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE", 3, {2, 4, 4}},
+        {"GET_SCOPED_ADD", 2, {2, 2}},
+        {"GET_SCOPED_SUBTRACT", 2, {2, 2}},
+    }};
+
+    // A superinstruction and the sequence of instructions it does the work of
+    struct Superinstruction
+    {
+        Opcode op;
+        uint8_t length;
+        std::array<Opcode, 4> sequence;
+    };
+
+    // Every superinstruction, compiler::fuseSuperinstructions puts the ones a profile picks in place of their sequences
+    constexpr std::array<Superinstruction, OPCODE_COUNT - GET_LOCAL_GET_LOCAL> superinstructions{{
+        {GET_LOCAL_GET_LOCAL, 2, {GET_LOCAL, GET_LOCAL}},
+        {ADD_CONSTANT, 2, {CONSTANT, ADD}},
+        {SUBTRACT_CONSTANT, 2, {CONSTANT, SUBTRACT}},
+        {MULTIPLY_CONSTANT, 2, {CONSTANT, MULTIPLY}},
+        {LESS_JUMP_IF_FALSE, 2, {LESS, JUMP_IF_FALSE}},
+        {GET_LOCAL_ADD_CONSTANT, 3, {GET_LOCAL, CONSTANT, ADD}},
+        {GET_LOCAL_SUBTRACT_CONSTANT, 3, {GET_LOCAL, CONSTANT, SUBTRACT}},
+        {GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE, 4, {GET_LOCAL, CONSTANT, LESS, JUMP_IF_FALSE}},
+        {GET_SCOPED_ADD, 2, {GET_SCOPED, ADD}},
+        {GET_SCOPED_SUBTRACT, 2, {GET_SCOPED, SUBTRACT}},
+    }};
+
+    // Returns the number of bytes the opcode and its operands take
+    constexpr size_t instructionWidth(Opcode op)
+    {
+        const Definition &definition = definitions[op];
+        size_t width = 1;
+        for (uint8_t operand = 0; operand < definition.operandCount; ++operand)
+        {
+            width += definition.operandWidths[operand];
+        }
+
+        return width;
+    }
+
+    // Returns whether the superinstruction has the operands of its sequence, in order and with the same widths
+    constexpr bool hasOperandsOfSequence(const Superinstruction &superinstruction)
+    {
+        uint8_t operand = 0;
+        for (uint8_t index = 0; index < superinstruction.length; ++index)
+        {
+            const Definition &step = definitions[superinstruction.sequence[index]];
+            for (uint8_t stepOperand = 0; stepOperand < step.operandCount; ++stepOperand, ++operand)
+            {
+                if (operand >= definitions[superinstruction.op].operandCount ||
+                    definitions[superinstruction.op].operandWidths[operand] != step.operandWidths[stepOperand])
+                {
+                    return false;
+                }
+            }
+        }
+
+        return operand == definitions[superinstruction.op].operandCount;
+    }
+
+    constexpr bool superinstructionsMatchDefinitions()
+    {
+        for (size_t index = 0; index < superinstructions.size(); ++index)
+        {
+            if (superinstructions[index].op != GET_LOCAL_GET_LOCAL + index ||
+                !hasOperandsOfSequence(superinstructions[index]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(superinstructionsMatchDefinitions(),
+                  "superinstructions are listed in opcode order and take the operands of their sequence");
+
+    // Appends the opcode with its operands to the instructions. Throws std::length_error for an operand that
+    // doesn't fit its width.
+    void emit(Instructions &instructions, Opcode op, std::initializer_list<uint32_t> operands = {});
+
+    // Returns the instruction the opcode and operands encode
+    Instructions make(Opcode op, std::initializer_list<uint32_t> operands = {});
+
+    inline uint16_t readUint16(const uint8_t *bytes)
+    {
+        uint16_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t readUint32(const uint8_t *bytes)
+    {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    // Overwrites the four byte operand at the offset, used to patch jumps once their target is known
+    inline void patchUint32(Instructions &instructions, size_t offset, uint32_t value)
+    {
+        std::memcpy(instructions.data() + offset, &value, sizeof(value));
+    }
+
+    // Lists every instruction on its own line as its offset, name and operands. Helpful for debugging.
+    std::string toString(const Instructions &instructions);
+
+    // What running a function literal needs to know apart from its code, the same for every kind of code
+    struct FunctionPrototype
+    {
+        // Literal the function was compiled from, it belongs to the program's arena which has to outlive the function
+        const ast::FunctionLiteral *literal = nullptr;
+
+        // Slots of a call: the distinct parameter names first, then the locals the resolver gave the literal
+        uint32_t slotCount = 0;
+        uint32_t parameterCount = 0;
+
+        // Symbol of the name of every slot, for looking a name up in the scopes of calls
+        std::vector<token::Symbol> slotSymbols;
+
+        // Calls keep their slots in a scope on the heap instead of on the stack, so the closures of the function
+        // literals nested in this one can reach them after the call returned
+        bool hasScope = false;
+
+        // Parameter i has slot i, no parameter name is repeated, arguments can stay where the caller pushed them
+        bool argumentsInSlots = true;
+    };
+
+    // A function literal compiled to bytecode
+    struct CompiledFunction : FunctionPrototype
+    {
+        Instructions instructions;
+
+        // Most values the function pushes onto the stack on top of its slots at once
+        uint32_t maxStackDepth = 0;
+    };
+
+    // A whole program compiled to bytecode
+    struct Bytecode
+    {
+        // Code of the program itself, it runs like a function without slots
+        CompiledFunction program;
+
+        // Integer constants of the program and every function in it
+        std::vector<int64_t> constants;
+
+        // Functions of every function literal in the program, in the order the literals end
+        std::vector<std::unique_ptr<CompiledFunction>> functions;
+
+        // Keep the nodes and source of the program alive, the literals of the functions point into them
+        std::shared_ptr<ast::Arena> arena;
+        std::shared_ptr<const void> source;
+    };
+
+    // How often each opcode ran right before each other one, collected by vm::VM in training runs.
+    // pairs[first][second] counts first being followed by second.
+    struct Profile
+    {
+        std::array<std::array<uint64_t, OPCODE_COUNT>, OPCODE_COUNT> pairs{};
+    };
+}
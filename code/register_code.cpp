@@ -0,0 +1,19 @@
+#include "register_code.hpp"
+#include <iomanip>
+#include <sstream>
+
+std::string code::toString(const std::vector<RegisterInstruction> &instructions)
+{
+    std::ostringstream oss;
+
+    for (size_t index = 0; index < instructions.size(); ++index)
+    {
+        const RegisterInstruction &instruction = instructions[index];
+        const auto op = static_cast<size_t>(instruction.op);
+        oss << std::setw(4) << std::setfill('0') << index << " "
+            << (op < registerOpcodeNames.size() ? registerOpcodeNames[op] : "UNKNOWN") << " " << instruction.a
+            << " " << instruction.b << " " << instruction.c << "\n";
+    }
+
+    return oss.str();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "code.hpp"
+
+namespace code
+{
+    // Opcodes of the register machine. R(x) is register x of the current call, its slots come first and the
+    // temporaries follow them. RK(x) is register x, or the integer constant x - CONSTANT_OPERAND from x on.
+    enum class RegisterOpcode : uint8_t
+    {
+        LOAD_CONSTANT, // R(a) = integer constant bx
+        LOAD_BOOLEAN,  // R(a) = b != 0
+        LOAD_NULL,     // R(a) = null, the value of an if expression that took no branch
+        LOAD_NOTHING,  // R(a) = the value of statements that produce none
+        MOVE,          // R(a) = R(b)
+        ADD,           // Binary operators: R(a) = RK(b) op RK(c)
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        LESS,
+        GREATER,
+        EQUAL,
+        NOT_EQUAL,
+        LESS_EQUAL,
+        GREATER_EQUAL,
+        MINUS,         // R(a) = -R(b)
+        NOT,           // R(a) = !R(b)
+        JUMP,          // Continues at instruction bx
+        JUMP_IF_FALSE, // Continues at instruction bx if R(a) isn't truthy
+        GET_GLOBAL,    // R(a) = the global with symbol bx
+        SET_GLOBAL,    // Binds R(a) to the global with symbol bx
+        GET_LOCAL,     // R(a) = R(b), a slot whose var statement may not have run yet
+        SET_LOCAL,     // Binds R(b) to the slot R(a)
+        GET_SCOPED,    // R(a) = slot c of the scope b scopes out from the current one
+        SET_SCOPED,    // Binds R(b) to slot a of the current call's scope
+        GET_NAME,      // R(a) = the variable with symbol bx, searched for in every scope by name
+        CLOSURE,       // R(a) = closure of function bx over the current scope
+        CALL,          // R(a) = R(a)(R(a + 1), ..., R(a + b)), the callee's registers start at a + 1
+        RETURN,        // Returns R(a) from the current call or the program
+
+        COUNT
+    };
+
+    // Name of every register opcode, indexed by the opcode
+    constexpr std::array<std::string_view, static_cast<size_t>(RegisterOpcode::COUNT)> registerOpcodeNames{
+        "LOAD_CONSTANT", "LOAD_BOOLEAN", "LOAD_NULL", "LOAD_NOTHING", "MOVE", "ADD", "SUBTRACT", "MULTIPLY",
+        "DIVIDE", "LESS", "GREATER", "EQUAL", "NOT_EQUAL", "LESS_EQUAL", "GREATER_EQUAL", "MINUS", "NOT", "JUMP",
+        "JUMP_IF_FALSE", "GET_GLOBAL", "SET_GLOBAL", "GET_LOCAL", "SET_LOCAL", "GET_SCOPED", "SET_SCOPED",
+        "GET_NAME", "CLOSURE", "CALL", "RETURN"};
+
+    // RK operands from this one on name constants, registers are below it
+    constexpr uint16_t CONSTANT_OPERAND = 0x8000;
+
+    // One instruction of the register machine. Instructions with a 32 bit operand bx keep it in b and c.
+    struct RegisterInstruction
+    {
+        RegisterOpcode op;
+        uint16_t a = 0;
+        uint16_t b = 0;
+        uint16_t c = 0;
+
+        constexpr uint32_t bx() const
+        {
+            return b | static_cast<uint32_t>(c) << 16;
+        }
+
+        bool operator==(const RegisterInstruction &other) const
+        {
+            return op == other.op && a == other.a && b == other.b && c == other.c;
+        }
+    };
+
+    // Returns the instruction with a 32 bit operand bx
+    constexpr RegisterInstruction makeBx(RegisterOpcode op, uint16_t a, uint32_t bx)
+    {
+        return RegisterInstruction{op, a, static_cast<uint16_t>(bx), static_cast<uint16_t>(bx >> 16)};
+    }
+
+    // Lists every instruction on its own line as its index, name and operands. Helpful for debugging.
+    std::string toString(const std::vector<RegisterInstruction> &instructions);
+
+    // A function literal compiled for the register machine
+    struct RegisterFunction : FunctionPrototype
+    {
+        std::vector<RegisterInstruction> instructions;
+
+        // Registers of a call, the slots included
+        uint32_t registerCount = 0;
+    };
+
+    // A whole program compiled for the register machine
+    struct RegisterBytecode
+    {
+        // Code of the program itself, it runs like a function without slots
+        RegisterFunction program;
+
+        // Integer constants of the program and every function in it
+        std::vector<int64_t> constants;
+
+        // Functions of every function literal in the program, in the order the literals end
+        std::vector<std::unique_ptr<RegisterFunction>> functions;
+
+        // Keep the nodes and source of the program alive, the literals of the functions point into them
+        std::shared_ptr<ast::Arena> arena;
+        std::shared_ptr<const void> source;
+    };
+}
@@ -0,0 +1,455 @@
+#include "compiler.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "resolver.hpp"
+
+namespace
+{
+    // Opcode of every infix operator, indexed by the operator. Prefix operators and NONE have none.
+    constexpr std::array<code::Opcode, ast::OPERATOR_COUNT + 1> infixOpcodes{
+        code::ADD, code::SUBTRACT, code::MULTIPLY, code::DIVIDE, code::OPCODE_COUNT, code::LESS, code::GREATER,
+        code::EQUAL, code::NOT_EQUAL, code::LESS_EQUAL, code::GREATER_EQUAL, code::OPCODE_COUNT};
+
+    // Returns whether the statements contain a function literal anywhere, nested ones included
+    bool containsFunctionLiteral(const ast::NodeList<ast::Statement> &statements);
+
+    bool containsFunctionLiteral(const ast::Expression *expression)
+    {
+        if (!expression)
+        {
+            return false;
+        }
+
+        switch (expression->kind)
+        {
+        case ast::NodeKind::FUNCTION_LITERAL:
+            return true;
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            return containsFunctionLiteral(static_cast<const ast::PrefixExpression *>(expression)->right);
+        case ast::NodeKind::INFIX_EXPRESSION:
+        {
+            auto *infix = static_cast<const ast::InfixExpression *>(expression);
+            return containsFunctionLiteral(infix->left) || containsFunctionLiteral(infix->right);
+        }
+        case ast::NodeKind::IF_EXPRESSION:
+        {
+            auto *ifExpression = static_cast<const ast::IfExpression *>(expression);
+            return containsFunctionLiteral(ifExpression->condition) ||
+                   containsFunctionLiteral(ifExpression->consequence->statements) ||
+                   (ifExpression->alternative && containsFunctionLiteral(ifExpression->alternative->statements));
+        }
+        case ast::NodeKind::CALL_EXPRESSION:
+        {
+            auto *call = static_cast<const ast::CallExpression *>(expression);
+            return containsFunctionLiteral(call->function) ||
+                   std::any_of(call->arguments.begin(), call->arguments.end(),
+                               [](const ast::Expression *argument)
+                               { return containsFunctionLiteral(argument); });
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool containsFunctionLiteral(const ast::NodeList<ast::Statement> &statements)
+    {
+        for (const ast::Statement *statement : statements)
+        {
+            switch (statement->kind)
+            {
+            case ast::NodeKind::VAR_STATEMENT:
+                if (containsFunctionLiteral(static_cast<const ast::VarStatement *>(statement)->expression))
+                    return true;
+                break;
+            case ast::NodeKind::RETURN_STATEMENT:
+                if (containsFunctionLiteral(static_cast<const ast::ReturnStatement *>(statement)->returnValue))
+                    return true;
+                break;
+            case ast::NodeKind::EXPRESSION_STATEMENT:
+                if (containsFunctionLiteral(static_cast<const ast::ExpressionStatement *>(statement)->expression))
+                    return true;
+                break;
+            case ast::NodeKind::BLOCK_STATEMENT:
+                if (containsFunctionLiteral(static_cast<const ast::BlockStatement *>(statement)->statements))
+                    return true;
+                break;
+            default:
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    // Compiles one program, keeping the function being compiled and the depth of its stack
+    class Compiler
+    {
+    public:
+        explicit Compiler(code::Bytecode &bytecode) : bytecode{bytecode}
+        {
+        }
+
+        void compileProgram(const ast::Program &program);
+
+    private:
+        code::Bytecode &bytecode;
+        std::unordered_map<int64_t, uint32_t> constantIndexes;
+
+        code::CompiledFunction *function = nullptr;
+        uint32_t stackDepth = 0;
+
+        // Emits the instruction into the current function and keeps track of how deep its stack gets
+        void emit(code::Opcode op, std::initializer_list<uint32_t> operands = {});
+        size_t emitJump(code::Opcode op);
+        void patchJump(size_t jump);
+
+        uint32_t addConstant(int64_t value);
+
+        // Compiles the statements of a program or function and returns the value of the last one
+        void compileBody(const ast::NodeList<ast::Statement> &statements);
+
+        // Compiles the statements to leave the value of the last one on the stack, NOTHING if it has none
+        void compileStatements(const ast::NodeList<ast::Statement> &statements);
+        void compileStatement(const ast::Statement *statement, bool keepValue);
+        void compileExpression(const ast::Expression *expression);
+        void compileIdentifier(const ast::Identifier *identifier);
+        void compileIf(const ast::IfExpression *ifExpression);
+        void compileFunction(const ast::FunctionLiteral *literal);
+    };
+}
+
+void Compiler::emit(code::Opcode op, std::initializer_list<uint32_t> operands)
+{
+    code::emit(function->instructions, op, operands);
+
+    switch (op)
+    {
+    case code::CONSTANT:
+    case code::TRUE_VALUE:
+    case code::FALSE_VALUE:
+    case code::NULL_VALUE:
+    case code::NOTHING:
+    case code::GET_GLOBAL:
+    case code::GET_LOCAL:
+    case code::GET_SCOPED:
+    case code::GET_NAME:
+    case code::CLOSURE:
+        ++stackDepth;
+        break;
+    case code::CALL:
+        stackDepth -= *operands.begin();
+        break;
+    case code::MINUS:
+    case code::NOT:
+    case code::JUMP:
+        break;
+    default:
+        // Binary operators, jumps on a condition, stores, POP and RETURN_VALUE all take one value off the stack
+        --stackDepth;
+        break;
+    }
+
+    function->maxStackDepth = std::max(function->maxStackDepth, stackDepth);
+}
+
+size_t Compiler::emitJump(code::Opcode op)
+{
+    emit(op, {0});
+    return function->instructions.size() - sizeof(uint32_t);
+}
+
+void Compiler::patchJump(size_t jump)
+{
+    code::patchUint32(function->instructions, jump, static_cast<uint32_t>(function->instructions.size()));
+}
+
+uint32_t Compiler::addConstant(int64_t value)
+{
+    const auto [found, inserted] = constantIndexes.try_emplace(value, static_cast<uint32_t>(bytecode.constants.size()));
+    if (inserted)
+    {
+        bytecode.constants.push_back(value);
+    }
+
+    return found->second;
+}
+
+void Compiler::compileProgram(const ast::Program &program)
+{
+    function = &bytecode.program;
+    compileBody(program.statements);
+}
+
+void Compiler::compileBody(const ast::NodeList<ast::Statement> &statements)
+{
+    compileStatements(statements);
+
+    // A return statement at the end already returned its value
+    if (statements.empty() || statements.back()->kind != ast::NodeKind::RETURN_STATEMENT)
+    {
+        emit(code::RETURN_VALUE);
+    }
+}
+
+void Compiler::compileStatements(const ast::NodeList<ast::Statement> &statements)
+{
+    if (statements.empty())
+    {
+        emit(code::NOTHING);
+        return;
+    }
+
+    for (size_t index = 0; index < statements.size(); ++index)
+    {
+        compileStatement(statements[index], index + 1 == statements.size());
+    }
+}
+
+void Compiler::compileStatement(const ast::Statement *statement, bool keepValue)
+{
+    switch (statement->kind)
+    {
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        compileExpression(static_cast<const ast::ExpressionStatement *>(statement)->expression);
+        if (!keepValue)
+        {
+            emit(code::POP);
+        }
+        return;
+
+    case ast::NodeKind::VAR_STATEMENT:
+    {
+        auto *varStatement = static_cast<const ast::VarStatement *>(statement);
+        compileExpression(varStatement->expression);
+
+        const ast::Identifier *name = varStatement->name;
+        if (name->depth != 0)
+        {
+            emit(code::SET_GLOBAL, {name->symbol});
+        }
+        else
+        {
+            emit(function->hasScope ? code::SET_SCOPED : code::SET_LOCAL, {name->slot});
+        }
+
+        if (keepValue)
+        {
+            emit(code::NOTHING);
+        }
+        return;
+    }
+
+    case ast::NodeKind::RETURN_STATEMENT:
+        compileExpression(static_cast<const ast::ReturnStatement *>(statement)->returnValue);
+        emit(code::RETURN_VALUE);
+
+        // Code after the return is unreachable, as far as it is concerned the value stays on the stack
+        if (keepValue)
+        {
+            ++stackDepth;
+        }
+        return;
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        compileStatements(static_cast<const ast::BlockStatement *>(statement)->statements);
+        if (!keepValue)
+        {
+            emit(code::POP);
+        }
+        return;
+
+    default:
+        if (keepValue)
+        {
+            emit(code::NOTHING);
+        }
+        return;
+    }
+}
+
+void Compiler::compileExpression(const ast::Expression *expression)
+{
+    // Expressions the parser gave up on are missing from the tree
+    if (!expression)
+    {
+        emit(code::NOTHING);
+        return;
+    }
+
+    switch (expression->kind)
+    {
+    case ast::NodeKind::INTEGER_LITERAL:
+        emit(code::CONSTANT, {addConstant(static_cast<const ast::IntegerLiteral *>(expression)->value)});
+        return;
+
+    case ast::NodeKind::BOOLEAN:
+        emit(static_cast<const ast::Boolean *>(expression)->value ? code::TRUE_VALUE : code::FALSE_VALUE);
+        return;
+
+    case ast::NodeKind::IDENTIFIER:
+        compileIdentifier(static_cast<const ast::Identifier *>(expression));
+        return;
+
+    case ast::NodeKind::PREFIX_EXPRESSION:
+    {
+        auto *prefix = static_cast<const ast::PrefixExpression *>(expression);
+        compileExpression(prefix->right);
+        if (prefix->op != ast::Operator::MINUS && prefix->op != ast::Operator::NOT)
+        {
+            throw std::invalid_argument("unknown prefix operator " + std::string(ast::toString(prefix->op)));
+        }
+
+        emit(prefix->op == ast::Operator::MINUS ? code::MINUS : code::NOT);
+        return;
+    }
+
+    case ast::NodeKind::INFIX_EXPRESSION:
+    {
+        auto *infix = static_cast<const ast::InfixExpression *>(expression);
+        compileExpression(infix->left);
+        compileExpression(infix->right);
+
+        const code::Opcode op = infixOpcodes[static_cast<size_t>(infix->op)];
+        if (op == code::OPCODE_COUNT)
+        {
+            throw std::invalid_argument("unknown infix operator " + std::string(ast::toString(infix->op)));
+        }
+
+        emit(op);
+        return;
+    }
+
+    case ast::NodeKind::IF_EXPRESSION:
+        compileIf(static_cast<const ast::IfExpression *>(expression));
+        return;
+
+    case ast::NodeKind::FUNCTION_LITERAL:
+        compileFunction(static_cast<const ast::FunctionLiteral *>(expression));
+        return;
+
+    case ast::NodeKind::CALL_EXPRESSION:
+    {
+        auto *call = static_cast<const ast::CallExpression *>(expression);
+        compileExpression(call->function);
+        for (const ast::Expression *argument : call->arguments)
+        {
+            compileExpression(argument);
+        }
+
+        emit(code::CALL, {static_cast<uint32_t>(call->arguments.size())});
+        return;
+    }
+
+    default:
+        emit(code::NOTHING);
+        return;
+    }
+}
+
+void Compiler::compileIdentifier(const ast::Identifier *identifier)
+{
+    if (identifier->depth == ast::GLOBAL_DEPTH)
+    {
+        emit(code::GET_GLOBAL, {identifier->symbol});
+    }
+    else if (identifier->depth == ast::UNRESOLVED_DEPTH)
+    {
+        emit(code::GET_NAME, {identifier->symbol});
+    }
+    else if (function->hasScope)
+    {
+        emit(code::GET_SCOPED, {identifier->depth, identifier->slot});
+    }
+    else if (identifier->depth == 0)
+    {
+        emit(code::GET_LOCAL, {identifier->slot});
+    }
+    else
+    {
+        // Calls without a scope of their own start from the scope of the closure, one function further out
+        emit(code::GET_SCOPED, {identifier->depth - 1, identifier->slot});
+    }
+}
+
+void Compiler::compileIf(const ast::IfExpression *ifExpression)
+{
+    compileExpression(ifExpression->condition);
+    const size_t jumpToAlternative = emitJump(code::JUMP_IF_FALSE);
+
+    compileStatements(ifExpression->consequence->statements);
+    const size_t jumpToEnd = emitJump(code::JUMP);
+
+    // Only one of the branches runs, each leaves one value
+    --stackDepth;
+    patchJump(jumpToAlternative);
+    if (ifExpression->alternative)
+    {
+        compileStatements(ifExpression->alternative->statements);
+    }
+    else
+    {
+        emit(code::NULL_VALUE);
+    }
+    patchJump(jumpToEnd);
+}
+
+void Compiler::compileFunction(const ast::FunctionLiteral *literal)
+{
+    auto compiled = std::make_unique<code::CompiledFunction>();
+    compiler::describeFunction(literal, *compiled);
+
+    code::CompiledFunction *enclosing = std::exchange(function, compiled.get());
+    const uint32_t enclosingDepth = std::exchange(stackDepth, 0);
+
+    compileBody(literal->body->statements);
+
+    function = enclosing;
+    stackDepth = enclosingDepth;
+
+    bytecode.functions.push_back(std::move(compiled));
+    emit(code::CLOSURE, {static_cast<uint32_t>(bytecode.functions.size() - 1)});
+}
+
+void compiler::describeFunction(const ast::FunctionLiteral *literal, code::FunctionPrototype &prototype)
+{
+    prototype.literal = literal;
+    prototype.slotCount = literal->slotCount;
+    prototype.parameterCount = static_cast<uint32_t>(literal->parameters.size());
+    prototype.hasScope = containsFunctionLiteral(literal->body->statements);
+
+    prototype.slotSymbols.resize(literal->slotCount);
+    for (size_t index = 0; index < literal->parameters.size(); ++index)
+    {
+        const ast::Identifier *parameter = literal->parameters[index];
+        prototype.argumentsInSlots = prototype.argumentsInSlots && parameter->slot == index;
+        prototype.slotSymbols[parameter->slot] = parameter->symbol;
+    }
+    for (const ast::Identifier *local : literal->locals)
+    {
+        prototype.slotSymbols[local->slot] = local->symbol;
+    }
+
+    // Operands name slots with two bytes, checked once here instead of on every access
+    if (literal->slotCount > std::numeric_limits<uint16_t>::max())
+    {
+        throw std::length_error("function declares too many variables");
+    }
+}
+
+code::Bytecode compiler::compile(ast::Program &program)
+{
+    resolver::resolve(program);
+
+    code::Bytecode bytecode;
+    bytecode.arena = program.arena;
+    bytecode.source = program.source;
+
+    Compiler compiler(bytecode);
+    compiler.compileProgram(program);
+
+    return bytecode;
+}
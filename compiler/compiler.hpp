@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ast.hpp"
+#include "code.hpp"
+
+namespace compiler
+{
+    // Lowers the program to bytecode for vm::VM, resolving its variables first if that wasn't done yet.
+    // Statements compile so that running them leaves the value the evaluator gives them on the stack. Variables
+    // compile to the slot the resolver gave them, in the call's stack frame for functions without nested function
+    // literals and in the call's scope for the others, whose closures may outlive the call. Names no function
+    // declares are globals, indexed by their symbol.
+    // Throws std::length_error if a function has more slots or arguments than an operand can name.
+    code::Bytecode compile(ast::Program &program);
+
+    // Fills in what running the resolved function literal needs to know apart from its code, the same for both
+    // machines. Throws std::length_error if the function has more slots than an operand can name.
+    void describeFunction(const ast::FunctionLiteral *literal, code::FunctionPrototype &prototype);
+}
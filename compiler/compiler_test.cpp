@@ -0,0 +1,315 @@
+#include <assert.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "compiler.hpp"
+#include "register_compiler.hpp"
+#include "superinstructions.hpp"
+
+ast::Program *parse(const std::string &input)
+{
+    Parser parser(new lexer::Lexer(input));
+    ast::Program *program = parser.parseProgram();
+    assert(parser.getErrors().empty() && "input has parse errors");
+
+    return program;
+}
+
+code::Instructions concat(const std::vector<code::Instructions> &instructions)
+{
+    code::Instructions all;
+    for (const code::Instructions &instruction : instructions)
+    {
+        all.insert(all.end(), instruction.begin(), instruction.end());
+    }
+
+    return all;
+}
+
+void assertInstructions(const code::Instructions &got, const code::Instructions &expected)
+{
+    if (got != expected)
+    {
+        std::cout << "\n\texpected:\n" << code::toString(expected) << "\tgot:\n" << code::toString(got) << std::endl;
+    }
+    assert(got == expected && "wrong instructions");
+}
+
+void testProgramInstructions()
+{
+    using code::make;
+
+    struct CompilerTestCase
+    {
+        std::string input;
+        std::vector<int64_t> constants;
+        code::Instructions expected;
+    };
+
+    const token::Symbol a = token::intern("a");
+    const token::Symbol b = token::intern("b");
+
+    std::vector<CompilerTestCase> tests{
+        {"1 + 2", {1, 2}, concat({make(code::CONSTANT, {0}), make(code::CONSTANT, {1}), make(code::ADD),
+                                  make(code::RETURN_VALUE)})},
+        {"1; 2", {1, 2}, concat({make(code::CONSTANT, {0}), make(code::POP), make(code::CONSTANT, {1}),
+                                 make(code::RETURN_VALUE)})},
+        {"2 * 2 == -2", {2}, concat({make(code::CONSTANT, {0}), make(code::CONSTANT, {0}), make(code::MULTIPLY),
+                                     make(code::CONSTANT, {0}), make(code::MINUS), make(code::EQUAL),
+                                     make(code::RETURN_VALUE)})},
+        {"!vertet != falso", {}, concat({make(code::TRUE_VALUE), make(code::NOT), make(code::FALSE_VALUE),
+                                         make(code::NOT_EQUAL), make(code::RETURN_VALUE)})},
+        {"", {}, concat({make(code::NOTHING), make(code::RETURN_VALUE)})},
+        {"var a = 1; var b = a;", {1}, concat({make(code::CONSTANT, {0}), make(code::SET_GLOBAL, {a}),
+                                               make(code::GET_GLOBAL, {a}), make(code::SET_GLOBAL, {b}),
+                                               make(code::NOTHING), make(code::RETURN_VALUE)})},
+        {"kthen 1; 2", {1, 2}, concat({make(code::CONSTANT, {0}), make(code::RETURN_VALUE),
+                                       make(code::CONSTANT, {1}), make(code::RETURN_VALUE)})},
+
+        // 0000 TRUE_VALUE, 0001 JUMP_IF_FALSE, 0006 CONSTANT, 0011 JUMP, 0016 NULL_VALUE, 0017 RETURN_VALUE
+        {"nese (vertet) { 10 }", {10}, concat({make(code::TRUE_VALUE), make(code::JUMP_IF_FALSE, {16}),
+                                               make(code::CONSTANT, {0}), make(code::JUMP, {17}),
+                                               make(code::NULL_VALUE), make(code::RETURN_VALUE)})},
+        // 0000 FALSE_VALUE, 0001 JUMP_IF_FALSE, 0006 NOTHING, 0007 JUMP, 0012 CONSTANT, 0017 RETURN_VALUE
+        {"nese (falso) { } perndryshe { 20 }", {20}, concat({make(code::FALSE_VALUE), make(code::JUMP_IF_FALSE, {12}),
+                                                             make(code::NOTHING), make(code::JUMP, {17}),
+                                                             make(code::CONSTANT, {0}), make(code::RETURN_VALUE)})},
+
+        {"funksion(a) { a }(5)", {5}, concat({make(code::CLOSURE, {0}), make(code::CONSTANT, {0}),
+                                              make(code::CALL, {1}), make(code::RETURN_VALUE)})},
+    };
+
+    std::cout << "-------------[Compiler Program Test]------------\n";
+    for (const auto &test : tests)
+    {
+        std::cout << "TEST: " << test.input;
+
+        const code::Bytecode bytecode = compiler::compile(*parse(test.input));
+        assertInstructions(bytecode.program.instructions, test.expected);
+        assert(bytecode.constants == test.constants && "wrong constants");
+
+        std::cout << " ✓\n";
+    }
+
+    std::cout << "COMPILER PROGRAM TESTS PASSED!" << std::endl;
+}
+
+void testFunctions()
+{
+    using code::make;
+
+    std::cout << "-------------[Compiler Function Test]------------\n";
+
+    // Functions without nested literals keep their variables on the stack
+    code::Bytecode bytecode = compiler::compile(*parse("funksion(x, y) { var z = x * y; kthen z; }"));
+    assert(bytecode.functions.size() == 1);
+    const code::CompiledFunction &leaf = *bytecode.functions[0];
+    assert(!leaf.hasScope && leaf.argumentsInSlots);
+    assert(leaf.slotCount == 3 && leaf.parameterCount == 2);
+    assert((leaf.slotSymbols == std::vector<token::Symbol>{token::intern("x"), token::intern("y"), token::intern("z")}));
+    assertInstructions(leaf.instructions, concat({make(code::GET_LOCAL, {0}), make(code::GET_LOCAL, {1}),
+                                                  make(code::MULTIPLY), make(code::SET_LOCAL, {2}),
+                                                  make(code::GET_LOCAL, {2}), make(code::RETURN_VALUE)}));
+    assert(leaf.maxStackDepth == 2);
+
+    // Functions with nested literals keep them in a scope, inner functions start from their closure's scope
+    bytecode = compiler::compile(*parse("funksion(a) { funksion(b) { funksion() { a + b } } }"));
+    assert(bytecode.functions.size() == 3 && "literals are added as they end");
+    const code::CompiledFunction &innermost = *bytecode.functions[0];
+    const code::CompiledFunction &middle = *bytecode.functions[1];
+    const code::CompiledFunction &outer = *bytecode.functions[2];
+
+    assert(outer.hasScope && middle.hasScope && !innermost.hasScope);
+    assertInstructions(innermost.instructions, concat({make(code::GET_SCOPED, {1, 0}), make(code::GET_SCOPED, {0, 0}),
+                                                       make(code::ADD), make(code::RETURN_VALUE)}));
+    assertInstructions(middle.instructions, concat({make(code::CLOSURE, {0}), make(code::RETURN_VALUE)}));
+    assertInstructions(outer.instructions, concat({make(code::CLOSURE, {1}), make(code::RETURN_VALUE)}));
+
+    // Repeated parameters share their first slot, the arguments have to be moved into the slots
+    bytecode = compiler::compile(*parse("funksion(a, a, b) { b }"));
+    const code::CompiledFunction &repeated = *bytecode.functions[0];
+    assert(!repeated.argumentsInSlots && repeated.slotCount == 2 && repeated.parameterCount == 3);
+    assertInstructions(repeated.instructions, concat({make(code::GET_LOCAL, {1}), make(code::RETURN_VALUE)}));
+
+    std::cout << "COMPILER FUNCTION TESTS PASSED!" << std::endl;
+}
+
+void testOperandEncoding()
+{
+    std::cout << "-------------[Code Operand Test]------------\n";
+
+    const code::Instructions instructions = concat({code::make(code::CONSTANT, {65535}),
+                                                    code::make(code::GET_SCOPED, {2, 513}),
+                                                    code::make(code::CALL, {1})});
+    assert(instructions.size() == code::instructionWidth(code::CONSTANT) +
+                                      code::instructionWidth(code::GET_SCOPED) +
+                                      code::instructionWidth(code::CALL));
+    assert(code::toString(instructions) == "0000 CONSTANT 65535\n0005 GET_SCOPED 2 513\n0010 CALL 1\n");
+
+    bool threw = false;
+    try
+    {
+        code::make(code::GET_LOCAL, {70000});
+    }
+    catch (const std::length_error &)
+    {
+        threw = true;
+    }
+    assert(threw && "an operand wider than two bytes doesn't fit GET_LOCAL");
+
+    std::cout << "CODE OPERAND TESTS PASSED!" << std::endl;
+}
+
+void assertRegisterInstructions(const std::vector<code::RegisterInstruction> &got,
+                                const std::vector<code::RegisterInstruction> &expected)
+{
+    if (got != expected)
+    {
+        std::cout << "\n\texpected:\n" << code::toString(expected) << "\tgot:\n" << code::toString(got) << std::endl;
+    }
+    assert(got == expected && "wrong register instructions");
+}
+
+void testRegisterInstructions()
+{
+    using code::RegisterOpcode;
+    constexpr uint16_t K = code::CONSTANT_OPERAND;
+
+    std::cout << "-------------[Register Compiler Test]------------\n";
+
+    // Binary operators name integer constants directly, the value of the program is in register 0
+    code::RegisterBytecode bytecode = compiler::compileToRegisters(*parse("1 + 2"));
+    assert((bytecode.constants == std::vector<int64_t>{1, 2}));
+    assertRegisterInstructions(bytecode.program.instructions, {{RegisterOpcode::ADD, 0, K, K + 1},
+                                                               {RegisterOpcode::RETURN, 0}});
+    assert(code::toString(bytecode.program.instructions) == "0000 ADD 0 32768 32769\n0001 RETURN 0 0 0\n");
+
+    const token::Symbol a = token::intern("a");
+    bytecode = compiler::compileToRegisters(*parse("var a = 1; a"));
+    assertRegisterInstructions(bytecode.program.instructions, {{RegisterOpcode::LOAD_CONSTANT, 1, 0},
+                                                               code::makeBx(RegisterOpcode::SET_GLOBAL, 1, a),
+                                                               code::makeBx(RegisterOpcode::GET_GLOBAL, 0, a),
+                                                               {RegisterOpcode::RETURN, 0}});
+
+    bytecode = compiler::compileToRegisters(*parse("nese (vertet) { 10 }"));
+    assertRegisterInstructions(bytecode.program.instructions, {{RegisterOpcode::LOAD_BOOLEAN, 0, 1},
+                                                               code::makeBx(RegisterOpcode::JUMP_IF_FALSE, 0, 4),
+                                                               {RegisterOpcode::LOAD_CONSTANT, 0, 0},
+                                                               code::makeBx(RegisterOpcode::JUMP, 0, 5),
+                                                               {RegisterOpcode::LOAD_NULL, 0},
+                                                               {RegisterOpcode::RETURN, 0}});
+
+    // The callee and its arguments take consecutive registers, the result replaces the callee
+    bytecode = compiler::compileToRegisters(*parse("funksion(n) { n }(5)"));
+    assertRegisterInstructions(bytecode.program.instructions, {{RegisterOpcode::CLOSURE, 0, 0},
+                                                               {RegisterOpcode::LOAD_CONSTANT, 1, 0},
+                                                               {RegisterOpcode::CALL, 0, 1},
+                                                               {RegisterOpcode::RETURN, 0}});
+    assertRegisterInstructions(bytecode.functions[0]->instructions, {{RegisterOpcode::GET_LOCAL, 1, 0},
+                                                                     {RegisterOpcode::RETURN, 1}});
+
+    // Slots are the first registers of a call, binary operators read them in place
+    bytecode = compiler::compileToRegisters(*parse("funksion(x, y) { var z = x * y; kthen z; }"));
+    const code::RegisterFunction &leaf = *bytecode.functions[0];
+    assert(leaf.slotCount == 3 && leaf.registerCount == 5);
+    assertRegisterInstructions(leaf.instructions, {{RegisterOpcode::MULTIPLY, 4, 0, 1},
+                                                   {RegisterOpcode::SET_LOCAL, 2, 4},
+                                                   {RegisterOpcode::GET_LOCAL, 4, 2},
+                                                   {RegisterOpcode::RETURN, 4}});
+
+    // Unless the right operand may bind the slot of the left one before it is read
+    bytecode = compiler::compileToRegisters(*parse("funksion(x) { x + nese (vertet) { var x = 1; 2 } }"));
+    assertRegisterInstructions(bytecode.functions[0]->instructions, {{RegisterOpcode::GET_LOCAL, 2, 0},
+                                                                     {RegisterOpcode::LOAD_BOOLEAN, 3, 1},
+                                                                     code::makeBx(RegisterOpcode::JUMP_IF_FALSE, 3, 7),
+                                                                     {RegisterOpcode::LOAD_CONSTANT, 4, 0},
+                                                                     {RegisterOpcode::SET_LOCAL, 0, 4},
+                                                                     {RegisterOpcode::LOAD_CONSTANT, 3, 1},
+                                                                     code::makeBx(RegisterOpcode::JUMP, 0, 8),
+                                                                     {RegisterOpcode::LOAD_NULL, 3},
+                                                                     {RegisterOpcode::ADD, 1, 2, 3},
+                                                                     {RegisterOpcode::RETURN, 1}});
+
+    // Functions with a scope keep their slots in it, their temporaries start at register 0
+    bytecode = compiler::compileToRegisters(*parse("funksion(a) { funksion() { a } }"));
+    const code::RegisterFunction &outer = *bytecode.functions[1];
+    assert(outer.hasScope && outer.registerCount == 1);
+    assertRegisterInstructions(bytecode.functions[0]->instructions, {{RegisterOpcode::GET_SCOPED, 0, 0, 0},
+                                                                     {RegisterOpcode::RETURN, 0}});
+
+    std::cout << "REGISTER COMPILER TESTS PASSED!" << std::endl;
+}
+
+void testSuperinstructions()
+{
+    using code::make;
+
+    std::cout << "-------------[Superinstruction Test]------------\n";
+
+    // Sequences are ranked by their rarest pair, ties in the order of superinstructions. Ones that never ran
+    // aren't picked.
+    code::Profile profile;
+    profile.pairs[code::GET_LOCAL][code::CONSTANT] = 50;
+    profile.pairs[code::CONSTANT][code::LESS] = 10;
+    profile.pairs[code::LESS][code::JUMP_IF_FALSE] = 10;
+    profile.pairs[code::CONSTANT][code::SUBTRACT] = 40;
+    profile.pairs[code::GET_SCOPED][code::ADD] = 1;
+    assert((compiler::selectSuperinstructions(profile, 10) ==
+            std::vector<code::Opcode>{code::SUBTRACT_CONSTANT, code::GET_LOCAL_SUBTRACT_CONSTANT,
+                                      code::LESS_JUMP_IF_FALSE, code::GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE,
+                                      code::GET_SCOPED_ADD}));
+    assert((compiler::selectSuperinstructions(profile, 2) ==
+            std::vector<code::Opcode>{code::SUBTRACT_CONSTANT, code::GET_LOCAL_SUBTRACT_CONSTANT}));
+    assert(compiler::selectSuperinstructions(code::Profile{}, 10).empty());
+
+    std::vector<code::Opcode> all;
+    for (const code::Superinstruction &superinstruction : code::superinstructions)
+    {
+        all.push_back(superinstruction.op);
+    }
+
+    // The longest sequence wins and jumps move with their targets
+    code::Bytecode bytecode =
+        compiler::compile(*parse("funksion(n) { nese (n < 2) { kthen n; } perndryshe { n - 1 } }(3) + 1"));
+    compiler::fuseSuperinstructions(bytecode, all);
+    assertInstructions(bytecode.program.instructions,
+                       concat({make(code::CLOSURE, {0}), make(code::CONSTANT, {2}), make(code::CALL, {1}),
+                               make(code::ADD_CONSTANT, {1}), make(code::RETURN_VALUE)}));
+    // 0000 GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE, 0011 GET_LOCAL, 0014 RETURN_VALUE, 0015 JUMP,
+    // 0020 GET_LOCAL_SUBTRACT_CONSTANT, 0027 RETURN_VALUE
+    assertInstructions(bytecode.functions[0]->instructions,
+                       concat({make(code::GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE, {0, 0, 20}),
+                               make(code::GET_LOCAL, {0}), make(code::RETURN_VALUE), make(code::JUMP, {27}),
+                               make(code::GET_LOCAL_SUBTRACT_CONSTANT, {0, 1}), make(code::RETURN_VALUE)}));
+
+    // A jump lands on the ADD, the CONSTANT before it stays apart
+    bytecode = compiler::compile(*parse("funksion(x, c) { x + nese (c) { 1 } perndryshe { 2 } }"));
+    compiler::fuseSuperinstructions(bytecode, all);
+    assertInstructions(bytecode.functions[0]->instructions,
+                       concat({make(code::GET_LOCAL_GET_LOCAL, {0, 1}), make(code::JUMP_IF_FALSE, {20}),
+                               make(code::CONSTANT, {0}), make(code::JUMP, {25}), make(code::CONSTANT, {1}),
+                               make(code::ADD), make(code::RETURN_VALUE)}));
+
+    // Only the selected superinstructions are used
+    bytecode = compiler::compile(*parse("funksion(n) { n - 1 }"));
+    compiler::fuseSuperinstructions(bytecode, {code::SUBTRACT_CONSTANT});
+    assertInstructions(bytecode.functions[0]->instructions,
+                       concat({make(code::GET_LOCAL, {0}), make(code::SUBTRACT_CONSTANT, {0}),
+                               make(code::RETURN_VALUE)}));
+
+    std::cout << "SUPERINSTRUCTION TESTS PASSED!" << std::endl;
+}
+
+int main()
+{
+    testProgramInstructions();
+    testFunctions();
+    testOperandEncoding();
+    testRegisterInstructions();
+    testSuperinstructions();
+
+    return 0;
+}
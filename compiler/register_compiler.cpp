@@ -0,0 +1,454 @@
+#include "register_compiler.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include "compiler.hpp"
+#include "resolver.hpp"
+
+using code::RegisterOpcode;
+
+namespace
+{
+    // Register opcode of every infix operator, indexed by the operator. Prefix operators and NONE have none.
+    constexpr std::array<RegisterOpcode, ast::OPERATOR_COUNT + 1> infixOpcodes{
+        RegisterOpcode::ADD, RegisterOpcode::SUBTRACT, RegisterOpcode::MULTIPLY, RegisterOpcode::DIVIDE,
+        RegisterOpcode::COUNT, RegisterOpcode::LESS, RegisterOpcode::GREATER, RegisterOpcode::EQUAL,
+        RegisterOpcode::NOT_EQUAL, RegisterOpcode::LESS_EQUAL, RegisterOpcode::GREATER_EQUAL, RegisterOpcode::COUNT};
+
+    // Target of statements whose value is dropped
+    constexpr uint16_t NO_REGISTER = std::numeric_limits<uint16_t>::max();
+
+    // Returns whether evaluating the expression may run a var statement of the current call, only the blocks of
+    // if expressions hold statements
+    bool mayBindSlots(const ast::Expression *expression)
+    {
+        if (!expression)
+        {
+            return false;
+        }
+
+        switch (expression->kind)
+        {
+        case ast::NodeKind::IF_EXPRESSION:
+            return true;
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            return mayBindSlots(static_cast<const ast::PrefixExpression *>(expression)->right);
+        case ast::NodeKind::INFIX_EXPRESSION:
+        {
+            auto *infix = static_cast<const ast::InfixExpression *>(expression);
+            return mayBindSlots(infix->left) || mayBindSlots(infix->right);
+        }
+        case ast::NodeKind::CALL_EXPRESSION:
+        {
+            auto *call = static_cast<const ast::CallExpression *>(expression);
+            return mayBindSlots(call->function) ||
+                   std::any_of(call->arguments.begin(), call->arguments.end(),
+                               [](const ast::Expression *argument)
+                               { return mayBindSlots(argument); });
+        }
+        default:
+            return false;
+        }
+    }
+
+    // Returns the value as a two byte operand, throws std::length_error if it doesn't fit
+    uint16_t narrow(size_t value)
+    {
+        if (value > std::numeric_limits<uint16_t>::max())
+        {
+            throw std::length_error("operand too wide: " + std::to_string(value));
+        }
+
+        return static_cast<uint16_t>(value);
+    }
+
+    // Compiles one program, keeping the function being compiled and the registers its temporaries take
+    class RegisterCompiler
+    {
+    public:
+        explicit RegisterCompiler(code::RegisterBytecode &bytecode) : bytecode{bytecode}
+        {
+        }
+
+        void compileProgram(const ast::Program &program);
+
+    private:
+        code::RegisterBytecode &bytecode;
+        std::unordered_map<int64_t, uint32_t> constantIndexes;
+
+        code::RegisterFunction *function = nullptr;
+
+        // First register no temporary holds. Temporaries are freed in the reverse order they were allocated,
+        // by setting it back.
+        uint16_t nextRegister = 0;
+
+        void emit(RegisterOpcode op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0);
+        void emitBx(RegisterOpcode op, uint16_t a, uint32_t bx);
+        size_t emitJump(RegisterOpcode op, uint16_t a = 0);
+        void patchJump(size_t jump);
+
+        uint32_t addConstant(int64_t value);
+        uint16_t allocate();
+
+        // Compiles the statements of a program or function and returns the value of the last one
+        void compileBody(const ast::NodeList<ast::Statement> &statements);
+
+        // Compiles the statements to leave the value of the last one in the target, NOTHING if it has none
+        void compileStatements(const ast::NodeList<ast::Statement> &statements, uint16_t target);
+        void compileStatement(const ast::Statement *statement, uint16_t target);
+        void compileExpression(const ast::Expression *expression, uint16_t target);
+
+        // Returns an RK operand holding the value of the expression: an integer constant, the slot of a local
+        // variable if slots are allowed, or else a new temporary the expression is compiled into
+        uint16_t compileOperand(const ast::Expression *expression, bool slotAllowed);
+
+        void compileIdentifier(const ast::Identifier *identifier, uint16_t target);
+        void compileInfix(const ast::InfixExpression *infix, uint16_t target);
+        void compileIf(const ast::IfExpression *ifExpression, uint16_t target);
+        void compileCall(const ast::CallExpression *call, uint16_t target);
+        void compileFunction(const ast::FunctionLiteral *literal, uint16_t target);
+    };
+}
+
+void RegisterCompiler::emit(RegisterOpcode op, uint16_t a, uint16_t b, uint16_t c)
+{
+    function->instructions.push_back(code::RegisterInstruction{op, a, b, c});
+}
+
+void RegisterCompiler::emitBx(RegisterOpcode op, uint16_t a, uint32_t bx)
+{
+    function->instructions.push_back(code::makeBx(op, a, bx));
+}
+
+size_t RegisterCompiler::emitJump(RegisterOpcode op, uint16_t a)
+{
+    emitBx(op, a, 0);
+    return function->instructions.size() - 1;
+}
+
+void RegisterCompiler::patchJump(size_t jump)
+{
+    code::RegisterInstruction &instruction = function->instructions[jump];
+    instruction = code::makeBx(instruction.op, instruction.a, static_cast<uint32_t>(function->instructions.size()));
+}
+
+uint32_t RegisterCompiler::addConstant(int64_t value)
+{
+    const auto [found, inserted] = constantIndexes.try_emplace(value, static_cast<uint32_t>(bytecode.constants.size()));
+    if (inserted)
+    {
+        bytecode.constants.push_back(value);
+    }
+
+    return found->second;
+}
+
+uint16_t RegisterCompiler::allocate()
+{
+    // Registers from CONSTANT_OPERAND on would read as constants
+    if (nextRegister >= code::CONSTANT_OPERAND)
+    {
+        throw std::length_error("function needs too many registers");
+    }
+
+    function->registerCount = std::max<uint32_t>(function->registerCount, nextRegister + 1);
+    return nextRegister++;
+}
+
+void RegisterCompiler::compileProgram(const ast::Program &program)
+{
+    function = &bytecode.program;
+    nextRegister = 0;
+    compileBody(program.statements);
+}
+
+void RegisterCompiler::compileBody(const ast::NodeList<ast::Statement> &statements)
+{
+    const uint16_t result = allocate();
+    compileStatements(statements, result);
+
+    // A return statement at the end already returned its value
+    if (statements.empty() || statements.back()->kind != ast::NodeKind::RETURN_STATEMENT)
+    {
+        emit(RegisterOpcode::RETURN, result);
+    }
+}
+
+void RegisterCompiler::compileStatements(const ast::NodeList<ast::Statement> &statements, uint16_t target)
+{
+    if (statements.empty())
+    {
+        if (target != NO_REGISTER)
+        {
+            emit(RegisterOpcode::LOAD_NOTHING, target);
+        }
+        return;
+    }
+
+    for (size_t index = 0; index < statements.size(); ++index)
+    {
+        compileStatement(statements[index], index + 1 == statements.size() ? target : NO_REGISTER);
+    }
+}
+
+void RegisterCompiler::compileStatement(const ast::Statement *statement, uint16_t target)
+{
+    const uint16_t mark = nextRegister;
+
+    switch (statement->kind)
+    {
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        compileExpression(static_cast<const ast::ExpressionStatement *>(statement)->expression,
+                          target != NO_REGISTER ? target : allocate());
+        break;
+
+    case ast::NodeKind::VAR_STATEMENT:
+    {
+        auto *varStatement = static_cast<const ast::VarStatement *>(statement);
+        const uint16_t value = allocate();
+        compileExpression(varStatement->expression, value);
+
+        const ast::Identifier *name = varStatement->name;
+        if (name->depth != 0)
+        {
+            emitBx(RegisterOpcode::SET_GLOBAL, value, name->symbol);
+        }
+        else
+        {
+            emit(function->hasScope ? RegisterOpcode::SET_SCOPED : RegisterOpcode::SET_LOCAL, name->slot, value);
+        }
+
+        if (target != NO_REGISTER)
+        {
+            emit(RegisterOpcode::LOAD_NOTHING, target);
+        }
+        break;
+    }
+
+    case ast::NodeKind::RETURN_STATEMENT:
+    {
+        // Slots are read unchecked only by binary operators, so the value goes through a temporary
+        const uint16_t value = allocate();
+        compileExpression(static_cast<const ast::ReturnStatement *>(statement)->returnValue, value);
+        emit(RegisterOpcode::RETURN, value);
+        break;
+    }
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        compileStatements(static_cast<const ast::BlockStatement *>(statement)->statements, target);
+        break;
+
+    default:
+        if (target != NO_REGISTER)
+        {
+            emit(RegisterOpcode::LOAD_NOTHING, target);
+        }
+        break;
+    }
+
+    nextRegister = mark;
+}
+
+void RegisterCompiler::compileExpression(const ast::Expression *expression, uint16_t target)
+{
+    // Expressions the parser gave up on are missing from the tree
+    if (!expression)
+    {
+        emit(RegisterOpcode::LOAD_NOTHING, target);
+        return;
+    }
+
+    switch (expression->kind)
+    {
+    case ast::NodeKind::INTEGER_LITERAL:
+        emitBx(RegisterOpcode::LOAD_CONSTANT, target,
+               addConstant(static_cast<const ast::IntegerLiteral *>(expression)->value));
+        return;
+
+    case ast::NodeKind::BOOLEAN:
+        emit(RegisterOpcode::LOAD_BOOLEAN, target, static_cast<const ast::Boolean *>(expression)->value);
+        return;
+
+    case ast::NodeKind::IDENTIFIER:
+        compileIdentifier(static_cast<const ast::Identifier *>(expression), target);
+        return;
+
+    case ast::NodeKind::PREFIX_EXPRESSION:
+    {
+        auto *prefix = static_cast<const ast::PrefixExpression *>(expression);
+        compileExpression(prefix->right, target);
+        if (prefix->op != ast::Operator::MINUS && prefix->op != ast::Operator::NOT)
+        {
+            throw std::invalid_argument("unknown prefix operator " + std::string(ast::toString(prefix->op)));
+        }
+
+        emit(prefix->op == ast::Operator::MINUS ? RegisterOpcode::MINUS : RegisterOpcode::NOT, target, target);
+        return;
+    }
+
+    case ast::NodeKind::INFIX_EXPRESSION:
+        compileInfix(static_cast<const ast::InfixExpression *>(expression), target);
+        return;
+
+    case ast::NodeKind::IF_EXPRESSION:
+        compileIf(static_cast<const ast::IfExpression *>(expression), target);
+        return;
+
+    case ast::NodeKind::FUNCTION_LITERAL:
+        compileFunction(static_cast<const ast::FunctionLiteral *>(expression), target);
+        return;
+
+    case ast::NodeKind::CALL_EXPRESSION:
+        compileCall(static_cast<const ast::CallExpression *>(expression), target);
+        return;
+
+    default:
+        emit(RegisterOpcode::LOAD_NOTHING, target);
+        return;
+    }
+}
+
+uint16_t RegisterCompiler::compileOperand(const ast::Expression *expression, bool slotAllowed)
+{
+    if (expression && expression->kind == ast::NodeKind::INTEGER_LITERAL)
+    {
+        const uint32_t index = addConstant(static_cast<const ast::IntegerLiteral *>(expression)->value);
+        if (index < code::CONSTANT_OPERAND)
+        {
+            return code::CONSTANT_OPERAND | index;
+        }
+    }
+    else if (slotAllowed && expression && expression->kind == ast::NodeKind::IDENTIFIER && !function->hasScope)
+    {
+        // The machine looks an unbound slot up further out when the operands aren't both integers
+        auto *identifier = static_cast<const ast::Identifier *>(expression);
+        if (identifier->depth == 0)
+        {
+            return static_cast<uint16_t>(identifier->slot);
+        }
+    }
+
+    const uint16_t operand = allocate();
+    compileExpression(expression, operand);
+    return operand;
+}
+
+void RegisterCompiler::compileIdentifier(const ast::Identifier *identifier, uint16_t target)
+{
+    if (identifier->depth == ast::GLOBAL_DEPTH)
+    {
+        emitBx(RegisterOpcode::GET_GLOBAL, target, identifier->symbol);
+    }
+    else if (identifier->depth == ast::UNRESOLVED_DEPTH)
+    {
+        emitBx(RegisterOpcode::GET_NAME, target, identifier->symbol);
+    }
+    else if (function->hasScope)
+    {
+        emit(RegisterOpcode::GET_SCOPED, target, narrow(identifier->depth), narrow(identifier->slot));
+    }
+    else if (identifier->depth == 0)
+    {
+        emit(RegisterOpcode::GET_LOCAL, target, narrow(identifier->slot));
+    }
+    else
+    {
+        // Calls without a scope of their own start from the scope of the closure, one function further out
+        emit(RegisterOpcode::GET_SCOPED, target, narrow(identifier->depth - 1), narrow(identifier->slot));
+    }
+}
+
+void RegisterCompiler::compileInfix(const ast::InfixExpression *infix, uint16_t target)
+{
+    const RegisterOpcode op = infixOpcodes[static_cast<size_t>(infix->op)];
+    if (op == RegisterOpcode::COUNT)
+    {
+        throw std::invalid_argument("unknown infix operator " + std::string(ast::toString(infix->op)));
+    }
+
+    // A slot named as the left operand is read after the right one ran, which mustn't be able to bind it
+    const uint16_t mark = nextRegister;
+    const uint16_t left = compileOperand(infix->left, !mayBindSlots(infix->right));
+    const uint16_t right = compileOperand(infix->right, true);
+    nextRegister = mark;
+
+    emit(op, target, left, right);
+}
+
+void RegisterCompiler::compileIf(const ast::IfExpression *ifExpression, uint16_t target)
+{
+    // The condition is done with before either branch writes the target
+    compileExpression(ifExpression->condition, target);
+    const size_t jumpToAlternative = emitJump(RegisterOpcode::JUMP_IF_FALSE, target);
+
+    compileStatements(ifExpression->consequence->statements, target);
+    const size_t jumpToEnd = emitJump(RegisterOpcode::JUMP);
+
+    patchJump(jumpToAlternative);
+    if (ifExpression->alternative)
+    {
+        compileStatements(ifExpression->alternative->statements, target);
+    }
+    else
+    {
+        emit(RegisterOpcode::LOAD_NULL, target);
+    }
+    patchJump(jumpToEnd);
+}
+
+void RegisterCompiler::compileCall(const ast::CallExpression *call, uint16_t target)
+{
+    // The callee and its arguments take consecutive registers, starting at the target when no temporary follows it
+    const uint16_t mark = nextRegister;
+    const uint16_t callee = target + 1 == nextRegister ? target : allocate();
+
+    compileExpression(call->function, callee);
+    for (const ast::Expression *argument : call->arguments)
+    {
+        compileExpression(argument, allocate());
+    }
+
+    emit(RegisterOpcode::CALL, callee, narrow(call->arguments.size()));
+    if (callee != target)
+    {
+        emit(RegisterOpcode::MOVE, target, callee);
+    }
+
+    nextRegister = mark;
+}
+
+void RegisterCompiler::compileFunction(const ast::FunctionLiteral *literal, uint16_t target)
+{
+    auto compiled = std::make_unique<code::RegisterFunction>();
+    compiler::describeFunction(literal, *compiled);
+
+    // The slots of calls without a scope are their first registers
+    compiled->registerCount = compiled->hasScope ? 0 : compiled->slotCount;
+
+    code::RegisterFunction *enclosing = std::exchange(function, compiled.get());
+    const uint16_t enclosingRegister = std::exchange(nextRegister, static_cast<uint16_t>(compiled->registerCount));
+
+    compileBody(literal->body->statements);
+
+    function = enclosing;
+    nextRegister = enclosingRegister;
+
+    bytecode.functions.push_back(std::move(compiled));
+    emitBx(RegisterOpcode::CLOSURE, target, static_cast<uint32_t>(bytecode.functions.size() - 1));
+}
+
+code::RegisterBytecode compiler::compileToRegisters(ast::Program &program)
+{
+    resolver::resolve(program);
+
+    code::RegisterBytecode bytecode;
+    bytecode.arena = program.arena;
+    bytecode.source = program.source;
+
+    RegisterCompiler compiler(bytecode);
+    compiler.compileProgram(program);
+
+    return bytecode;
+}
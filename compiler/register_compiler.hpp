@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ast.hpp"
+#include "register_code.hpp"
+
+namespace compiler
+{
+    // Lowers the program to three address code for vm::RegisterVM, resolving its variables first if that wasn't
+    // done yet. Variables live where compile puts them, the slots of functions without a scope being the first
+    // registers of their calls. Temporaries take the registers after the slots in stack order, and binary operators
+    // name the slots and integer constants they read directly instead of loading them first.
+    // Throws std::length_error if a function needs more registers or arguments than an operand can name.
+    code::RegisterBytecode compileToRegisters(ast::Program &program);
+}
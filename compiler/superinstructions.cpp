@@ -0,0 +1,161 @@
+#include "superinstructions.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    // Returns the offset within an instruction of its operand holding a jump target, 0 if it has none
+    size_t jumpOperandOffset(code::Opcode op)
+    {
+        if (op == code::JUMP || op == code::JUMP_IF_FALSE)
+        {
+            return 1;
+        }
+
+        if (op < code::GET_LOCAL_GET_LOCAL)
+        {
+            return 0;
+        }
+
+        // Jumps end the sequences of the superinstructions that hold one
+        const code::Superinstruction &superinstruction = code::superinstructions[op - code::GET_LOCAL_GET_LOCAL];
+        if (superinstruction.sequence[superinstruction.length - 1] != code::JUMP_IF_FALSE)
+        {
+            return 0;
+        }
+
+        return code::instructionWidth(op) - sizeof(uint32_t);
+    }
+
+    // Returns whether the instructions starting at index are the superinstruction's sequence, with no jump
+    // landing after its first instruction
+    bool matches(const code::Instructions &instructions, const std::vector<size_t> &offsets,
+                 const std::vector<bool> &isJumpTarget, size_t index, const code::Superinstruction &superinstruction)
+    {
+        if (index + superinstruction.length > offsets.size())
+        {
+            return false;
+        }
+
+        for (uint8_t step = 0; step < superinstruction.length; ++step)
+        {
+            const size_t offset = offsets[index + step];
+            if (instructions[offset] != superinstruction.sequence[step] || (step > 0 && isJumpTarget[offset]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void fuse(code::CompiledFunction &function, const std::vector<const code::Superinstruction *> &candidates)
+    {
+        const code::Instructions &instructions = function.instructions;
+
+        // Offset of every instruction, and whether a jump lands on it
+        std::vector<size_t> offsets;
+        std::vector<bool> isJumpTarget(instructions.size() + 1);
+        for (size_t offset = 0; offset < instructions.size();
+             offset += code::instructionWidth(static_cast<code::Opcode>(instructions[offset])))
+        {
+            offsets.push_back(offset);
+            if (const size_t jumpOperand = jumpOperandOffset(static_cast<code::Opcode>(instructions[offset])))
+            {
+                isJumpTarget[code::readUint32(&instructions[offset + jumpOperand])] = true;
+            }
+        }
+
+        // Instructions are copied with their operands, those of a sequence are the operands of its superinstruction
+        code::Instructions fused;
+        fused.reserve(instructions.size());
+        std::vector<uint32_t> fusedOffsets(instructions.size() + 1);
+        std::vector<size_t> jumpOperands; // Offsets in fused of jump targets that are still offsets in instructions
+        for (size_t index = 0; index < offsets.size();)
+        {
+            const code::Superinstruction *match = nullptr;
+            for (const code::Superinstruction *candidate : candidates)
+            {
+                if (matches(instructions, offsets, isJumpTarget, index, *candidate))
+                {
+                    match = candidate;
+                    break;
+                }
+            }
+            const uint8_t length = match ? match->length : 1;
+
+            fusedOffsets[offsets[index]] = static_cast<uint32_t>(fused.size());
+            fused.push_back(match ? static_cast<uint8_t>(match->op) : instructions[offsets[index]]);
+            for (uint8_t step = 0; step < length; ++step, ++index)
+            {
+                const size_t offset = offsets[index];
+                const auto op = static_cast<code::Opcode>(instructions[offset]);
+                if (const size_t jumpOperand = jumpOperandOffset(op))
+                {
+                    jumpOperands.push_back(fused.size() + jumpOperand - 1);
+                }
+                fused.insert(fused.end(), instructions.begin() + offset + 1,
+                             instructions.begin() + offset + code::instructionWidth(op));
+            }
+        }
+        fusedOffsets[instructions.size()] = static_cast<uint32_t>(fused.size());
+
+        for (const size_t jumpOperand : jumpOperands)
+        {
+            code::patchUint32(fused, jumpOperand, fusedOffsets[code::readUint32(&fused[jumpOperand])]);
+        }
+
+        // The superinstructions push no more than their sequences did, maxStackDepth still holds
+        function.instructions = std::move(fused);
+    }
+}
+
+std::vector<code::Opcode> compiler::selectSuperinstructions(const code::Profile &profile, size_t limit)
+{
+    std::vector<std::pair<uint64_t, code::Opcode>> ranked;
+    for (const code::Superinstruction &superinstruction : code::superinstructions)
+    {
+        uint64_t count = std::numeric_limits<uint64_t>::max();
+        for (uint8_t step = 0; step + 1 < superinstruction.length; ++step)
+        {
+            count = std::min(count,
+                             profile.pairs[superinstruction.sequence[step]][superinstruction.sequence[step + 1]]);
+        }
+
+        if (count > 0)
+        {
+            ranked.emplace_back(count, superinstruction.op);
+        }
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const auto &a, const auto &b)
+                     { return a.first > b.first; });
+    ranked.resize(std::min(ranked.size(), limit));
+
+    std::vector<code::Opcode> selected;
+    for (const auto &[count, op] : ranked)
+    {
+        selected.push_back(op);
+    }
+
+    return selected;
+}
+
+void compiler::fuseSuperinstructions(code::Bytecode &bytecode, const std::vector<code::Opcode> &selected)
+{
+    std::vector<const code::Superinstruction *> candidates;
+    for (const code::Opcode op : selected)
+    {
+        candidates.push_back(&code::superinstructions[op - code::GET_LOCAL_GET_LOCAL]);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const code::Superinstruction *a, const code::Superinstruction *b)
+                     { return a->length > b->length; });
+
+    fuse(bytecode.program, candidates);
+    for (const std::unique_ptr<code::CompiledFunction> &function : bytecode.functions)
+    {
+        fuse(*function, candidates);
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "code.hpp"
+
+namespace compiler
+{
+    // Picks up to limit superinstructions whose sequences ran in the profile, the most frequent first. A sequence
+    // ran at most as often as the rarest pair of neighbouring instructions in it, which is what it is ranked by.
+    std::vector<code::Opcode> selectSuperinstructions(const code::Profile &profile, size_t limit);
+
+    // Replaces the sequences of the selected superinstructions with them in the program and every function, the
+    // longest sequence first where several start at an instruction. Sequences no jump lands inside of are replaced
+    // only, and jumps are moved to the offsets their targets end up at.
+    void fuseSuperinstructions(code::Bytecode &bytecode, const std::vector<code::Opcode> &selected);
+}
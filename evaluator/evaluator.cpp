@@ -1,20 +1,150 @@
 #include "evaluator.hpp"
+#include <array>
+#include <functional>
+#include "resolver.hpp"
+
+namespace
+{
+    // Evaluates an infix operator on operands of the types it is looked up by. Every operation gets the operator
+    // so the ones reporting errors can name it.
+    using BinaryOperation = object::Object *(*)(ast::Operator op, object::Object *left, object::Object *right);
+
+    int64_t integerValue(object::Object *obj)
+    {
+        return static_cast<object::Integer *>(obj)->value;
+    }
+
+    bool booleanValue(object::Object *obj)
+    {
+        return static_cast<object::Boolean *>(obj)->value;
+    }
+
+    template <class Operation>
+    object::Object *integerArithmetic(ast::Operator, object::Object *left, object::Object *right)
+    {
+        return new object::Integer(Operation{}(integerValue(left), integerValue(right)));
+    }
+
+    template <class Comparison>
+    object::Object *integerComparison(ast::Operator, object::Object *left, object::Object *right)
+    {
+        return new object::Boolean(Comparison{}(integerValue(left), integerValue(right)));
+    }
+
+    template <class Comparison>
+    object::Object *booleanComparison(ast::Operator, object::Object *left, object::Object *right)
+    {
+        return new object::Boolean(Comparison{}(booleanValue(left), booleanValue(right)));
+    }
+
+    object::Object *typeMismatch(ast::Operator op, object::Object *left, object::Object *right)
+    {
+        return evaluator::newError(object::TYPE_MISMATCH_ERR, left->type(), op, right->type());
+    }
+
+    object::Object *unknownOperator(ast::Operator op, object::Object *left, object::Object *right)
+    {
+        return evaluator::newError(object::UNKNOWN_OP_ERR, left->type(), op, right->type());
+    }
+
+    // Indexed by operator, left operand type and right operand type. NONE gets a row too, so any operator
+    // an infix expression can hold is in bounds.
+    using BinaryOperationTable = std::array<
+        std::array<std::array<BinaryOperation, object::OBJECT_TYPE_COUNT>, object::OBJECT_TYPE_COUNT>,
+        ast::OPERATOR_COUNT + 1>;
+
+    constexpr BinaryOperationTable makeBinaryOperations()
+    {
+        BinaryOperationTable table{};
+
+        // Operands of different types are a type mismatch, any operator not listed below is unknown for its types
+        for (auto &leftTypes : table)
+        {
+            for (size_t left = 0; left < object::OBJECT_TYPE_COUNT; ++left)
+            {
+                for (size_t right = 0; right < object::OBJECT_TYPE_COUNT; ++right)
+                {
+                    leftTypes[left][right] = left == right ? unknownOperator : typeMismatch;
+                }
+            }
+        }
+
+        const auto integers = [&table](ast::Operator op) -> BinaryOperation &
+        {
+            return table[static_cast<size_t>(op)][object::INTEGER_OBJ][object::INTEGER_OBJ];
+        };
+        integers(ast::Operator::PLUS) = integerArithmetic<std::plus<int64_t>>;
+        integers(ast::Operator::MINUS) = integerArithmetic<std::minus<int64_t>>;
+        integers(ast::Operator::MULTIPLY) = integerArithmetic<std::multiplies<int64_t>>;
+        integers(ast::Operator::DIVIDE) = integerArithmetic<std::divides<int64_t>>;
+        integers(ast::Operator::LESS) = integerComparison<std::less<int64_t>>;
+        integers(ast::Operator::GREATER) = integerComparison<std::greater<int64_t>>;
+        integers(ast::Operator::EQUAL) = integerComparison<std::equal_to<int64_t>>;
+        integers(ast::Operator::NOT_EQUAL) = integerComparison<std::not_equal_to<int64_t>>;
+        integers(ast::Operator::LESS_EQUAL) = integerComparison<std::less_equal<int64_t>>;
+        integers(ast::Operator::GREATER_EQUAL) = integerComparison<std::greater_equal<int64_t>>;
+
+        const auto booleans = [&table](ast::Operator op) -> BinaryOperation &
+        {
+            return table[static_cast<size_t>(op)][object::BOOLEAN_OBJ][object::BOOLEAN_OBJ];
+        };
+        booleans(ast::Operator::EQUAL) = booleanComparison<std::equal_to<bool>>;
+        booleans(ast::Operator::NOT_EQUAL) = booleanComparison<std::not_equal_to<bool>>;
+
+        return table;
+    }
+
+    constexpr BinaryOperationTable binaryOperations = makeBinaryOperations();
+
+    // Only the evaluating thread counts, see InlineCacheStatistics
+    evaluator::InlineCacheStatistics inlineCacheStatistics;
+
+    // id of the environment the inline cache of an identifier is keyed by, 0 for identifiers that aren't cached.
+    // Globals are keyed by the global environment. Variables of enclosing calls are keyed by the environment the
+    // called function was made in, every call of it walks out from there to the same slot.
+    uint64_t cacheKeyOf(const ast::Identifier &identifier, const object::Environment *env)
+    {
+        if (identifier.depth == ast::GLOBAL_DEPTH)
+        {
+            return env->global->id;
+        }
+
+        if (identifier.depth == 0 || identifier.depth == ast::UNRESOLVED_DEPTH)
+        {
+            return 0;
+        }
+
+        return env->outerEnvironment->id;
+    }
+}
 
 object::Object *evaluator::evaluate(ast::Node *node, object::Environment *env)
 {
+    // Expressions the parser gave up on are missing from the tree
+    if (!node)
+    {
+        return nullptr;
+    }
+
+    switch (node->kind)
+    {
     // Statements
-    if (auto *program = dynamic_cast<ast::Program *>(node))
+    case ast::NodeKind::PROGRAM:
+    {
+        auto *program = static_cast<ast::Program *>(node);
+        resolver::resolve(*program);
         return evaluateProgram(program->statements, env);
+    }
 
-    if (auto *blockStatement = dynamic_cast<ast::BlockStatement *>(node))
-        return evaluateBlockStatements(blockStatement->statements, env);
+    case ast::NodeKind::BLOCK_STATEMENT:
+        return evaluateBlockStatements(static_cast<ast::BlockStatement *>(node)->statements, env);
 
-    if (auto *expStatement = dynamic_cast<ast::ExpressionStatement *>(node))
-        return evaluate(expStatement->expression, env);
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return evaluate(static_cast<ast::ExpressionStatement *>(node)->expression, env);
 
-    if (auto *returnStatement = dynamic_cast<ast::ReturnStatement *>(node))
+    case ast::NodeKind::RETURN_STATEMENT:
     {
-        object::Object *returnVal = evaluate(returnStatement->returnValue, env);
+        object::Object *returnVal = evaluate(static_cast<ast::ReturnStatement *>(node)->returnValue, env);
         if (isError(returnVal))
         {
             return returnVal;
@@ -23,27 +153,39 @@ object::Object *evaluator::evaluate(ast::Node *node, object::Environment *env)
         return new object::ReturnValue(returnVal);
     }
 
-    if (auto *varStatement = dynamic_cast<ast::VarStatement *>(node))
+    case ast::NodeKind::VAR_STATEMENT:
     {
+        auto *varStatement = static_cast<ast::VarStatement *>(node);
         object::Object *value = evaluate(varStatement->expression, env);
         if (isError(value))
         {
             return value;
         }
 
-        env->set(varStatement->name->value, value);
+        // Var statements of a function write to the slot of their name in the function's call
+        const ast::Identifier *name = varStatement->name;
+        if (name->depth == 0)
+        {
+            env->setSlot(name->slot, value);
+        }
+        else
+        {
+            env->set(name->symbol, value);
+        }
+        return nullptr;
     }
 
     // Expressions
-    if (auto *integer = dynamic_cast<ast::IntegerLiteral *>(node))
-        return new object::Integer(integer->value);
+    case ast::NodeKind::INTEGER_LITERAL:
+        return new object::Integer(static_cast<ast::IntegerLiteral *>(node)->value);
 
-    if (auto *boolean = dynamic_cast<ast::Boolean *>(node))
+    case ast::NodeKind::BOOLEAN:
         // NOTE: Booleans can be singletons in the future if GC is decided to be implemented
-        return new object::Boolean(boolean->value);
+        return new object::Boolean(static_cast<ast::Boolean *>(node)->value);
 
-    if (auto *prefixExpression = dynamic_cast<ast::PrefixExpression *>(node))
+    case ast::NodeKind::PREFIX_EXPRESSION:
     {
+        auto *prefixExpression = static_cast<ast::PrefixExpression *>(node);
         object::Object *right = evaluate(prefixExpression->right, env);
         if (isError(right))
         {
@@ -53,8 +195,9 @@ object::Object *evaluator::evaluate(ast::Node *node, object::Environment *env)
         return evaluatePrefixExpression(prefixExpression->op, right);
     }
 
-    if (auto *infixExpression = dynamic_cast<ast::InfixExpression *>(node))
+    case ast::NodeKind::INFIX_EXPRESSION:
     {
+        auto *infixExpression = static_cast<ast::InfixExpression *>(node);
         object::Object *left = evaluate(infixExpression->left, env);
         if (isError(left))
         {
@@ -70,23 +213,27 @@ object::Object *evaluator::evaluate(ast::Node *node, object::Environment *env)
         return evaluateInfixExpression(infixExpression->op, left, right);
     }
 
-    if (auto *ifExpression = dynamic_cast<ast::IfExpression *>(node))
-    {
-        return evaluateIfStatement(ifExpression, env);
-    }
+    case ast::NodeKind::IF_EXPRESSION:
+        return evaluateIfStatement(static_cast<ast::IfExpression *>(node), env);
 
-    if (auto *identifier = dynamic_cast<ast::Identifier *>(node))
-    {
-        return evaluateIdentifier(identifier, env);
-    }
+    case ast::NodeKind::IDENTIFIER:
+        return evaluateIdentifier(static_cast<ast::Identifier *>(node), env);
 
-    if (auto *func = dynamic_cast<ast::FunctionLiteral *>(node))
+    case ast::NodeKind::FUNCTION_LITERAL:
     {
-        return new object::Function(func->parameters, func->body, env);
+        auto *func = static_cast<ast::FunctionLiteral *>(node);
+        if (!func->resolved)
+        {
+            // Only literals of a program that was never evaluated as a whole get here
+            resolver::resolve(*func);
+        }
+
+        return new object::Function(func, env);
     }
 
-    if (auto *callExpression = dynamic_cast<ast::CallExpression *>(node))
+    case ast::NodeKind::CALL_EXPRESSION:
     {
+        auto *callExpression = static_cast<ast::CallExpression *>(node);
         object::Object *func = evaluate(callExpression->function, env);
         if (isError(func))
         {
@@ -101,14 +248,15 @@ object::Object *evaluator::evaluate(ast::Node *node, object::Environment *env)
 
         return callFunction(func, args);
     }
+    }
 
     return nullptr;
 }
 
-object::Object *evaluator::evaluateProgram(const std::vector<ast::Statement *> &statements,
+object::Object *evaluator::evaluateProgram(const ast::NodeList<ast::Statement> &statements,
                                            object::Environment *env)
 {
-    object::Object *result;
+    object::Object *result = nullptr;
 
     for (auto *statement : statements)
     {
@@ -128,10 +276,10 @@ object::Object *evaluator::evaluateProgram(const std::vector<ast::Statement *> &
     return result;
 }
 
-object::Object *evaluator::evaluateBlockStatements(const std::vector<ast::Statement *> &statements,
+object::Object *evaluator::evaluateBlockStatements(const ast::NodeList<ast::Statement> &statements,
                                                    object::Environment *env)
 {
-    object::Object *result;
+    object::Object *result = nullptr;
 
     for (auto *statement : statements)
     {
@@ -148,13 +296,13 @@ object::Object *evaluator::evaluateBlockStatements(const std::vector<ast::Statem
     return result;
 }
 
-object::Object *evaluator::evaluatePrefixExpression(std::string_view op, object::Object *rightExpression)
+object::Object *evaluator::evaluatePrefixExpression(ast::Operator op, object::Object *rightExpression)
 {
-    switch (op.front())
+    switch (op)
     {
-    case '!':
+    case ast::Operator::NOT:
         return evaluateBangOperatorExpression(rightExpression);
-    case '-':
+    case ast::Operator::MINUS:
         return evaluateMinusPrefixOperatorExpression(rightExpression);
     default:
         return newError(object::UNKNOWN_OP_ERR, op, rightExpression->type());
@@ -189,69 +337,9 @@ object::Object *evaluator::evaluateMinusPrefixOperatorExpression(object::Object
     return integer;
 }
 
-object::Object *evaluator::evaluateInfixExpression(std::string_view op, object::Object *left, object::Object *right)
-{
-    if (left->type() == object::INTEGER_OBJ && right->type() == object::INTEGER_OBJ)
-    {
-        return evaluateInfixIntegerExpression(op, left, right);
-    }
-
-    if (left->type() == object::BOOLEAN_OBJ && right->type() == object::BOOLEAN_OBJ)
-    {
-        return evaluateInfixBooleanExpression(op, left, right);
-    }
-
-    if (left->type() != right->type())
-    {
-        return newError(object::TYPE_MISMATCH_ERR, left->type(), op, right->type());
-    }
-
-    return newError(object::UNKNOWN_OP_ERR, left->type(), op, right->type());
-}
-
-object::Object *evaluator::evaluateInfixIntegerExpression(std::string_view op, object::Object *left, object::Object *right)
-{
-    int64_t leftValue = dynamic_cast<object::Integer *>(left)->value;
-    int64_t rightValue = dynamic_cast<object::Integer *>(right)->value;
-
-    if (op == "+")
-        return new object::Integer(leftValue + rightValue);
-    if (op == "-")
-        return new object::Integer(leftValue - rightValue);
-    if (op == "*")
-        return new object::Integer(leftValue * rightValue);
-    if (op == "/")
-        return new object::Integer(leftValue / rightValue);
-
-    if (op == "<")
-        return new object::Boolean(leftValue < rightValue);
-    if (op == ">")
-        return new object::Boolean(leftValue > rightValue);
-    if (op == "==")
-        return new object::Boolean(leftValue == rightValue);
-    if (op == "!=")
-        return new object::Boolean(leftValue != rightValue);
-    if (op == "<=")
-        return new object::Boolean(leftValue <= rightValue);
-    if (op == ">=")
-        return new object::Boolean(leftValue >= rightValue);
-
-    return newError(object::UNKNOWN_OP_ERR, left->type(), op, right->type());
-}
-
-object::Object *evaluator::evaluateInfixBooleanExpression(std::string_view op,
-                                                          object::Object *left,
-                                                          object::Object *right)
+object::Object *evaluator::evaluateInfixExpression(ast::Operator op, object::Object *left, object::Object *right)
 {
-    bool leftVal = dynamic_cast<object::Boolean *>(left)->value;
-    bool rightVal = dynamic_cast<object::Boolean *>(right)->value;
-
-    if (op == "==")
-        return new object::Boolean(leftVal == rightVal);
-    if (op == "!=")
-        return new object::Boolean(leftVal != rightVal);
-
-    return newError(object::UNKNOWN_OP_ERR, left->type(), op, right->type());
+    return binaryOperations[static_cast<size_t>(op)][left->type()][right->type()](op, left, right);
 }
 
 object::Object *evaluator::evaluateIfStatement(ast::IfExpression *expresssion,
@@ -278,7 +366,31 @@ object::Object *evaluator::evaluateIfStatement(ast::IfExpression *expresssion,
 
 object::Object *evaluator::evaluateIdentifier(ast::Identifier *identifier, object::Environment *env)
 {
-    object::Object *val = env->get(identifier->value);
+    // A slot keeps the first value bound to it, so a value found in its slot stays the value of the identifier for as
+    // long as it is read through the same environment. Keys are environment ids rather than addresses, an
+    // environment made where a deleted one was never matches the deleted one's cache.
+    if (const uint64_t key = cacheKeyOf(*identifier, env))
+    {
+        if (identifier->cacheKey == key)
+        {
+            ++inlineCacheStatistics.hits;
+            return identifier->cachedValue;
+        }
+        ++inlineCacheStatistics.misses;
+
+        object::Object *value = identifier->depth == ast::GLOBAL_DEPTH
+                                    ? env->get(*identifier)
+                                    : env->enclosing(identifier->depth)->values[identifier->slot];
+        if (value)
+        {
+            identifier->cacheKey = key;
+            identifier->cachedValue = value;
+            return value;
+        }
+    }
+
+    // Unbound slots are looked up further out by name, where the variable can still get bound closer by later
+    object::Object *val = env->get(*identifier);
 
     if (!val)
     {
@@ -288,8 +400,18 @@ object::Object *evaluator::evaluateIdentifier(ast::Identifier *identifier, objec
     return val;
 }
 
+evaluator::InlineCacheStatistics evaluator::getInlineCacheStatistics()
+{
+    return inlineCacheStatistics;
+}
+
+void evaluator::resetInlineCacheStatistics()
+{
+    inlineCacheStatistics = InlineCacheStatistics{};
+}
+
 std::vector<object::Object *> evaluator::evaluateExpressions(
-    std::vector<ast::Expression *> expressions,
+    const ast::NodeList<ast::Expression> &expressions,
     object::Environment *env)
 {
     std::vector<object::Object *> result;
@@ -326,13 +448,13 @@ object::Object *evaluator::callFunction(object::Object *function,
 object::Environment *evaluator::extendEnvironment(object::Function *function,
                                                   std::vector<object::Object *> args)
 {
-    auto *extendedEnvironment = new object::Environment(function->env);
+    auto *extendedEnvironment = new object::Environment(function->env, function->literal);
 
     for (size_t index = 0; index < function->parameters.size(); ++index)
     {
-        std::string paramName = function->parameters.at(index)->value;
+        uint32_t paramSlot = function->parameters[index]->slot;
         object::Object *paramValue = args[index];
-        extendedEnvironment->set(paramName, paramValue);
+        extendedEnvironment->setSlot(paramSlot, paramValue);
     }
 
     return extendedEnvironment;
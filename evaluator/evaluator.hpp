@@ -10,37 +10,46 @@ namespace evaluator
 {
     object::Object *evaluate(ast::Node *node, object::Environment *env);
 
-    object::Object *evaluateProgram(const std::vector<ast::Statement *> &statements,
+    object::Object *evaluateProgram(const ast::NodeList<ast::Statement> &statements,
                                     object::Environment *env);
 
-    object::Object *evaluateBlockStatements(const std::vector<ast::Statement *> &statements,
+    object::Object *evaluateBlockStatements(const ast::NodeList<ast::Statement> &statements,
                                             object::Environment *env);
 
-    object::Object *evaluatePrefixExpression(std::string_view op, object::Object *rightExpression);
+    object::Object *evaluatePrefixExpression(ast::Operator op, object::Object *rightExpression);
 
     object::Object *evaluateBangOperatorExpression(object::Object *rightExpression);
 
     object::Object *evaluateMinusPrefixOperatorExpression(object::Object *rightExpression);
 
-    object::Object *evaluateInfixExpression(std::string_view op,
+    // Evaluates left op right with one lookup in a table indexed by the operator and the types of the operands
+    object::Object *evaluateInfixExpression(ast::Operator op,
                                             object::Object *left,
                                             object::Object *right);
 
-    object::Object *evaluateInfixIntegerExpression(std::string_view op,
-                                                   object::Object *left,
-                                                   object::Object *right);
-
-    object::Object *evaluateInfixBooleanExpression(std::string_view op,
-                                                   object::Object *left,
-                                                   object::Object *right);
-
     object::Object *evaluateIfStatement(ast::IfExpression *statement,
                                         object::Environment *env);
 
+    // Reads the variable the identifier refers to. Globals and variables of enclosing calls are remembered in the
+    // identifier's inline cache once found bound, see InlineCacheStatistics.
     object::Object *evaluateIdentifier(ast::Identifier *identifier,
                                        object::Environment *env);
 
-    std::vector<object::Object *> evaluateExpressions(std::vector<ast::Expression *> expressions,
+    // Reads of globals and of variables of enclosing calls since the last reset: the ones their identifier's inline
+    // cache answered and the ones that looked the variable up. Reads of the current call's variables are not counted.
+    // The counts are process wide and not synchronized, like evaluation itself they belong to a single thread. Runs
+    // aren't told apart, reset the counts before the run they should cover.
+    struct InlineCacheStatistics
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    InlineCacheStatistics getInlineCacheStatistics();
+
+    void resetInlineCacheStatistics();
+
+    std::vector<object::Object *> evaluateExpressions(const ast::NodeList<ast::Expression> &expressions,
                                                       object::Environment *env);
 
     object::Object *callFunction(object::Object *function, std::vector<object::Object *> args);
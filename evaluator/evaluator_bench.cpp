@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "resolver.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Number of times every script is evaluated, the fastest run is reported
+constexpr int RUNS = 5;
+
+void benchmarkScript(const std::string &name, const std::string &script)
+{
+    Parser parser(new lexer::Lexer(script));
+    ast::Program *program = parser.parseProgram();
+    if (!parser.getErrors().empty())
+    {
+        std::cout << name << ": parse error " << parser.getErrors()[0] << std::endl;
+        return;
+    }
+
+    double best = 1e300;
+    std::string result;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        auto *env = new object::Environment();
+        evaluator::resetInlineCacheStatistics();
+
+        const auto start = Clock::now();
+        object::Object *evaluated = evaluator::evaluate(program, env);
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        result = evaluated ? evaluated->inspect() : "null";
+    }
+
+    // Of the last run, every run reads through a new global environment
+    const evaluator::InlineCacheStatistics statistics = evaluator::getInlineCacheStatistics();
+    std::cout << name << ": " << best << " ms (result " << result << "), inline caches " << statistics.hits
+              << " hits, " << statistics.misses << " misses" << std::endl;
+}
+
+// Evaluates single nodes of every type many times. Apart from dispatching on the node, every evaluation also
+// allocates its result and evaluates the children listed in the name.
+void benchmarkNodeDispatch()
+{
+    constexpr int CALLS = 1000000;
+
+    const std::vector<std::pair<std::string, std::string>> nodes{
+        {"integer literal", "5"},
+        {"boolean", "vertet"},
+        {"identifier", "x"},
+        {"prefix (+ integer)", "-5"},
+        {"infix (+ 2 integers)", "1 + 2"},
+        {"if (+ boolean, block, integer)", "nese (vertet) { 1 }"},
+        {"function literal", "funksion(a) { a }"},
+        {"call (+ 2 identifiers, block)", "f(x)"},
+    };
+
+    // Definitions the nodes above refer to
+    Parser definitionParser(new lexer::Lexer("var x = 5; var f = funksion(a) { a };"));
+    ast::Program *definitions = definitionParser.parseProgram();
+    auto *env = new object::Environment();
+    evaluator::evaluate(definitions, env);
+
+    std::cout << "node dispatch, " << CALLS << " evaluations each:" << std::endl;
+    for (const auto &[name, source] : nodes)
+    {
+        Parser parser(new lexer::Lexer(source));
+        ast::Program *program = parser.parseProgram();
+        resolver::resolve(*program);
+        ast::Node *node = dynamic_cast<ast::ExpressionStatement *>(program->statements[0])->expression;
+
+        double best = 1e300;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            const auto start = Clock::now();
+            for (int call = 0; call < CALLS; ++call)
+            {
+                evaluator::evaluate(node, env);
+            }
+            best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / CALLS);
+        }
+
+        std::cout << "\t" << name << ": " << best << " ns" << std::endl;
+    }
+}
+
+int main()
+{
+    benchmarkScript("fib(22)", R"(
+var fib = funksion(n) {
+    nese (n < 2) { kthen n; }
+    kthen fib(n - 1) + fib(n - 2);
+};
+fib(22);
+)");
+
+    // Many locals and parameters looked up through nested environments on every call
+    benchmarkScript("variable heavy recursion", R"(
+var hapi = 3;
+var llogarit = funksion(a, b, c, d) {
+    var x = a + b;
+    var y = c * d;
+    var z = x - y + hapi;
+    var ndihmes = funksion(p) { p + x + y + z + hapi; };
+    nese (a < 1) { kthen ndihmes(z); }
+    kthen llogarit(a - 1, b + 1, c, d) + llogarit(a - 1, b, c + 1, d) - ndihmes(x);
+};
+llogarit(15, 1, 2, 3);
+)");
+
+    // Variables of six enclosing calls and a global read at every step of a recursion
+    benchmarkScript("deeply nested closures", R"(
+var hapi = 1;
+var niveli = funksion(a) { funksion(b) { funksion(c) { funksion(d) { funksion(e) { funksion(f) {
+    var ecje = funksion(n) {
+        nese (n < 2) { kthen a + b + c + d + e + f + hapi; }
+        ecje(n - 1) + ecje(n - 2) - a - b - c - d - e - f - hapi
+    };
+    ecje(18)
+} } } } } };
+niveli(1)(2)(3)(4)(5)(6);
+)");
+
+    benchmarkNodeDispatch();
+
+    return 0;
+}
@@ -241,6 +241,64 @@ void testErrorHandling()
     }
 }
 
+void testInlineCaches()
+{
+    // Every read site of a global or of a variable of an enclosing call caches what it found bound
+    evaluator::resetInlineCacheStatistics();
+    testIntegerObject(testEvaluate("var f = funksion(n) { nese (n < 1) { 0 } perndryshe { f(n - 1) } }; f(3)"), 0);
+    evaluator::InlineCacheStatistics statistics = evaluator::getInlineCacheStatistics();
+    assert(statistics.misses == 2 && statistics.hits == 2 && "the first read of each site misses");
+
+    // The same program read through another global environment
+    auto lexer = new lexer::Lexer("a");
+    auto parser = new Parser(lexer);
+    ast::Program *program = parser->parseProgram();
+    for (int64_t value : {1, 2})
+    {
+        auto env = new object::Environment();
+        env->set(token::intern("a"), new object::Integer(value));
+        testIntegerObject(evaluator::evaluate(program, env), value);
+    }
+
+    // The environment made after one is deleted usually gets its address, it must not see what was cached through
+    // the deleted one. The values outlive the environments, which would delete them through object::Object.
+    std::vector<object::Integer *> values;
+    for (int64_t value : {3, 4})
+    {
+        auto env = new object::Environment();
+        values.push_back(new object::Integer(value));
+        env->set(token::intern("a"), values.back());
+        auto *integer = dynamic_cast<object::Integer *>(evaluator::evaluate(program, env));
+        assert(integer && integer->value == value && "read the value cached through a deleted environment");
+        env->values.assign(env->values.size(), nullptr);
+        delete env;
+    }
+    for (auto *value : values)
+    {
+        delete value;
+    }
+
+    // Closures made in different calls see their own variables
+    testIntegerObject(testEvaluate("var make = funksion(a) { funksion() { a } }; make(1)() * 10 + make(2)()"), 12);
+
+    // An unbound slot is looked up further out without caching what is found there
+    std::string input = R"(
+    var x = 5;
+    var f = funksion() {
+        var g = funksion() { x };
+        var first = g();
+        var x = 7;
+        first * 10 + g()
+    };
+    f()
+    )";
+    testIntegerObject(testEvaluate(input), 57);
+
+    evaluator::resetInlineCacheStatistics();
+    statistics = evaluator::getInlineCacheStatistics();
+    assert(statistics.hits == 0 && statistics.misses == 0);
+}
+
 int main()
 {
     testEvalIntegerExpression();
@@ -253,6 +311,7 @@ int main()
     testFunctionCall();
     testClosure();
     testErrorHandling();
+    testInlineCaches();
 
     std::cout << "EVALUATOR TESTS PASSED!" << std::endl;
 }
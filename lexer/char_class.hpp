@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "token.hpp"
+
+namespace lexer
+{
+    // Class of an input byte, decides which kind of token starts at it
+    enum CharClass : uint8_t
+    {
+        CLASS_OTHER,      // Not part of the language, lexed as TokenType::ILLEGAL
+        CLASS_END,        // '\0' marks the end of the input
+        CLASS_WHITESPACE, // Skipped between tokens
+        CLASS_LETTER,     // Starts an identifier or keyword
+        CLASS_DIGIT,      // Starts an integer literal
+        CLASS_OPERATOR,   // Starts an operator or delimiter, recognised by the operator DFA
+        CLASS_UTF8,       // Part of a multi-byte UTF-8 sequence, decoded to tell letters from illegal chars
+    };
+
+    struct OperatorSpelling
+    {
+        std::string_view literal;
+        token::TokenType type;
+    };
+
+    // Every operator and delimiter of the language, new operators are added here.
+    // Every prefix of an operator has to be an operator as well, so the DFA never has to backtrack.
+    constexpr std::array<OperatorSpelling, 18> operators{{
+        {"=", token::ASSIGN},
+        {"+", token::PLUS},
+        {"-", token::MINUS},
+        {"!", token::BANG},
+        {"*", token::ASTERISK},
+        {"/", token::SLASH},
+        {"<", token::LT},
+        {">", token::GT},
+        {"==", token::EQ},
+        {"!=", token::NOT_EQ},
+        {"<=", token::LT_EQ},
+        {">=", token::GT_EQ},
+        {",", token::COMMA},
+        {";", token::SEMICOLON},
+        {"(", token::LPAREN},
+        {")", token::RPAREN},
+        {"{", token::LBRACE},
+        {"}", token::RBRACE},
+    }};
+
+    // Class of every byte value
+    constexpr std::array<CharClass, 256> charClasses = []
+    {
+        std::array<CharClass, 256> table{};
+        table[0] = CLASS_END;
+        table[' '] = table['\t'] = table['\n'] = table['\r'] = CLASS_WHITESPACE;
+
+        for (int ch = 'a'; ch <= 'z'; ++ch)
+        {
+            table[ch] = CLASS_LETTER;
+            table[ch - 'a' + 'A'] = CLASS_LETTER;
+        }
+        table['_'] = CLASS_LETTER;
+
+        for (int ch = 0x80; ch <= 0xFF; ++ch)
+        {
+            table[ch] = CLASS_UTF8;
+        }
+
+        for (int ch = '0'; ch <= '9'; ++ch)
+        {
+            table[ch] = CLASS_DIGIT;
+        }
+
+        for (const OperatorSpelling &op : operators)
+        {
+            table[static_cast<unsigned char>(op.literal[0])] = CLASS_OPERATOR;
+        }
+
+        return table;
+    }();
+
+    // Returns the class of the given char
+    constexpr CharClass classOf(char ch)
+    {
+        return charClasses[static_cast<unsigned char>(ch)];
+    }
+
+    // DFA recognising the longest operator at the cursor. State 0 is dead and state 1 is the start state,
+    // every other state is a prefix of at least one operator and accepts that prefix's TokenType.
+    struct OperatorDfa
+    {
+        static constexpr uint8_t DEAD = 0;
+        static constexpr uint8_t START = 1;
+        static constexpr size_t MAX_STATES = operators.size() * 2 + 2;
+
+        std::array<std::array<uint8_t, 256>, MAX_STATES> next{};
+        std::array<token::TokenType, MAX_STATES> accepts{};
+        size_t stateCount = 2;
+    };
+
+    // Builds the operator DFA as a trie over the spellings in operators
+    constexpr OperatorDfa buildOperatorDfa()
+    {
+        OperatorDfa dfa{};
+        for (const OperatorSpelling &op : operators)
+        {
+            uint8_t state = OperatorDfa::START;
+            for (char ch : op.literal)
+            {
+                uint8_t &target = dfa.next[state][static_cast<unsigned char>(ch)];
+                if (target == OperatorDfa::DEAD)
+                {
+                    target = static_cast<uint8_t>(dfa.stateCount++);
+                    dfa.accepts[target] = token::ILLEGAL;
+                }
+
+                state = target;
+            }
+
+            dfa.accepts[state] = op.type;
+        }
+
+        return dfa;
+    }
+
+    constexpr OperatorDfa operatorDfa = buildOperatorDfa();
+
+    // Checks that every state reachable from the start state accepts, which rules out backtracking
+    constexpr bool operatorPrefixesAccept()
+    {
+        for (size_t state = OperatorDfa::START + 1; state < operatorDfa.stateCount; ++state)
+        {
+            if (operatorDfa.accepts[state] == token::ILLEGAL)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(operatorPrefixesAccept(), "Every prefix of an operator in lexer::operators must be an operator too");
+}
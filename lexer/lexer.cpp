@@ -1,12 +1,15 @@
 #include "lexer.hpp"
+#include "char_class.hpp"
+#include "scan.hpp"
+#include "utf8.hpp"
+#include <algorithm>
 #include <iostream>
 
 using namespace lexer;
 
-// Reads a char from input
+// Reads a char from input, multi-byte UTF-8 chars are read one byte at a time
 void Lexer::readChar()
 {
-    // TODO: Support Unicode and UTF-8
     if (readPosition >= input.size())
     {
         ch = 0;
@@ -19,6 +22,13 @@ void Lexer::readChar()
     readPosition += 1;
 }
 
+void Lexer::seek(size_t newPosition)
+{
+    position = newPosition;
+    readPosition = newPosition + 1;
+    ch = newPosition < input.size() ? input[newPosition] : 0;
+}
+
 char Lexer::peekChar()
 {
     if (readPosition >= input.size())
@@ -34,162 +44,102 @@ token::Token Lexer::nextToken()
 {
     skipWhitespace();
 
-    token::Token token{};
-
-    switch (ch)
+    switch (classOf(ch))
     {
-    case '=':
-        if (peekChar() == '=')
-        {
-            token = {token::EQ, makeTwoCharToken()};
-        }
-        else
-        {
-            token = {newToken(token::ASSIGN)};
-        }
-
-        break;
-    case ';':
-        token = newToken(token::SEMICOLON);
-        break;
-    case '(':
-        token = newToken(token::LPAREN);
-        break;
-    case ')':
-        token = newToken(token::RPAREN);
-        break;
-    case '{':
-        token = newToken(token::LBRACE);
-        break;
-    case '}':
-        token = newToken(token::RBRACE);
-        break;
-    case ',':
-        token = newToken(token::COMMA);
-        break;
-    case '+':
-        token = newToken(token::PLUS);
-        break;
-    case '-':
-        token = newToken(token::MINUS);
-        break;
-    case '!':
-        if (peekChar() == '=')
-        {
-            token = {token::NOT_EQ, makeTwoCharToken()};
-        }
-        else
-        {
-            token = {newToken(token::BANG)};
-        }
-
-        break;
-    case '*':
-        token = newToken(token::ASTERISK);
-        break;
-    case '/':
-        token = newToken(token::SLASH);
-        break;
-    case '<':
-        if (peekChar() == '=')
-        {
-            token = {token::LT_EQ, makeTwoCharToken()};
-        }
-        else
-        {
-            token = {newToken(token::LT)};
-        }
-
-        break;
-    case '>':
-        if (peekChar() == '=')
-        {
-            token = {token::GT_EQ, makeTwoCharToken()};
-        }
-        else
+    case CLASS_END:
+        return {token::EOF_, {}};
+    case CLASS_LETTER:
+        return readIdentifierToken();
+    case CLASS_DIGIT:
+        return {token::INT, readNumber()};
+    case CLASS_OPERATOR:
+        return readOperator();
+    case CLASS_UTF8:
+    {
+        if (unicodeLetterLength(input, position) != 0)
         {
-            token = {newToken(token::GT)};
+            return readIdentifierToken();
         }
 
-        break;
-    case 0:
-        token.literal = "";
-        token.type = token::EOF_;
-        return token;
+        // A valid char that is not a letter is illegal as a whole, a malformed sequence one byte at a time
+        const size_t oldPosition = position;
+        seek(position + std::max<size_t>(decodeUtf8(input, position).length, 1));
+        return {token::ILLEGAL, input.substr(oldPosition, position - oldPosition)};
+    }
     default:
-        // Get the available identifiers, if not found make the token TokenType::ILLEGAL type
-        if (isLetter(ch))
-        {
-            token.literal = readIdentifier();
-            token.type = token::LookupIdentifier(token.literal);
-            return token;
-        }
-        else if (isDigit(ch))
-        {
-            token.type = token::INT;
-            token.literal = readNumber();
-            return token;
-        }
-        else
-        {
-            token = newToken(token::ILLEGAL);
-        }
-        break;
+    {
+        token::Token token = newToken(token::ILLEGAL);
+        readChar();
+        return token;
+    }
     }
-
-    readChar();
-    return token;
 }
 
 // Returns new token from given type and the current char
 token::Token Lexer::newToken(token::TokenType type)
 {
-    return {type, std::string(1, ch)};
+    return {type, input.substr(position, 1)};
 }
 
-std::string Lexer::makeTwoCharToken()
+token::Token Lexer::readOperator()
 {
-    char oldChar = ch;
+    const size_t oldPosition = position;
+    uint8_t state = operatorDfa.next[OperatorDfa::START][static_cast<unsigned char>(ch)];
+
+    while (uint8_t nextState = operatorDfa.next[state][static_cast<unsigned char>(peekChar())])
+    {
+        state = nextState;
+        readChar();
+    }
+
     readChar();
-    return std::string(1, oldChar) + std::string(1, ch);
+    return {operatorDfa.accepts[state], input.substr(oldPosition, position - oldPosition)};
 }
 
 bool Lexer::isLetter(char ch)
 {
-    return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z') || ch == '_';
+    return classOf(ch) == CLASS_LETTER;
 }
 
-std::string Lexer::readIdentifier()
+std::string_view Lexer::readIdentifier()
 {
     size_t oldPosition = position;
-    while (isLetter(ch))
+    size_t end = skipLetterRun(input, position);
+
+    // The ASCII run stops at the first byte above 0x7F, so pure ASCII identifiers never get decoded
+    while (size_t letterLength = unicodeLetterLength(input, end))
     {
-        readChar();
+        end = skipLetterRun(input, end + letterLength);
     }
 
+    seek(end);
     return input.substr(oldPosition, position - oldPosition);
 }
 
+token::Token Lexer::readIdentifierToken()
+{
+    const std::string_view identifier = readIdentifier();
+    const token::TokenType type = token::LookupIdentifier(identifier);
+    return {type, identifier, type == token::IDENT ? token::intern(identifier) : token::NO_SYMBOL};
+}
+
 bool Lexer::isDigit(char ch)
 {
-    return '0' <= ch && ch <= '9';
+    return classOf(ch) == CLASS_DIGIT;
 }
 
-std::string Lexer::readNumber()
+std::string_view Lexer::readNumber()
 {
     size_t oldPosition = position;
-    while (isDigit(ch))
-    {
-        readChar();
-    }
+    seek(skipDigitRun(input, position));
 
     return input.substr(oldPosition, position - oldPosition);
 }
 
 void Lexer::skipWhitespace()
 {
-    while (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+    if (classOf(ch) == CLASS_WHITESPACE)
     {
-        readChar();
+        seek(skipWhitespaceRun(input, position));
     }
 }
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include "token.hpp"
 
 namespace lexer
 {
     struct Lexer
     {
-        std::string input{};
-        size_t position{};     // Current position in input (points to current char)
-        size_t readPosition{}; // Current reading position in input (after the current char)
-        char ch{};             // Current char under examination
+        std::shared_ptr<const void> source{}; // Owner of the buffer input points into, shared with the parsed program
+        std::string_view input{};             // Source text, every token literal is a view into it
+        size_t position{};                    // Current position in input (points to current char)
+        size_t readPosition{};                // Current reading position in input (after the current char)
+        char ch{};                            // Current char under examination
 
-        Lexer(const std::string &in) : input(in)
+        // Copies the given text once into a shared buffer owned by the lexer
+        Lexer(const std::string &in) : Lexer(std::make_shared<const std::string>(in))
+        {
+        }
+
+        Lexer(const std::shared_ptr<const std::string> &in) : Lexer(*in, in)
+        {
+        }
+
+        // Lexes a buffer owned by someone else, owner keeps that buffer alive
+        Lexer(std::string_view in, std::shared_ptr<const void> owner) : source{std::move(owner)}, input{in}
         {
             readChar();
         }
@@ -20,6 +33,9 @@ namespace lexer
         // Reads a char from input
         void readChar();
 
+        // Moves the cursor straight to the given position, as if readChar was called until it got there
+        void seek(size_t newPosition);
+
         // Peeks on the character in front of the cursor, works similiar to readChar but doesn't move the cursor
         // Returns the peeked char
         char peekChar();
@@ -30,19 +46,22 @@ namespace lexer
         // Returns new token from given type and the current char
         token::Token newToken(token::TokenType type);
 
-        // Makes a two character token from the current position of the cursor and the next character proceeding it
-        std::string makeTwoCharToken();
+        // Reads the longest operator or delimiter starting at the cursor by walking the operator DFA
+        token::Token readOperator();
 
         // Checks if the given char is a letter and returns a boolean accordingly
         bool isLetter(char ch);
 
-        // Returns the next identifier in the input buffer
-        std::string readIdentifier();
+        // Returns the next identifier in the input buffer, letters past ASCII are decoded from UTF-8
+        std::string_view readIdentifier();
+
+        // Reads the next identifier and returns it as a keyword or an interned IDENT token
+        token::Token readIdentifierToken();
 
         // Checks if the given char is a digit
         bool isDigit(char ch);
         // Returns the next numebr in the input buffer;
-        std::string readNumber();
+        std::string_view readNumber();
 
         // Skips whitespaces in the input buffer;
         void skipWhitespace();
@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include "lexer.hpp"
+#include "scan.hpp"
+#include "token.hpp"
+
+// Counts every heap allocation made while the benchmark runs
+static size_t allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    ++allocationCount;
+    if (void *ptr = std::malloc(size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Repeats the snippet until the source reaches the target size
+std::string repeatSnippet(const std::string &snippet, size_t targetSize)
+{
+    std::string source;
+    source.reserve(targetSize + snippet.size());
+    while (source.size() < targetSize)
+    {
+        source += snippet;
+    }
+
+    return source;
+}
+
+// Builds a source of roughly the given size by repeating a typical script snippet
+std::string generateSource(size_t targetSize)
+{
+    const std::string snippet = R"(var shuma = funksion(a, b) { kthen a + b; };
+var rezultati = shuma(10, 25) * 3 - 7 / 2;
+nese (rezultati >= 100) { kthen vertet; } perndryshe { kthen falso; }
+var krahaso = rezultati != 42 == (5 <= 9);
+)";
+
+    return repeatSnippet(snippet, targetSize);
+}
+
+// Builds a source shaped like generated code: deep indentation, long names and long numbers
+std::string generateIndentedSource(size_t targetSize)
+{
+    const std::string snippet = R"(
+                        var rezultati_i_llogaritjes_se_pare = llogarit_shumen_e_vlerave(1234567890, 9876543210);
+                        nese (rezultati_i_llogaritjes_se_pare > 100000000000000) {
+                                kthen rezultati_i_llogaritjes_se_pare * 1000000000;
+                        }
+)";
+
+    return repeatSnippet(snippet, targetSize);
+}
+
+// Builds a source made almost entirely of identifiers, with the occasional keyword mixed in
+std::string generateIdentifierSource(size_t targetSize)
+{
+    const std::string snippet = "shuma rezultati vlera numri_i_pare numri_i_dyte x y z "
+                                "krahaso nese llogarit faktoriel var fib_n indeksi kthen gjatesia\n";
+
+    return repeatSnippet(snippet, targetSize);
+}
+
+// Builds the identifier dense source spelled the Albanian way, so most names carry multi-byte letters
+std::string generateUnicodeSource(size_t targetSize)
+{
+    const std::string snippet = "shuma rezultati vlerë numri_i_parë numri_i_dytë x y z "
+                                "krahasë nëse llogarit faktorieli var çmimi_n treguesi kthen gjatësia\n";
+
+    return repeatSnippet(snippet, targetSize);
+}
+
+void benchmarkLexer(const std::string &name, const std::string &source)
+{
+    const size_t allocationsBefore = allocationCount;
+    const auto start = std::chrono::steady_clock::now();
+
+    lexer::Lexer lex(source);
+    size_t tokens = 0;
+    while (lex.nextToken().type != token::EOF_)
+    {
+        ++tokens;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const size_t allocations = allocationCount - allocationsBefore;
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << name << ": " << tokens << " tokens in " << seconds * 1000 << " ms\n"
+              << "\ttokens/sec:       " << tokens / seconds << "\n"
+              << "\tMB/s:             " << source.size() / seconds / (1024 * 1024) << "\n"
+              << "\tallocations/token: " << static_cast<double>(allocations) / tokens << "\n"
+              << std::endl;
+}
+
+int main()
+{
+    const std::string sources[][2] = {
+        {"typical script", generateSource(16 * 1024 * 1024)},
+        {"identifier dense", generateIdentifierSource(16 * 1024 * 1024)},
+        {"indented generated", generateIndentedSource(16 * 1024 * 1024)},
+        {"utf-8 identifiers", generateUnicodeSource(16 * 1024 * 1024)},
+    };
+
+    const std::pair<lexer::ScanLevel, std::string> levels[] = {
+        {lexer::ScanLevel::SCALAR, "scalar"},
+        {lexer::ScanLevel::SSE2, "sse2"},
+        {lexer::ScanLevel::AVX2, "avx2"},
+    };
+
+    for (const auto &[level, levelName] : levels)
+    {
+        lexer::useScanLevel(level);
+        if (lexer::currentScanLevel() != level)
+        {
+            continue;
+        }
+
+        for (const auto &[name, source] : sources)
+        {
+            benchmarkLexer(name + " [" + levelName + "]", source);
+        }
+    }
+
+    return 0;
+}
@@ -1,13 +1,21 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <assert.h>
 #include "lexer.hpp"
+#include "scan.hpp"
+#include "stream_lexer.hpp"
 #include "token.hpp"
 
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
 struct Expected
 {
-    std::string expectedType{};
+    token::TokenType expectedType{};
     std::string expectedLiteral{};
 };
 
@@ -16,7 +24,7 @@ void TestNextToken()
     std::string input = R"(var a = 5;
 var b = 10;
 
-var add = funkcion(x, y) {
+var add = funksion(x, y) {
     x + y;  
 };
 
@@ -36,86 +44,86 @@ nese (vertet) {
 )";
 
     std::vector<Expected> tests = {
-        {std::string(token::VAR), "var"},
-        {std::string(token::IDENT), "a"},
-        {std::string(token::ASSIGN), "="},
-        {std::string(token::INT), "5"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::VAR), "var"},
-        {std::string(token::IDENT), "b"},
-        {std::string(token::ASSIGN), "="},
-        {std::string(token::INT), "10"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::VAR), "var"},
-        {std::string(token::IDENT), "add"},
-        {std::string(token::ASSIGN), "="},
-        {std::string(token::FUNCTION), "funkcion"},
-        {std::string(token::LPAREN), "("},
-        {std::string(token::IDENT), "x"},
-        {std::string(token::COMMA), ","},
-        {std::string(token::IDENT), "y"},
-        {std::string(token::RPAREN), ")"},
-        {std::string(token::LBRACE), "{"},
-        {std::string(token::IDENT), "x"},
-        {std::string(token::PLUS), "+"},
-        {std::string(token::IDENT), "y"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::RBRACE), "}"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::VAR), "var"},
-        {std::string(token::IDENT), "result"},
-        {std::string(token::ASSIGN), "="},
-        {std::string(token::IDENT), "add"},
-        {std::string(token::LPAREN), "("},
-        {std::string(token::IDENT), "a"},
-        {std::string(token::COMMA), ","},
-        {std::string(token::IDENT), "b"},
-        {std::string(token::RPAREN), ")"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::BANG), "!"},
-        {std::string(token::MINUS), "-"},
-        {std::string(token::SLASH), "/"},
-        {std::string(token::ASTERISK), "*"},
-        {std::string(token::INT), "5"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::INT), "5"},
-        {std::string(token::LT), "<"},
-        {std::string(token::INT), "10"},
-        {std::string(token::GT), ">"},
-        {std::string(token::INT), "5"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::IF), "nese"},
-        {std::string(token::LPAREN), "("},
-        {std::string(token::TRUE), "vertet"},
-        {std::string(token::RPAREN), ")"},
-        {std::string(token::LBRACE), "{"},
-        {std::string(token::RETURN), "kthen"},
-        {std::string(token::TRUE), "vertet"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::RBRACE), "}"},
-        {std::string(token::ELSE), "perndryshe"},
-        {std::string(token::LBRACE), "{"},
-        {std::string(token::RETURN), "kthen"},
-        {std::string(token::FALSE), "falso"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::RBRACE), "}"},
-        {std::string(token::INT), "9"},
-        {std::string(token::NOT_EQ), "!="},
-        {std::string(token::INT), "10"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::INT), "10"},
-        {std::string(token::EQ), "=="},
-        {std::string(token::INT), "10"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::INT), "3"},
-        {std::string(token::LT_EQ), "<="},
-        {std::string(token::INT), "5"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::INT), "3"},
-        {std::string(token::GT_EQ), ">="},
-        {std::string(token::INT), "5"},
-        {std::string(token::SEMICOLON), ";"},
-        {std::string(token::EOF_), ""},
+        {token::VAR, "var"},
+        {token::IDENT, "a"},
+        {token::ASSIGN, "="},
+        {token::INT, "5"},
+        {token::SEMICOLON, ";"},
+        {token::VAR, "var"},
+        {token::IDENT, "b"},
+        {token::ASSIGN, "="},
+        {token::INT, "10"},
+        {token::SEMICOLON, ";"},
+        {token::VAR, "var"},
+        {token::IDENT, "add"},
+        {token::ASSIGN, "="},
+        {token::FUNCTION, "funksion"},
+        {token::LPAREN, "("},
+        {token::IDENT, "x"},
+        {token::COMMA, ","},
+        {token::IDENT, "y"},
+        {token::RPAREN, ")"},
+        {token::LBRACE, "{"},
+        {token::IDENT, "x"},
+        {token::PLUS, "+"},
+        {token::IDENT, "y"},
+        {token::SEMICOLON, ";"},
+        {token::RBRACE, "}"},
+        {token::SEMICOLON, ";"},
+        {token::VAR, "var"},
+        {token::IDENT, "result"},
+        {token::ASSIGN, "="},
+        {token::IDENT, "add"},
+        {token::LPAREN, "("},
+        {token::IDENT, "a"},
+        {token::COMMA, ","},
+        {token::IDENT, "b"},
+        {token::RPAREN, ")"},
+        {token::SEMICOLON, ";"},
+        {token::BANG, "!"},
+        {token::MINUS, "-"},
+        {token::SLASH, "/"},
+        {token::ASTERISK, "*"},
+        {token::INT, "5"},
+        {token::SEMICOLON, ";"},
+        {token::INT, "5"},
+        {token::LT, "<"},
+        {token::INT, "10"},
+        {token::GT, ">"},
+        {token::INT, "5"},
+        {token::SEMICOLON, ";"},
+        {token::IF, "nese"},
+        {token::LPAREN, "("},
+        {token::TRUE, "vertet"},
+        {token::RPAREN, ")"},
+        {token::LBRACE, "{"},
+        {token::RETURN, "kthen"},
+        {token::TRUE, "vertet"},
+        {token::SEMICOLON, ";"},
+        {token::RBRACE, "}"},
+        {token::ELSE, "perndryshe"},
+        {token::LBRACE, "{"},
+        {token::RETURN, "kthen"},
+        {token::FALSE, "falso"},
+        {token::SEMICOLON, ";"},
+        {token::RBRACE, "}"},
+        {token::INT, "9"},
+        {token::NOT_EQ, "!="},
+        {token::INT, "10"},
+        {token::SEMICOLON, ";"},
+        {token::INT, "10"},
+        {token::EQ, "=="},
+        {token::INT, "10"},
+        {token::SEMICOLON, ";"},
+        {token::INT, "3"},
+        {token::LT_EQ, "<="},
+        {token::INT, "5"},
+        {token::SEMICOLON, ";"},
+        {token::INT, "3"},
+        {token::GT_EQ, ">="},
+        {token::INT, "5"},
+        {token::SEMICOLON, ";"},
+        {token::EOF_, ""},
     };
     lexer::Lexer *lex = new lexer::Lexer(input);
 
@@ -138,8 +146,331 @@ nese (vertet) {
     std::cout << "All tests passed!";
 }
 
+void TestLookupIdentifier()
+{
+    for (const token::Keyword &keyword : token::keywords)
+    {
+        assert(token::LookupIdentifier(keyword.literal) == keyword.type);
+    }
+
+    // Identifiers that share a length, first or last character with a keyword
+    std::vector<std::string> identifiers = {"x", "vaz", "vat", "funksiox", "nesa", "kthem", "falsa", "perndryshee", "Var", "_"};
+    for (const std::string &identifier : identifiers)
+    {
+        assert(token::LookupIdentifier(identifier) == token::IDENT);
+    }
+
+    std::cout << "\nLookupIdentifier tests passed!";
+}
+
+// Lexes the whole input, the returned literals point into input itself
+std::vector<token::Token> lexAll(const std::string &input)
+{
+    lexer::Lexer lex(input, nullptr);
+    std::vector<token::Token> tokens;
+    do
+    {
+        tokens.push_back(lex.nextToken());
+    } while (tokens.back().type != token::EOF_);
+
+    return tokens;
+}
+
+void TestOperatorsAdjacent()
+{
+    // Operators written without spaces take the longest match first
+    std::vector<Expected> tests = {
+        {token::EQ, "=="},
+        {token::ASSIGN, "="},
+        {token::NOT_EQ, "!="},
+        {token::ASSIGN, "="},
+        {token::LT_EQ, "<="},
+        {token::GT, ">"},
+        {token::BANG, "!"},
+        {token::BANG, "!"},
+        {token::GT_EQ, ">="},
+        {token::LPAREN, "("},
+        {token::ILLEGAL, "@"},
+        {token::RPAREN, ")"},
+        {token::LT, "<"},
+        {token::EOF_, ""},
+    };
+
+    const std::string input = "===!==<=>!!>=(@)<";
+    const std::vector<token::Token> tokens = lexAll(input);
+
+    assert(tokens.size() == tests.size());
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        assert(tokens[i].type == tests[i].expectedType);
+        assert(tokens[i].literal == tests[i].expectedLiteral);
+    }
+
+    std::cout << "\nAdjacent operator tests passed!";
+}
+
+void TestUnicodeIdentifiers()
+{
+    // Albanian letters are part of identifiers, anything else past ASCII is illegal
+    std::vector<Expected> tests = {
+        {token::VAR, "var"},
+        {token::IDENT, "vlerë"},
+        {token::ASSIGN, "="},
+        {token::IDENT, "çmimi_ë"},
+        {token::ASTERISK, "*"},
+        {token::IDENT, "Ëç"},
+        {token::SEMICOLON, ";"},
+        {token::IDENT, "x"},
+        {token::ILLEGAL, "×"},
+        {token::IDENT, "y"},
+        {token::ILLEGAL, "€"},
+        {token::ILLEGAL, "\xC3"},
+        {token::IDENT, "a"},
+        {token::ILLEGAL, "\xC0"},
+        {token::ILLEGAL, "\xAB"},
+        {token::ILLEGAL, "\xED"},
+        {token::ILLEGAL, "\xA0"},
+        {token::ILLEGAL, "\x80"},
+        {token::IDENT, "ë"},
+        {token::ILLEGAL, "\xC3"},
+        {token::EOF_, ""},
+    };
+
+    // Includes a cut off sequence, an overlong encoding of '+', an encoded surrogate and a stray continuation byte
+    const std::string input = "var vlerë = çmimi_ë * Ëç;x×y€\xC3" "a\xC0\xAB\xED\xA0\x80ë\xC3";
+    const std::vector<token::Token> tokens = lexAll(input);
+
+    assert(tokens.size() == tests.size());
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        assert(tokens[i].type == tests[i].expectedType);
+        assert(tokens[i].literal == tests[i].expectedLiteral);
+    }
+
+    assert(tokens[1].symbol == token::intern("vlerë"));
+    assert(tokens[18].symbol != tokens[1].symbol);
+
+    std::cout << "\nUnicode identifier tests passed!";
+}
+
+void TestIdentifiersInterned()
+{
+    const std::string input = "shuma vlera shuma var shumaa";
+    const std::vector<token::Token> tokens = lexAll(input);
+
+    assert(tokens[0].symbol == tokens[2].symbol);
+    assert(tokens[0].symbol != tokens[1].symbol);
+    assert(tokens[0].symbol != tokens[4].symbol);
+    assert(token::symbolName(tokens[0].symbol) == "shuma");
+    assert(token::symbolName(tokens[4].symbol) == "shumaa");
+    assert(token::intern("vlera") == tokens[1].symbol);
+
+    std::cout << "\nInterning tests passed!";
+}
+
+void TestConcurrentInterning()
+{
+    // Threads intern overlapping sets of names, every name has to end up with exactly one symbol
+    constexpr int THREADS = 8;
+    constexpr int NAMES = 5000;
+    std::vector<std::vector<token::Symbol>> symbols(THREADS, std::vector<token::Symbol>(NAMES));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([t, &symbols]
+                             {
+            for (int i = 0; i < NAMES; ++i)
+            {
+                // Every thread walks all names from a different starting point so they race on first insertion
+                const int name = (i * 7919 + t * 613) % NAMES;
+                symbols[t][name] = token::intern("emri_paralel_" + std::to_string(name));
+            } });
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    for (int i = 0; i < NAMES; ++i)
+    {
+        for (int t = 1; t < THREADS; ++t)
+        {
+            assert(symbols[t][i] == symbols[0][i]);
+        }
+
+        assert(token::symbolName(symbols[0][i]) == "emri_paralel_" + std::to_string(i));
+        assert(symbols[0][i] < token::symbolCount());
+    }
+
+    // No name is interned as NO_SYMBOL, and symbols never handed out have no page of names yet
+    assert(token::intern("emri_paralel_0") != token::NO_SYMBOL);
+    assert(token::symbolName(token::NO_SYMBOL).empty());
+    assert(token::symbolName(static_cast<token::Symbol>(token::symbolCount() + 1000000)).empty());
+
+    std::cout << "\nConcurrent interning tests passed!";
+}
+
+void TestScanLevelsAgree()
+{
+    // Runs of every length around the 16 and 32 byte block sizes, followed by chars that end them
+    std::string input;
+    for (size_t length = 1; length < 70; ++length)
+    {
+        input += std::string(length, ' ') + std::string(length, 'a') + "\t\r\n" + std::string(length, '7') + "@";
+        input += std::string(length, '_') + "\x80" + std::string(length, 'Z') + "[" + std::string(length, '0') + "`{";
+    }
+    input += "var x = 5;" + std::string(40, ' ');
+
+    const lexer::ScanLevel original = lexer::currentScanLevel();
+
+    lexer::useScanLevel(lexer::ScanLevel::SCALAR);
+    const std::vector<token::Token> expected = lexAll(input);
+
+    for (auto level : {lexer::ScanLevel::SSE2, lexer::ScanLevel::AVX2})
+    {
+        lexer::useScanLevel(level);
+        const std::vector<token::Token> tokens = lexAll(input);
+
+        assert(tokens.size() == expected.size());
+        for (size_t i = 0; i < tokens.size(); i++)
+        {
+            assert(tokens[i].type == expected[i].type);
+            assert(tokens[i].literal == expected[i].literal);
+        }
+    }
+
+    lexer::useScanLevel(original);
+    std::cout << "\nScan level tests passed!";
+}
+
+void TestStreamLexerMatchesLexer()
+{
+    std::string input = R"(var shuma = funksion(a, b) { kthen a + b; };
+nese (shuma(1, 22) >= 333) { kthen vertet; } perndryshe { kthen falso != vertet; }
+var identifikues_shume_i_gjate_qe_kalon_kufirin = 1234567890123 <= 5 == 4;   @
+var përgjigjëçë = ëë + Çmimi € ç;
+)";
+    input += std::string(100, ' ') + "fundi";
+
+    const std::vector<token::Token> expected = lexAll(input);
+
+    // Chunk sizes small enough that tokens and whitespace runs straddle every chunk boundary
+    for (size_t chunkSize : {1, 2, 3, 5, 8, 64, 4096})
+    {
+        std::istringstream in(input);
+        lexer::StreamLexer lex(in, chunkSize);
+
+        for (const token::Token &expectedToken : expected)
+        {
+            const token::Token token = lex.nextToken();
+            assert(token.type == expectedToken.type);
+            assert(token.literal == expectedToken.literal);
+        }
+
+        assert(lex.nextToken().type == token::EOF_);
+    }
+
+    // A chunk size of 0 would never read anything
+    std::istringstream in(input);
+    bool threw = false;
+    try
+    {
+        lexer::StreamLexer lex(in, 0);
+    }
+    catch (const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    assert(threw && "chunk size 0 is rejected");
+
+    std::cout << "\nStream lexer tests passed!";
+}
+
+// Produces a script of the given size on the fly by repeating a snippet, without ever holding the whole script
+class GeneratedScript : public std::streambuf
+{
+public:
+    GeneratedScript(size_t size) : remaining{size}
+    {
+    }
+
+    const std::string &text() const
+    {
+        return snippet;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (remaining == 0)
+        {
+            return traits_type::eof();
+        }
+
+        const size_t count = remaining < snippet.size() ? remaining : snippet.size();
+        remaining -= count;
+        setg(snippet.data(), snippet.data(), snippet.data() + count);
+
+        return traits_type::to_int_type(snippet[0]);
+    }
+
+private:
+    std::string snippet = "var vlera = funksion(x, y) { kthen x * y + 42; };\nnese (vlera(1, 2) != 3) { vlera; }\n";
+    size_t remaining;
+};
+
+// Returns the peak resident set size of the process in KB, 0 where it can't be measured
+long peakResidentKilobytes()
+{
+#ifdef __linux__
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+void TestStreamLexerBoundedMemory()
+{
+    const size_t snippets = 3 * 1024 * 1024;
+    const std::string snippet = GeneratedScript(0).text();
+    const size_t tokensPerSnippet = lexAll(snippet).size() - 1;
+
+    GeneratedScript script(snippets * snippet.size());
+    std::istream in(&script);
+
+    const long peakBefore = peakResidentKilobytes();
+
+    lexer::StreamLexer lex(in);
+    size_t tokens = 0;
+    while (lex.nextToken().type != token::EOF_)
+    {
+        ++tokens;
+    }
+
+    const long peakAfter = peakResidentKilobytes();
+
+    assert(tokens == snippets * tokensPerSnippet);
+    // Lexing the few hundred MB script may not grow the peak by more than a few chunks
+    assert(peakAfter - peakBefore < 8 * 1024);
+
+    std::cout << "\nStreamed " << snippets * snippet.size() / (1024 * 1024) << " MB, peak RSS grew by "
+              << peakAfter - peakBefore << " KB";
+}
+
 int main()
 {
     TestNextToken();
+    TestLookupIdentifier();
+    TestUnicodeIdentifiers();
+    TestIdentifiersInterned();
+    TestConcurrentInterning();
+    TestScanLevelsAgree();
+    TestOperatorsAdjacent();
+    TestStreamLexerMatchesLexer();
+    TestStreamLexerBoundedMemory();
     return 0;
 }
@@ -0,0 +1,271 @@
+#include "scan.hpp"
+#include "char_class.hpp"
+
+// SSE2 is part of every x86-64 CPU, AVX2 is checked at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define EAGLECL_SCAN_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+using namespace lexer;
+
+namespace
+{
+    using ScanFn = size_t (*)(std::string_view input, size_t from);
+
+    bool isWhitespace(char ch)
+    {
+        return classOf(ch) == CLASS_WHITESPACE;
+    }
+
+    bool isLetter(char ch)
+    {
+        return classOf(ch) == CLASS_LETTER;
+    }
+
+    bool isDigit(char ch)
+    {
+        return classOf(ch) == CLASS_DIGIT;
+    }
+
+    template <bool (*matches)(char)>
+    size_t scalarRun(std::string_view input, size_t from)
+    {
+        while (from < input.size() && matches(input[from]))
+        {
+            ++from;
+        }
+
+        return from;
+    }
+
+    // Index of the lowest set bit, mask must not be zero
+    unsigned lowestBit(unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+#ifdef EAGLECL_SCAN_X86
+    // Each classifier returns a byte mask with 0xFF for every byte of the block that belongs to the run
+
+    __m128i whitespaceMask(__m128i block)
+    {
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                                         _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+                            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')),
+                                         _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+    }
+
+    // Setting bit 0x20 folds upper case into lower case, bytes above 0x7F are negative and fall out of the range
+    __m128i letterMask(__m128i block)
+    {
+        const __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+        const __m128i isAlpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                              _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        return _mm_or_si128(isAlpha, _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+    }
+
+    __m128i digitMask(__m128i block)
+    {
+        return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)),
+                             _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+    }
+
+    // Most whitespace runs are a single space, so the first chars are checked one at a time before loading any blocks.
+    // Returns true if the run ended within the first SHORT_RUN chars.
+    constexpr size_t SHORT_RUN = 2;
+
+    template <bool (*matches)(char)>
+    bool finishShortRun(std::string_view input, size_t &from)
+    {
+        const size_t end = input.size() < from + SHORT_RUN ? input.size() : from + SHORT_RUN;
+        while (from < end && matches(input[from]))
+        {
+            ++from;
+        }
+
+        return from < end || from == input.size();
+    }
+
+    template <__m128i (*classify)(__m128i), bool (*matches)(char)>
+    size_t sse2Blocks(std::string_view input, size_t from)
+    {
+        const char *data = input.data();
+        while (from + 16 <= input.size())
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + from));
+            const unsigned outside = ~static_cast<unsigned>(_mm_movemask_epi8(classify(block))) & 0xFFFF;
+            if (outside)
+            {
+                return from + lowestBit(outside);
+            }
+
+            from += 16;
+        }
+
+        return scalarRun<matches>(input, from);
+    }
+
+    template <__m128i (*classify)(__m128i), bool (*matches)(char)>
+    size_t sse2Run(std::string_view input, size_t from)
+    {
+        if (finishShortRun<matches>(input, from))
+        {
+            return from;
+        }
+
+        return sse2Blocks<classify, matches>(input, from);
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EAGLECL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define EAGLECL_TARGET_AVX2
+#endif
+
+    EAGLECL_TARGET_AVX2 __m256i whitespaceMask256(__m256i block)
+    {
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+                                               _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+                               _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')),
+                                               _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+    }
+
+    EAGLECL_TARGET_AVX2 __m256i letterMask256(__m256i block)
+    {
+        const __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+        const __m256i isAlpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                                 _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        return _mm256_or_si256(isAlpha, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')));
+    }
+
+    EAGLECL_TARGET_AVX2 __m256i digitMask256(__m256i block)
+    {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)),
+                                _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), block));
+    }
+
+    template <__m256i (*classify)(__m256i), __m128i (*classify128)(__m128i), bool (*matches)(char)>
+    EAGLECL_TARGET_AVX2 size_t avx2Run(std::string_view input, size_t from)
+    {
+        if (finishShortRun<matches>(input, from))
+        {
+            return from;
+        }
+
+        const char *data = input.data();
+        while (from + 32 <= input.size())
+        {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from));
+            const unsigned outside = ~static_cast<unsigned>(_mm256_movemask_epi8(classify(block)));
+            if (outside)
+            {
+                return from + lowestBit(outside);
+            }
+
+            from += 32;
+        }
+
+        return sse2Blocks<classify128, matches>(input, from);
+    }
+
+    bool cpuSupportsAvx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        if (!osSavesYmm)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    struct ScanTable
+    {
+        ScanLevel level;
+        ScanFn whitespace;
+        ScanFn letters;
+        ScanFn digits;
+    };
+
+    ScanTable makeScanTable(ScanLevel level)
+    {
+        switch (level)
+        {
+#ifdef EAGLECL_SCAN_X86
+        case ScanLevel::AVX2:
+            return {level,
+                    avx2Run<whitespaceMask256, whitespaceMask, isWhitespace>,
+                    avx2Run<letterMask256, letterMask, isLetter>,
+                    avx2Run<digitMask256, digitMask, isDigit>};
+        case ScanLevel::SSE2:
+            return {level,
+                    sse2Run<whitespaceMask, isWhitespace>,
+                    sse2Run<letterMask, isLetter>,
+                    sse2Run<digitMask, isDigit>};
+#endif
+        default:
+            return {ScanLevel::SCALAR, scalarRun<isWhitespace>, scalarRun<isLetter>, scalarRun<isDigit>};
+        }
+    }
+
+    ScanTable scanTable = makeScanTable(detectScanLevel());
+}
+
+ScanLevel lexer::detectScanLevel()
+{
+#ifdef EAGLECL_SCAN_X86
+    if (cpuSupportsAvx2())
+    {
+        return ScanLevel::AVX2;
+    }
+
+    return ScanLevel::SSE2;
+#endif
+
+    return ScanLevel::SCALAR;
+}
+
+ScanLevel lexer::currentScanLevel()
+{
+    return scanTable.level;
+}
+
+void lexer::useScanLevel(ScanLevel level)
+{
+    const ScanLevel supported = detectScanLevel();
+    scanTable = makeScanTable(level < supported ? level : supported);
+}
+
+size_t lexer::skipWhitespaceRun(std::string_view input, size_t from)
+{
+    return scanTable.whitespace(input, from);
+}
+
+size_t lexer::skipLetterRun(std::string_view input, size_t from)
+{
+    return scanTable.letters(input, from);
+}
+
+size_t lexer::skipDigitRun(std::string_view input, size_t from)
+{
+    return scanTable.digits(input, from);
+}
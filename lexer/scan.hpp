@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lexer
+{
+    // Instruction sets the scanning functions can run on, ordered from slowest to fastest
+    enum class ScanLevel
+    {
+        SCALAR, // One byte at a time, available everywhere
+        SSE2,   // 16 bytes at a time
+        AVX2,   // 32 bytes at a time
+    };
+
+    // Returns the fastest ScanLevel the current CPU supports
+    ScanLevel detectScanLevel();
+
+    // Returns the ScanLevel the scanning functions currently run on
+    ScanLevel currentScanLevel();
+
+    // Switches the scanning functions to the given level, capped at what the CPU supports.
+    // The fastest supported level is selected automatically at startup, this exists for tests and benchmarks
+    // and must not be called while other threads are lexing.
+    void useScanLevel(ScanLevel level);
+
+    // Returns the position of the first char at or after from that is not a whitespace
+    size_t skipWhitespaceRun(std::string_view input, size_t from);
+
+    // Returns the position of the first char at or after from that is not a letter
+    size_t skipLetterRun(std::string_view input, size_t from);
+
+    // Returns the position of the first char at or after from that is not a digit
+    size_t skipDigitRun(std::string_view input, size_t from);
+}
@@ -0,0 +1,42 @@
+#include "stream_lexer.hpp"
+#include "utf8.hpp"
+
+using namespace lexer;
+
+token::Token StreamLexer::nextToken()
+{
+    while (true)
+    {
+        const token::Token token = lexer.nextToken();
+
+        // A token that runs into the end of the window could continue in the next chunk,
+        // so it is only handed out once the window holds the chars after it or the stream is exhausted.
+        // A UTF-8 char cut in half by the chunk boundary stops a token short of the end, hence the margin.
+        if (lexer.position + MAX_UTF8_LENGTH <= window.size() || endOfStream)
+        {
+            return token;
+        }
+
+        const size_t tokenStart = token.type == token::EOF_ ? window.size() : token.literal.data() - window.data();
+        fill(tokenStart);
+    }
+}
+
+void StreamLexer::fill(size_t keepFrom)
+{
+    window.erase(0, keepFrom);
+
+    const size_t oldSize = window.size();
+    window.resize(oldSize + chunkSize);
+    in.read(window.data() + oldSize, static_cast<std::streamsize>(chunkSize));
+
+    const size_t readCount = static_cast<size_t>(in.gcount());
+    window.resize(oldSize + readCount);
+
+    if (readCount < chunkSize)
+    {
+        endOfStream = true;
+    }
+
+    lexer = Lexer(window, nullptr);
+}
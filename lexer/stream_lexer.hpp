@@ -0,0 +1,47 @@
+#pragma once
+
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include "lexer.hpp"
+#include "token.hpp"
+
+namespace lexer
+{
+    // Lexes a script straight from a stream, pulling it in in fixed size chunks.
+    // Memory stays bounded by the chunk size plus the longest token, no matter how big the script is.
+    // Token literals point into the lexer's window and are only valid until the next call to nextToken.
+    class StreamLexer
+    {
+    public:
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+        // Throws std::invalid_argument for a chunk size of 0, the lexer would never get past the first chunk
+        StreamLexer(std::istream &in, size_t chunkSize = DEFAULT_CHUNK_SIZE) : in{in}, chunkSize{chunkSize}
+        {
+            if (chunkSize == 0)
+            {
+                throw std::invalid_argument("chunk size of a stream lexer must not be 0");
+            }
+
+            window.reserve(chunkSize * 2);
+        }
+
+        StreamLexer(const StreamLexer &) = delete;
+        StreamLexer &operator=(const StreamLexer &) = delete;
+
+        // Returns the next token from the stream, produces the same tokens as Lexer does for the whole text
+        token::Token nextToken();
+
+    private:
+        std::istream &in;
+        size_t chunkSize;
+        std::string window{};                     // Part of the stream read but not lexed yet
+        Lexer lexer{std::string_view{}, nullptr}; // Lexes the window in place
+        bool endOfStream{};                       // Set once the stream has no more chars to give
+
+        // Drops everything in the window before keepFrom, appends the next chunk of the stream
+        // and restarts the lexer at the beginning of the window
+        void fill(size_t keepFrom);
+    };
+}
@@ -0,0 +1,34 @@
+#include "token_buffer.hpp"
+#include <stdexcept>
+
+using namespace lexer;
+
+TokenBuffer::TokenBuffer(Lexer &lexer) : source{lexer.source}, input{lexer.input}
+{
+    if (input.size() > MAX_SOURCE_SIZE)
+    {
+        throw std::length_error("source of " + std::to_string(input.size()) + " bytes is too large for a token buffer");
+    }
+
+    // Typical sources average about three chars per token, reserving one token per two chars avoids regrowth
+    // and the pages that are never written to are never touched
+    const size_t expectedTokens = input.size() / 2 + 1;
+    types.reserve(expectedTokens);
+    offsets.reserve(expectedTokens);
+    lengths.reserve(expectedTokens);
+    symbols.reserve(expectedTokens);
+
+    token::Token token{};
+    do
+    {
+        token = lexer.nextToken();
+
+        // EOF has an empty literal that does not point into the input
+        const size_t offset = token.type == token::EOF_ ? input.size() : token.literal.data() - input.data();
+
+        types.push_back(token.type);
+        offsets.push_back(static_cast<uint32_t>(offset));
+        lengths.push_back(static_cast<uint32_t>(token.literal.size()));
+        symbols.push_back(token.symbol);
+    } while (token.type != token::EOF_);
+}
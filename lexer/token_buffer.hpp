@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "lexer.hpp"
+#include "token.hpp"
+
+namespace lexer
+{
+    // Every token of a source, lexed up front and stored as parallel arrays.
+    // Literals are kept as 32 bit offset and length into the source, so a source may be at most 4 GB.
+    // Throws std::length_error for a longer source.
+    struct TokenBuffer
+    {
+        std::shared_ptr<const void> source{}; // Owner of the buffer input points into
+        std::string_view input{};             // Source text the offsets point into
+        std::vector<token::TokenType> types{};
+        std::vector<uint32_t> offsets{};
+        std::vector<uint32_t> lengths{};
+        std::vector<token::Symbol> symbols{}; // Only meaningful for TokenType::IDENT
+
+        // Largest source whose offsets fit, the EOF token's offset is the size of the source
+        static constexpr size_t MAX_SOURCE_SIZE = std::numeric_limits<uint32_t>::max();
+
+        // Lexes the whole input of the lexer, the last token stored is always EOF
+        TokenBuffer(Lexer &lexer);
+
+        // Returns the number of tokens, including the closing EOF
+        size_t size() const { return types.size(); }
+
+        // Returns the token at the given index, indexes past the end return the closing EOF token
+        token::Token at(size_t index) const
+        {
+            if (index >= types.size())
+            {
+                index = types.size() - 1;
+            }
+
+            return {types[index], std::string_view(input.data() + offsets[index], lengths[index]), symbols[index]};
+        }
+    };
+}
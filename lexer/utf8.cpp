@@ -0,0 +1,91 @@
+#include "utf8.hpp"
+
+using namespace lexer;
+
+namespace
+{
+    bool isContinuation(unsigned char byte)
+    {
+        return (byte & 0xC0) == 0x80;
+    }
+}
+
+DecodedChar lexer::decodeUtf8(std::string_view input, size_t position)
+{
+    const DecodedChar invalid{0, 0};
+    if (position >= input.size())
+    {
+        return invalid;
+    }
+
+    const unsigned char lead = static_cast<unsigned char>(input[position]);
+    size_t length;
+    char32_t codePoint;
+    char32_t minimum;
+    if (lead < 0x80)
+    {
+        return {lead, 1};
+    }
+    else if ((lead & 0xE0) == 0xC0)
+    {
+        length = 2;
+        codePoint = lead & 0x1F;
+        minimum = 0x80;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+        length = 3;
+        codePoint = lead & 0x0F;
+        minimum = 0x800;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+        length = 4;
+        codePoint = lead & 0x07;
+        minimum = 0x10000;
+    }
+    else
+    {
+        return invalid;
+    }
+
+    if (input.size() - position < length)
+    {
+        return invalid;
+    }
+
+    for (size_t i = 1; i < length; ++i)
+    {
+        const unsigned char byte = static_cast<unsigned char>(input[position + i]);
+        if (!isContinuation(byte))
+        {
+            return invalid;
+        }
+
+        codePoint = (codePoint << 6) | (byte & 0x3F);
+    }
+
+    if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+    {
+        return invalid;
+    }
+
+    return {codePoint, length};
+}
+
+bool lexer::isUnicodeLetter(char32_t codePoint)
+{
+    // U+00D7 and U+00F7 are the multiplication and division signs in the middle of the Latin-1 letters
+    return codePoint >= 0xC0 && codePoint <= 0x24F && codePoint != 0xD7 && codePoint != 0xF7;
+}
+
+size_t lexer::unicodeLetterLength(std::string_view input, size_t position)
+{
+    if (position >= input.size() || static_cast<unsigned char>(input[position]) < 0x80)
+    {
+        return 0;
+    }
+
+    const DecodedChar decoded = decodeUtf8(input, position);
+    return decoded.length != 0 && isUnicodeLetter(decoded.codePoint) ? decoded.length : 0;
+}
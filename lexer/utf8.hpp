@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lexer
+{
+    // Longest UTF-8 encoding of a single code point
+    constexpr size_t MAX_UTF8_LENGTH = 4;
+
+    // A code point decoded from UTF-8 together with the number of bytes it took up
+    struct DecodedChar
+    {
+        char32_t codePoint;
+        size_t length; // 0 when the bytes are not valid UTF-8
+    };
+
+    // Decodes the code point starting at position. Overlong encodings, surrogates, code points past U+10FFFF
+    // and sequences cut off by the end of input are rejected with a length of 0.
+    DecodedChar decodeUtf8(std::string_view input, size_t position);
+
+    // Checks if the given code point is a non ASCII letter that can be part of an identifier.
+    // Covers the Latin-1 Supplement and Latin Extended-A/B letters, which includes the Albanian ë and ç.
+    bool isUnicodeLetter(char32_t codePoint);
+
+    // Returns the number of bytes of the non ASCII letter starting at position, 0 if there is none
+    size_t unicodeLetterLength(std::string_view input, size_t position);
+}
@@ -1,8 +1,20 @@
 #include <iostream>
 #include "repl.hpp"
+#include "runner.hpp"
 
-int main()
+int main(int argc, char *argv[])
 {
+    if (argc == 2)
+    {
+        return runner::runFile(argv[1], std::cout, std::cerr);
+    }
+
+    if (argc > 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [path/to/script]\n";
+        return runner::USAGE_ERROR;
+    }
+
     std::cout << "Welcome to EagleCL! EagleCL is a programming language in an albanian syntax\n";
     std::cout << "Feel free to try the REPL!\n";
     repl::start(std::cin, std::cout);
@@ -2,21 +2,41 @@
 
 using namespace object;
 
-Object *Environment::get(const std::string &name) const
+uint64_t Environment::nextId = 1;
+
+Object *Environment::get(token::Symbol name) const
 {
-    if (!store.count(name))
+    for (const Environment *env = this; env; env = env->outerEnvironment)
     {
-        if (outerEnvironment)
-            return outerEnvironment->get(name);
-
-        return nullptr;
+        const uint32_t slot = env->function ? env->function->slotOf(name) : name;
+        if (slot < env->values.size() && env->values[slot])
+        {
+            return env->values[slot];
+        }
     }
 
-    return store.at(name);
+    return nullptr;
+}
+
+Object *Environment::getOuter(const Environment *env, token::Symbol name)
+{
+    // The var statement binding the slot hasn't run, the name may still be bound further out
+    return env->outerEnvironment ? env->outerEnvironment->get(name) : nullptr;
 }
 
-Object *Environment::set(const std::string &name, Object *value)
+Object *Environment::set(token::Symbol name, Object *value)
 {
-    store.insert({name, value});
-    return value;
+    if (function)
+    {
+        // Every name a call binds is declared by its function, the resolver gave it a slot
+        const uint32_t slot = function->slotOf(name);
+        return slot == ast::NO_SLOT ? value : setSlot(slot, value);
+    }
+
+    if (name >= values.size())
+    {
+        values.resize(name + 1);
+    }
+
+    return setSlot(name, value);
 }
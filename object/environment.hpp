@@ -1,34 +1,105 @@
 #pragma once
 
-#include <unordered_map>
-#include <string>
+#include <cstdint>
+#include <vector>
 #include "object.hpp"
+#include "symbol_table.hpp"
 
 namespace object
 {
+    // The global environment or the environment of one function call. Globals are indexed by the symbol of their
+    // name, the variables of a call by the slot the resolver gave them in the called function literal.
     class Environment
     {
     public:
-        std::unordered_map<std::string, Object *> store;
+        std::vector<Object *> values;
         Environment *outerEnvironment = nullptr;
+        Environment *global;
 
-        Environment() = default;
-        Environment(Environment *outerEnv) : outerEnvironment{outerEnv} {};
+        // Number no other environment gets, unlike the address which a later environment can reuse once this one is
+        // deleted. Inline caches are keyed by it. Environments are only made by the single evaluating thread.
+        const uint64_t id;
+
+        // Function literal of the call, its parameters and locals name the slots. nullptr for the global environment.
+        const ast::FunctionLiteral *function = nullptr;
+
+        Environment() : global{this}, id{nextId++} {};
+
+        // Environment of a call of the resolved function literal, enclosed by the environment the function was made in
+        Environment(Environment *outerEnv, const ast::FunctionLiteral *calledFunction)
+            : values(calledFunction->slotCount), outerEnvironment{outerEnv}, global{outerEnv->global},
+              id{nextId++}, function{calledFunction}
+        {
+        }
 
         ~Environment()
         {
-            for (auto el : store)
+            for (auto *value : values)
             {
-                if (el.second)
-                    delete el.second;
+                if (value)
+                    delete value;
             }
         }
 
         Environment(const Environment &) = delete;
         Environment &operator=(const Environment &) = delete;
 
-        Object *get(const std::string &name) const;
+        // Returns the value bound to the symbol in this or an outer environment, nullptr if it is unbound
+        Object *get(token::Symbol name) const;
+
+        // Returns the value of the variable the identifier refers to, nullptr if it is unbound. Resolved identifiers
+        // are read straight from their slot, falling back to a lookup by symbol while the slot is still empty.
+        Object *get(const ast::Identifier &identifier) const
+        {
+            if (identifier.depth == ast::GLOBAL_DEPTH)
+            {
+                const auto &globals = global->values;
+                return identifier.symbol < globals.size() ? globals[identifier.symbol] : nullptr;
+            }
+
+            if (identifier.depth == ast::UNRESOLVED_DEPTH)
+            {
+                return get(identifier.symbol);
+            }
+
+            const Environment *env = enclosing(identifier.depth);
+            if (Object *value = env->values[identifier.slot])
+            {
+                return value;
+            }
+
+            return getOuter(env, identifier.symbol);
+        }
+
+        // Returns the environment of the call depth calls out from this one
+        const Environment *enclosing(uint32_t depth) const
+        {
+            const Environment *env = this;
+            for (; depth > 0; --depth)
+            {
+                env = env->outerEnvironment;
+            }
+
+            return env;
+        }
+
+        // Binds the symbol in this environment, a symbol that is bound already keeps its value
+        Object *set(token::Symbol name, Object *value);
+
+        // Binds the slot of this call's environment, a slot that is bound already keeps its value
+        Object *setSlot(uint32_t slot, Object *value)
+        {
+            if (!values[slot])
+                values[slot] = value;
+
+            return value;
+        }
+
+    private:
+        // id of the next environment made, 0 is left for no environment
+        static uint64_t nextId;
 
-        Object *set(const std::string &name, Object *value);
+        // Looks the symbol up outside the environment whose slot for it is still empty
+        static Object *getOuter(const Environment *env, token::Symbol name);
     };
 }
@@ -1,18 +1,34 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include "ast.hpp"
 
 namespace object
 {
-    using ObjectType = std::string_view;
-
     // Data Types
-    constexpr ObjectType INTEGER_OBJ = "INTEGJER";
-    constexpr ObjectType BOOLEAN_OBJ = "BOOLEAN";
-    constexpr ObjectType NULL_OBJ = "NULL";
-    constexpr ObjectType RETURN_VALUE_OBJ = "VLERAKTHIMIT";
-    constexpr ObjectType FUNC_OBJECT = "FUNKSION";
-    constexpr ObjectType ERROR_OBJ = "ERROR";
+    enum ObjectType : uint8_t
+    {
+        INTEGER_OBJ,
+        BOOLEAN_OBJ,
+        NULL_OBJ,
+        RETURN_VALUE_OBJ,
+        FUNC_OBJECT,
+        ERROR_OBJ,
+
+        OBJECT_TYPE_COUNT
+    };
+
+    // Name of every ObjectType as error messages print it, indexed by the type
+    constexpr std::array<std::string_view, OBJECT_TYPE_COUNT> objectTypeNames{
+        "INTEGJER", "BOOLEAN", "NULL", "VLERAKTHIMIT", "FUNKSION", "ERROR"};
+
+    inline std::ostream &operator<<(std::ostream &out, ObjectType type)
+    {
+        return out << objectTypeNames[type];
+    }
 
     // Error Messages
     constexpr std::string_view TYPE_MISMATCH_ERR = "mospërputhje i tipit";
@@ -79,25 +95,16 @@ namespace object
     class Function : public Object
     {
     public:
-        std::vector<ast::Identifier *> parameters;
+        const ast::FunctionLiteral *literal;
+        const ast::NodeList<ast::Identifier> &parameters;
         ast::BlockStatement *body;
         Environment *env;
 
-        Function() = default;
-        Function(std::vector<ast::Identifier *> params,
-                 ast::BlockStatement *funcBody,
-                 Environment *currentEnv)
-            : parameters{params}, body{funcBody}, env{currentEnv}
-        {
-        }
-
-        ~Function()
+        // The literal belongs to the program's arena, which has to outlive the function
+        Function(const ast::FunctionLiteral *functionLiteral, Environment *currentEnv)
+            : literal{functionLiteral}, parameters{functionLiteral->parameters}, body{functionLiteral->body},
+              env{currentEnv}
         {
-            for (const auto &param : parameters)
-            {
-                if (param)
-                    delete param;
-            }
         }
 
         ObjectType type() const override;
@@ -0,0 +1,455 @@
+#include "optimizer.hpp"
+#include <cstdint>
+#include <limits>
+#include <string>
+
+using namespace optimizer;
+
+namespace
+{
+    constexpr int64_t MAX_INTEGER = std::numeric_limits<int64_t>::max();
+    constexpr int64_t MIN_INTEGER = std::numeric_limits<int64_t>::min();
+
+    // Returns whether the expression is there and of the kind, expressions the parser gave up on are missing
+    bool isKind(const ast::Expression *expression, ast::NodeKind kind)
+    {
+        return expression && expression->kind == kind;
+    }
+
+    // Returns the expression as the integer literal it is, or nullptr when it is anything else
+    ast::IntegerLiteral *asIntegerLiteral(ast::Expression *expression)
+    {
+        return isKind(expression, ast::NodeKind::INTEGER_LITERAL) ? static_cast<ast::IntegerLiteral *>(expression)
+                                                                  : nullptr;
+    }
+
+    // Returns the expression as the boolean it is, or nullptr when it is anything else
+    ast::Boolean *asBoolean(ast::Expression *expression)
+    {
+        return isKind(expression, ast::NodeKind::BOOLEAN) ? static_cast<ast::Boolean *>(expression) : nullptr;
+    }
+
+    bool isIntegerLiteral(const ast::Expression *expression, int64_t value)
+    {
+        return isKind(expression, ast::NodeKind::INTEGER_LITERAL) &&
+               static_cast<const ast::IntegerLiteral *>(expression)->value == value;
+    }
+
+    bool isArithmetic(ast::Operator op)
+    {
+        return op == ast::Operator::PLUS || op == ast::Operator::MINUS || op == ast::Operator::MULTIPLY ||
+               op == ast::Operator::DIVIDE;
+    }
+
+    // Returns whether evaluating the expression yields either an error or a new integer that nothing else refers
+    // to. Only those operands can replace x * 1 or x + 0, the minus operator negates the integer it gets in place
+    // and would otherwise reach a value that is also stored in a variable.
+    bool yieldsFreshInteger(const ast::Expression *expression)
+    {
+        if (!expression)
+        {
+            return false;
+        }
+
+        switch (expression->kind)
+        {
+        case ast::NodeKind::INTEGER_LITERAL:
+            return true;
+        case ast::NodeKind::PREFIX_EXPRESSION:
+        {
+            auto *prefix = static_cast<const ast::PrefixExpression *>(expression);
+            return prefix->op == ast::Operator::MINUS && yieldsFreshInteger(prefix->right);
+        }
+        case ast::NodeKind::INFIX_EXPRESSION:
+            return isArithmetic(static_cast<const ast::InfixExpression *>(expression)->op);
+        default:
+            return false;
+        }
+    }
+
+    // Computes left op right the way the evaluator does. Returns false where the evaluator wouldn't produce a
+    // well defined integer: division by zero and results that overflow.
+    bool computeArithmetic(ast::Operator op, int64_t left, int64_t right, int64_t &result)
+    {
+        switch (op)
+        {
+        case ast::Operator::PLUS:
+            if ((right > 0 && left > MAX_INTEGER - right) || (right < 0 && left < MIN_INTEGER - right))
+                return false;
+            result = left + right;
+            return true;
+        case ast::Operator::MINUS:
+            if ((right < 0 && left > MAX_INTEGER + right) || (right > 0 && left < MIN_INTEGER + right))
+                return false;
+            result = left - right;
+            return true;
+        case ast::Operator::MULTIPLY:
+            if ((left == -1 && right == MIN_INTEGER) || (right == -1 && left == MIN_INTEGER))
+                return false;
+            result = static_cast<int64_t>(static_cast<uint64_t>(left) * static_cast<uint64_t>(right));
+            return left == 0 || result / left == right;
+        case ast::Operator::DIVIDE:
+            if (right == 0 || (left == MIN_INTEGER && right == -1))
+                return false;
+            result = left / right;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Compares left op right the way the evaluator does, returns false for operators that aren't comparisons
+    bool compareIntegers(ast::Operator op, int64_t left, int64_t right, bool &result)
+    {
+        switch (op)
+        {
+        case ast::Operator::LESS:
+            result = left < right;
+            return true;
+        case ast::Operator::GREATER:
+            result = left > right;
+            return true;
+        case ast::Operator::EQUAL:
+            result = left == right;
+            return true;
+        case ast::Operator::NOT_EQUAL:
+            result = left != right;
+            return true;
+        case ast::Operator::LESS_EQUAL:
+            result = left <= right;
+            return true;
+        case ast::Operator::GREATER_EQUAL:
+            result = left >= right;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Rewrites the nodes of one program, making new nodes in the program's arena
+    class Optimizer
+    {
+    public:
+        Statistics statistics;
+
+        explicit Optimizer(ast::Arena &arena) : arena{arena}
+        {
+        }
+
+        // Optimizes every statement of the list, statements made redundant by a constant condition are
+        // replaced by the ones that actually run
+        void optimizeStatements(ast::NodeList<ast::Statement> &statements);
+
+    private:
+        ast::Arena &arena;
+
+        void optimizeStatement(ast::Statement *statement);
+
+        // Returns the expression that replaces the given one, which may be the given one itself
+        ast::Expression *optimizeExpression(ast::Expression *expression);
+
+        ast::Expression *optimizePrefix(ast::PrefixExpression *expression);
+        ast::Expression *optimizeInfix(ast::InfixExpression *expression);
+        ast::Expression *optimizeIf(ast::IfExpression *expression);
+
+        ast::Expression *makeInteger(int64_t value);
+        ast::Expression *makeBoolean(bool value);
+    };
+
+    // Returns whether the condition is a constant, which is then evaluated to truthy the way the evaluator does:
+    // booleans are their value and integers are always true
+    bool isConstantCondition(const ast::Expression *condition, bool &truthy)
+    {
+        if (isKind(condition, ast::NodeKind::BOOLEAN))
+        {
+            truthy = static_cast<const ast::Boolean *>(condition)->value;
+            return true;
+        }
+
+        if (isKind(condition, ast::NodeKind::INTEGER_LITERAL))
+        {
+            truthy = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Returns the nese expression the statement consists of when its condition is constant
+    ast::IfExpression *constantIfStatement(ast::Statement *statement)
+    {
+        if (!statement || statement->kind != ast::NodeKind::EXPRESSION_STATEMENT)
+        {
+            return nullptr;
+        }
+
+        ast::Expression *expression = static_cast<ast::ExpressionStatement *>(statement)->expression;
+        if (!isKind(expression, ast::NodeKind::IF_EXPRESSION))
+        {
+            return nullptr;
+        }
+
+        auto *ifExpression = static_cast<ast::IfExpression *>(expression);
+        bool truthy;
+        return isConstantCondition(ifExpression->condition, truthy) ? ifExpression : nullptr;
+    }
+}
+
+void Optimizer::optimizeStatements(ast::NodeList<ast::Statement> &statements)
+{
+    ast::NodeList<ast::Statement> optimized = arena.list<ast::Statement>();
+    optimized.reserve(statements.size());
+
+    for (size_t index = 0; index < statements.size(); ++index)
+    {
+        ast::Statement *statement = statements[index];
+        optimizeStatement(statement);
+
+        // A block runs its statements in the enclosing environment and stops at the same return or error, so the
+        // statements of the branch that runs can stand in for the nese statement. Its value is only kept for the
+        // last statement of a list, which has to stay when no branch or an empty one runs.
+        ast::IfExpression *ifExpression = constantIfStatement(statement);
+        if (ifExpression)
+        {
+            bool truthy;
+            isConstantCondition(ifExpression->condition, truthy);
+
+            const bool isLast = index + 1 == statements.size();
+            ast::BlockStatement *taken = truthy ? ifExpression->consequence : nullptr;
+            if (!isLast || (taken && !taken->statements.empty()))
+            {
+                if (taken)
+                {
+                    optimized.insert(optimized.end(), taken->statements.begin(), taken->statements.end());
+                }
+
+                ++statistics.inlinedBranches;
+                continue;
+            }
+        }
+
+        optimized.push_back(statement);
+    }
+
+    statements = std::move(optimized);
+}
+
+void Optimizer::optimizeStatement(ast::Statement *statement)
+{
+    if (!statement)
+    {
+        return;
+    }
+
+    switch (statement->kind)
+    {
+    case ast::NodeKind::VAR_STATEMENT:
+    {
+        auto *varStatement = static_cast<ast::VarStatement *>(statement);
+        varStatement->expression = optimizeExpression(varStatement->expression);
+        break;
+    }
+    case ast::NodeKind::RETURN_STATEMENT:
+    {
+        auto *returnStatement = static_cast<ast::ReturnStatement *>(statement);
+        returnStatement->returnValue = optimizeExpression(returnStatement->returnValue);
+        break;
+    }
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+    {
+        auto *expressionStatement = static_cast<ast::ExpressionStatement *>(statement);
+        expressionStatement->expression = optimizeExpression(expressionStatement->expression);
+        break;
+    }
+    case ast::NodeKind::BLOCK_STATEMENT:
+        optimizeStatements(static_cast<ast::BlockStatement *>(statement)->statements);
+        break;
+    default:
+        break;
+    }
+}
+
+ast::Expression *Optimizer::optimizeExpression(ast::Expression *expression)
+{
+    // Nothing to do where the parser gave up on an expression
+    if (!expression)
+    {
+        return expression;
+    }
+
+    switch (expression->kind)
+    {
+    case ast::NodeKind::PREFIX_EXPRESSION:
+        return optimizePrefix(static_cast<ast::PrefixExpression *>(expression));
+    case ast::NodeKind::INFIX_EXPRESSION:
+        return optimizeInfix(static_cast<ast::InfixExpression *>(expression));
+    case ast::NodeKind::IF_EXPRESSION:
+        return optimizeIf(static_cast<ast::IfExpression *>(expression));
+    case ast::NodeKind::FUNCTION_LITERAL:
+        optimizeStatements(static_cast<ast::FunctionLiteral *>(expression)->body->statements);
+        return expression;
+    case ast::NodeKind::CALL_EXPRESSION:
+    {
+        auto *call = static_cast<ast::CallExpression *>(expression);
+        call->function = optimizeExpression(call->function);
+        for (auto *&argument : call->arguments)
+        {
+            argument = optimizeExpression(argument);
+        }
+        return call;
+    }
+    default:
+        // Literals and identifiers
+        return expression;
+    }
+}
+
+ast::Expression *Optimizer::optimizePrefix(ast::PrefixExpression *expression)
+{
+    expression->right = optimizeExpression(expression->right);
+
+    if (expression->op == ast::Operator::NOT)
+    {
+        // The evaluator negates booleans and turns every other value into falso
+        if (auto *boolean = asBoolean(expression->right))
+        {
+            ++statistics.folded;
+            return makeBoolean(!boolean->value);
+        }
+
+        if (asIntegerLiteral(expression->right))
+        {
+            ++statistics.folded;
+            return makeBoolean(false);
+        }
+    }
+    else if (expression->op == ast::Operator::MINUS)
+    {
+        auto *integer = asIntegerLiteral(expression->right);
+        if (integer && integer->value != MIN_INTEGER)
+        {
+            ++statistics.folded;
+            return makeInteger(-integer->value);
+        }
+    }
+
+    return expression;
+}
+
+ast::Expression *Optimizer::optimizeInfix(ast::InfixExpression *expression)
+{
+    expression->left = optimizeExpression(expression->left);
+    expression->right = optimizeExpression(expression->right);
+
+    const ast::Operator op = expression->op;
+    auto *leftInteger = asIntegerLiteral(expression->left);
+    auto *rightInteger = asIntegerLiteral(expression->right);
+    if (leftInteger && rightInteger)
+    {
+        int64_t value;
+        if (isArithmetic(op) && computeArithmetic(op, leftInteger->value, rightInteger->value, value))
+        {
+            ++statistics.folded;
+            return makeInteger(value);
+        }
+
+        bool comparison;
+        if (compareIntegers(op, leftInteger->value, rightInteger->value, comparison))
+        {
+            ++statistics.folded;
+            return makeBoolean(comparison);
+        }
+
+        return expression;
+    }
+
+    auto *leftBoolean = asBoolean(expression->left);
+    auto *rightBoolean = asBoolean(expression->right);
+    if (leftBoolean && rightBoolean && (op == ast::Operator::EQUAL || op == ast::Operator::NOT_EQUAL))
+    {
+        ++statistics.folded;
+        return makeBoolean((leftBoolean->value == rightBoolean->value) == (op == ast::Operator::EQUAL));
+    }
+
+    // Identities hold only for integer operands, on any other value the evaluator reports an error
+    ast::Expression *simplified = nullptr;
+    const bool isMultiplication = op == ast::Operator::MULTIPLY;
+    const bool isAddition = op == ast::Operator::PLUS;
+    if (((isMultiplication || op == ast::Operator::DIVIDE) && isIntegerLiteral(expression->right, 1)) ||
+        ((isAddition || op == ast::Operator::MINUS) && isIntegerLiteral(expression->right, 0)))
+    {
+        simplified = expression->left;
+    }
+    else if ((isMultiplication && isIntegerLiteral(expression->left, 1)) ||
+             (isAddition && isIntegerLiteral(expression->left, 0)))
+    {
+        simplified = expression->right;
+    }
+
+    if (simplified && yieldsFreshInteger(simplified))
+    {
+        ++statistics.simplified;
+        return simplified;
+    }
+
+    return expression;
+}
+
+ast::Expression *Optimizer::optimizeIf(ast::IfExpression *expression)
+{
+    expression->condition = optimizeExpression(expression->condition);
+    optimizeStatements(expression->consequence->statements);
+    if (expression->alternative)
+    {
+        optimizeStatements(expression->alternative->statements);
+    }
+
+    bool truthy;
+    if (!isConstantCondition(expression->condition, truthy))
+    {
+        return expression;
+    }
+
+    // Only the consequence is left, behind a condition that picks it exactly when it ran before
+    if (truthy && expression->alternative)
+    {
+        expression->alternative = nullptr;
+        ++statistics.prunedBranches;
+    }
+    else if (!truthy && expression->alternative)
+    {
+        expression->condition = makeBoolean(true);
+        expression->consequence = expression->alternative;
+        expression->alternative = nullptr;
+        ++statistics.prunedBranches;
+    }
+    else if (!truthy && !expression->consequence->statements.empty())
+    {
+        expression->consequence = arena.make<ast::BlockStatement>(expression->consequence->token,
+                                                                  arena.list<ast::Statement>());
+        ++statistics.prunedBranches;
+    }
+
+    return expression;
+}
+
+ast::Expression *Optimizer::makeInteger(int64_t value)
+{
+    // toString prints integers by their literal, so the folded value gets one of its own
+    const token::Token integerToken{token::INT, arena.copy(std::to_string(value))};
+    return arena.make<ast::IntegerLiteral>(integerToken, value);
+}
+
+ast::Expression *Optimizer::makeBoolean(bool value)
+{
+    const token::Token booleanToken{value ? token::TRUE : token::FALSE, value ? "vertet" : "falso"};
+    return arena.make<ast::Boolean>(booleanToken, value);
+}
+
+Statistics optimizer::optimize(ast::Program &program)
+{
+    Optimizer optimizer(*program.arena);
+    optimizer.optimizeStatements(program.statements);
+
+    return optimizer.statistics;
+}
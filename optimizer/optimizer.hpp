@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include "ast.hpp"
+
+namespace optimizer
+{
+    // Number of rewrites a pass made, by kind
+    struct Statistics
+    {
+        size_t folded = 0;          // Prefix and infix expressions of constants replaced by their value
+        size_t simplified = 0;      // x * 1, x / 1, x + 0 and x - 0 replaced by x
+        size_t prunedBranches = 0;  // Branches of nese expressions with a constant condition that can't run
+        size_t inlinedBranches = 0; // nese statements with a constant condition replaced by the branch that runs
+    };
+
+    // Rewrites a parsed program in place so it evaluates to the same result with less work. New nodes are made
+    // in the program's arena. Expressions whose evaluation would fail, like a division by zero or operands of
+    // mismatched types, are left as they are so the evaluator reports the same error at the same point.
+    Statistics optimize(ast::Program &program);
+}
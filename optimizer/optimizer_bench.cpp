@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "optimizer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Number of times every script is evaluated, the fastest run is reported
+constexpr int RUNS = 5;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Evaluates the script as parsed and after optimizing it, the optimization itself is timed separately
+void benchmarkScript(const std::string &name, const std::string &script)
+{
+    double best[2] = {1e300, 1e300};
+    double bestOptimize = 1e300;
+    std::string results[2];
+    optimizer::Statistics statistics;
+
+    for (int optimized = 0; optimized < 2; ++optimized)
+    {
+        for (int run = 0; run < RUNS; ++run)
+        {
+            Parser parser(new lexer::Lexer(script));
+            ast::Program *program = parser.parseProgram();
+
+            if (optimized)
+            {
+                const auto optimizeStart = Clock::now();
+                statistics = optimizer::optimize(*program);
+                bestOptimize = std::min(bestOptimize, millisecondsSince(optimizeStart));
+            }
+
+            auto *env = new object::Environment();
+            const auto start = Clock::now();
+            object::Object *evaluated = evaluator::evaluate(program, env);
+            best[optimized] = std::min(best[optimized], millisecondsSince(start));
+
+            results[optimized] = evaluated ? evaluated->inspect() : "null";
+            delete program;
+        }
+    }
+
+    std::cout << name << ":\n"
+              << "\tas parsed: " << best[0] << " ms (result " << results[0] << ")\n"
+              << "\toptimized: " << best[1] << " ms (result " << results[1] << "), optimizing took "
+              << bestOptimize << " ms\n"
+              << "\t" << statistics.folded << " folded, " << statistics.simplified << " simplified, "
+              << statistics.prunedBranches << " branches pruned, " << statistics.inlinedBranches << " inlined"
+              << std::endl;
+}
+
+int main()
+{
+    // Constant subexpressions and debug branches inside a hot recursive function
+    benchmarkScript("constant heavy recursion", R"(
+var debug = falso;
+var hapi = funksion(n) {
+    nese (debug == vertet) { kthen 0; }
+    nese (n < (2 * 3 - 5)) { kthen n * 1; }
+    var x = (5 + 10 * 2 + 15 / 3) * 2 + -10;
+    nese (!falso) {
+        hapi(n - 1) + hapi(n - (1 + 1)) + x / (25 * 2) - 1 + 0
+    }
+};
+hapi(20);
+)");
+
+    // Nothing to fold, shows the pass costs nothing at evaluation time when it finds no work
+    benchmarkScript("fib(22)", R"(
+var fib = funksion(n) {
+    nese (n < 2) { kthen n; }
+    kthen fib(n - 1) + fib(n - 2);
+};
+fib(22);
+)");
+
+    return 0;
+}
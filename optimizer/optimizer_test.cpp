@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "optimizer.hpp"
+
+ast::Program *parse(const std::string &input)
+{
+    Parser parser(new lexer::Lexer(input));
+    ast::Program *program = parser.parseProgram();
+    assert(parser.getErrors().empty() && "input has parse errors");
+
+    return program;
+}
+
+// Evaluates the program in a new environment, the result is printed so errors compare by their message
+std::string evaluateToString(ast::Program *program)
+{
+    object::Object *result = evaluator::evaluate(program, new object::Environment());
+    return result ? result->inspect() : "null";
+}
+
+void testOptimizedPrograms()
+{
+    struct OptimizerTestCase
+    {
+        std::string input;
+        std::string expected; // toString of the optimized program
+    };
+
+    std::vector<OptimizerTestCase> tests{
+        {"(5 + 10 * 2 + 15 / 3) * 2 + -10", "50"},
+        {"-(-5)", "5"},
+        {"!vertet", "falso"},
+        {"!!5", "vertet"},
+        {"1 < 2 == vertet", "vertet"},
+        {"vertet != falso", "vertet"},
+        {"(x + 2) * 1", "(x + 2)"},
+        {"0 + (x - 1) / 1", "(x - 1)"},
+        {"1 * -(2 * x) - 0", "(-(2 * x))"},
+        {"var a = 2 * 3 + b * (4 - 3);", "var a = (6 + (b * 1));"},
+
+        // Errors and values of unknown type are left for the evaluator
+        {"5 / 0", "(5 / 0)"},
+        {"x / (1 - 1)", "(x / 0)"},
+        {"5 + vertet", "(5 + vertet)"},
+        {"vertet + falso", "(vertet + falso)"},
+        {"-vertet", "(-vertet)"},
+        {"x * 1", "(x * 1)"},
+        {"0 + f(2)", "(0 + f(2))"},
+        {"9223372036854775807 + 1", "(9223372036854775807 + 1)"},
+
+        // Branches with constant conditions
+        {"nese (1 < 2) { 10 } perndryshe { 20 }", "10"},
+        {"nese (1 > 2) { 10 } perndryshe { 20 }", "20"},
+        {"nese (1 > 2) { 10 }; 5", "5"},
+        {"nese (1 > 2) { 10 }", "nesefalso "},
+        {"nese (vertet) { }", "nesevertet "},
+        {"var x = nese (1 > 2) { 10 } perndryshe { y };", "var x = nesevertet y;"},
+        {"nese (x) { 1 + 1 } perndryshe { 2 * 2 }", "nesex 2perndryshe4"},
+        {"funksion(x) { nese (vertet) { kthen x * (2 + 2); } }", "funksion(x)kthen (x * 4);"},
+    };
+
+    std::cout << "-------------[Optimizer Test]------------\n";
+    for (const auto &test : tests)
+    {
+        std::cout << "TEST: " << test.input;
+
+        ast::Program *program = parse(test.input);
+        optimizer::optimize(*program);
+        if (program->toString() != test.expected)
+        {
+            std::cout << "\n\texpected: " << test.expected << "\n\tgot:      " << program->toString() << std::endl;
+        }
+        assert(program->toString() == test.expected && "optimized program differs");
+
+        // A second pass finds nothing left to do
+        const optimizer::Statistics again = optimizer::optimize(*program);
+        assert(again.folded == 0 && again.simplified == 0 && again.prunedBranches == 0 && again.inlinedBranches == 0);
+
+        delete program;
+        std::cout << "\tPASSED!\n";
+    }
+
+    std::cout << "\t ALL OPTIMIZER TESTS PASSED!\n";
+    std::cout << "---------------------------------------------------" << std::endl;
+}
+
+void testSameEvaluation()
+{
+    std::vector<std::string> inputs{
+        "(5 + 10 * 2 + 15 / 3) * 2 + -10",
+        "50 / 2 * 2 + 10",
+        "!!5; !(1 < 2) == falso",
+        "(1 > 2) == falso",
+        "var a = 5; var b = a * 1 + 0; b",
+        "var a = 5; -a; a",
+        "var a = 5; var b = -a + 0; -b; a",
+        "var a = 5; var b = -a * 1; -b; a",
+        "nese (vertet) { 10 }",
+        "nese (falso) { 10 }",
+        "nese (1) { 10 }",
+        "nese (1 > 2) { 10 } perndryshe { 20 }",
+        "nese (1 > 2) { 10 }; 5",
+        "nese (vertet) { }",
+        "var a = 1; nese (vertet) { var a = 2; } a",
+        "var a = 1; nese (vertet) { var a = 2; }",
+        "9; kthen 2 * 5; 9;",
+        "nese (10 > 1) { nese (10 > 1) { kthen 10; } kthen 1; }",
+        "nese (10 > 1) { nese (10 > 1) { kthen vertet + falso; } kthen 1; }",
+        "var f = funksion(x) { nese (1 < 2) { kthen x * 1 + 0; } x }; f(3 * 3)",
+        "var add = funksion(x, y) { x + y; }; add(5 + 5, add(5 * 1, 0 + 5));",
+        "var f = funksion(x) { x }; f(vertet) * 1",
+        "5 + vertet; 5;",
+        "-vertet",
+        "vertet + falso",
+        "(vertet + falso) * 1",
+        "0 + -(vertet)",
+        "5; vertet + falso; 5",
+        "foobar * 1;",
+        "nese (2 * 3 == 6) { foobar }",
+    };
+
+    std::cout << "-------------[Optimized Evaluation Test]------------\n";
+    for (const auto &input : inputs)
+    {
+        std::cout << "TEST: " << input;
+
+        ast::Program *original = parse(input);
+        ast::Program *optimized = parse(input);
+        optimizer::optimize(*optimized);
+
+        const std::string expected = evaluateToString(original);
+        const std::string got = evaluateToString(optimized);
+        if (got != expected)
+        {
+            std::cout << "\n\texpected: " << expected << "\n\tgot:      " << got << std::endl;
+        }
+        assert(got == expected && "optimized program evaluates differently");
+
+        delete original;
+        delete optimized;
+        std::cout << "\tPASSED!\n";
+    }
+
+    std::cout << "\t ALL OPTIMIZED EVALUATION TESTS PASSED!\n";
+    std::cout << "---------------------------------------------------" << std::endl;
+}
+
+void testStatistics()
+{
+    ast::Program *program = parse(R"(
+var a = 2 * 3 + -4;
+var b = a * 1;
+var c = (a - 1) * 1;
+nese (1 < 2) { c } perndryshe { b };
+nese (falso) { a };
+c;
+)");
+
+    const optimizer::Statistics statistics = optimizer::optimize(*program);
+    assert(statistics.folded == 4 && "2 * 3, -4, + and 1 < 2 are folded");
+    assert(statistics.simplified == 1 && "only the operand of known type is simplified");
+    assert(statistics.prunedBranches == 2);
+    assert(statistics.inlinedBranches == 2);
+    assert(program->statements.size() == 5);
+
+    delete program;
+    std::cout << "OPTIMIZER STATISTICS TESTS PASSED!" << std::endl;
+}
+
+int main()
+{
+    testOptimizedPrograms();
+    testSameEvaluation();
+    testStatistics();
+
+    return 0;
+}
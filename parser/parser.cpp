@@ -1,19 +1,55 @@
 #include "parser.hpp"
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <sstream>
 
-// Mapping each operator to its precedence
-std::unordered_map<token::TokenType, Precedence> precedences{
-    {token::EQ, Precedence::EQUALS},
-    {token::NOT_EQ, Precedence::EQUALS},
-    {token::LT, Precedence::LESSGREATER},
-    {token::GT, Precedence::LESSGREATER},
-    {token::PLUS, Precedence::SUM},
-    {token::MINUS, Precedence::SUM},
-    {token::SLASH, Precedence::PRODUCT},
-    {token::ASTERISK, Precedence::PRODUCT},
-    {token::LPAREN, Precedence::CALL},
-};
+// Mapping each token type to its precedence, types that are not operators stay at Precedence::LOWEST
+constexpr std::array<Precedence, token::TOKEN_TYPE_COUNT> precedences = []
+{
+    std::array<Precedence, token::TOKEN_TYPE_COUNT> table{};
+    table[token::EQ] = Precedence::EQUALS;
+    table[token::NOT_EQ] = Precedence::EQUALS;
+    table[token::LT] = Precedence::LESSGREATER;
+    table[token::GT] = Precedence::LESSGREATER;
+    table[token::PLUS] = Precedence::SUM;
+    table[token::MINUS] = Precedence::SUM;
+    table[token::SLASH] = Precedence::PRODUCT;
+    table[token::ASTERISK] = Precedence::PRODUCT;
+    table[token::LPAREN] = Precedence::CALL;
+    return table;
+}();
+
+const std::array<PrefixRule, token::TOKEN_TYPE_COUNT> Parser::prefixRules = []
+{
+    std::array<PrefixRule, token::TOKEN_TYPE_COUNT> table{};
+    table[token::IDENT] = {PrefixKind::OPERAND, &Parser::parseIdentifier};
+    table[token::INT] = {PrefixKind::OPERAND, &Parser::parseIntegerLiteral};
+    table[token::TRUE] = {PrefixKind::OPERAND, &Parser::parseBoolean};
+    table[token::FALSE] = {PrefixKind::OPERAND, &Parser::parseBoolean};
+    table[token::IF] = {PrefixKind::OPERAND, &Parser::parseIfExpression};
+    table[token::FUNCTION] = {PrefixKind::OPERAND, &Parser::parseFunctionLiteral};
+    table[token::LPAREN] = {PrefixKind::GROUP, nullptr};
+    table[token::BANG] = {PrefixKind::PREFIX_OPERATOR, nullptr};
+    table[token::MINUS] = {PrefixKind::PREFIX_OPERATOR, nullptr};
+    return table;
+}();
+
+const std::array<InfixKind, token::TOKEN_TYPE_COUNT> Parser::infixKinds = []
+{
+    std::array<InfixKind, token::TOKEN_TYPE_COUNT> table{};
+    table[token::PLUS] = InfixKind::OPERATOR;
+    table[token::MINUS] = InfixKind::OPERATOR;
+    table[token::SLASH] = InfixKind::OPERATOR;
+    table[token::ASTERISK] = InfixKind::OPERATOR;
+    table[token::EQ] = InfixKind::OPERATOR;
+    table[token::NOT_EQ] = InfixKind::OPERATOR;
+    table[token::LT] = InfixKind::OPERATOR;
+    table[token::GT] = InfixKind::OPERATOR;
+    // TODO: Add support for <= and >=
+    table[token::LPAREN] = InfixKind::CALL;
+    return table;
+}();
 
 void Parser::peekError(token::TokenType type)
 {
@@ -29,86 +65,72 @@ void Parser::noPrefixParseFnError(token::TokenType type)
     errors.push_back(oss.str());
 }
 
-Parser::Parser(lexer::Lexer *lexer) : lexer{lexer}
+Parser::Parser(lexer::Lexer *lexer) : Parser(lexer, nullptr)
+{
+}
+
+Parser::Parser(lexer::TokenBuffer *tokens) : Parser(nullptr, tokens)
+{
+}
+
+Parser::Parser(lexer::Lexer *lexer, lexer::TokenBuffer *tokens)
+    : lexer{lexer}, tokens{tokens}, arena{std::make_shared<ast::Arena>()}
 {
     // Reminder: Call to times cus in the first call
     // peekToken is empty and is assigned to currentToken
     nextToken();
     nextToken();
+}
 
-    registerPrefix(token::IDENT,
-                   [this]
-                   { return this->parseIdentifier(); });
-
-    registerPrefix(token::INT,
-                   [this]
-                   { return this->parseIntegerLiteral(); });
-
-    registerPrefix(token::TRUE,
-                   [this]
-                   { return this->parseBoolean(); });
-    registerPrefix(token::FALSE,
-                   [this]
-                   { return this->parseBoolean(); });
-
-    registerPrefix(token::LPAREN,
-                   [this]
-                   { return this->parseGroupedExpression(); });
-
-    registerPrefix(token::IF,
-                   [this]
-                   { return this->parseIfExpression(); });
-
-    registerPrefix(token::FUNCTION,
-                   [this]
-                   { return this->parseFunctionLiteral(); });
+void Parser::nextToken()
+{
+    currentToken = peekToken;
+    peekToken = tokens ? tokens->at(nextTokenIndex++) : lexer->nextToken();
+}
 
-    auto prefixParser = [this]
+token::Token Parser::lookahead(size_t distance) const
+{
+    if (distance == 0)
     {
-        return this->parsePrefixExpression();
-    };
-
-    registerPrefix(token::BANG, prefixParser);
-    registerPrefix(token::MINUS, prefixParser);
+        return currentToken;
+    }
 
-    auto infixParser = [this](ast::Expression *left)
+    if (tokens)
     {
-        return this->parseInfixExpression(left);
-    };
-
-    registerInfix(token::PLUS, infixParser);
-    registerInfix(token::MINUS, infixParser);
-    registerInfix(token::SLASH, infixParser);
-    registerInfix(token::ASTERISK, infixParser);
-    registerInfix(token::EQ, infixParser);
-    registerInfix(token::NOT_EQ, infixParser);
-    registerInfix(token::LT, infixParser);
-    registerInfix(token::GT, infixParser);
-    // TODO: Add support for <= and >=
-
-    registerInfix(token::LPAREN,
-                  [this](ast::Expression *function)
-                  { return this->parseCallExpression(function); });
-}
+        // nextTokenIndex - 1 is the peek token, which is one token after the current one
+        return tokens->at(nextTokenIndex - 2 + distance);
+    }
 
-void Parser::nextToken()
-{
-    currentToken = peekToken;
-    peekToken = lexer->nextToken();
+    return distance == 1 ? peekToken : token::Token{token::ILLEGAL, {}};
 }
 
 ast::Program *Parser::parseProgram()
 {
-    auto *program = new ast::Program();
-    while (!currentTokenIs(token::EOF_))
+    auto *program = new ast::Program(arena);
+    program->source = tokens ? tokens->source : lexer->source;
+
+    try
     {
-        ast::Statement *statement = parseStatement();
-        if (statement != nullptr)
+        while (!currentTokenIs(token::EOF_))
         {
-            program->statements.push_back(statement);
+            ast::Statement *statement = parseStatement();
+            if (statement != nullptr)
+            {
+                program->statements.push_back(statement);
+            }
+
+            nextToken();
         }
+    }
+    catch (const NestingLimitExceeded &)
+    {
+        // Nodes of the abandoned statement stay in the arena, they are freed with the program
+        expressionFrames.clear();
+        expressionDepth = 0;
 
-        nextToken();
+        std::ostringstream oss;
+        oss << "Input is nested deeper than the limit of " << nestingLimit << " levels.";
+        errors.push_back(oss.str());
     }
 
     return program;
@@ -132,7 +154,7 @@ ast::Statement *Parser::parseStatement()
 
 ast::VarStatement *Parser::parseVarStatement()
 {
-    auto *statement = new ast::VarStatement();
+    auto *statement = arena->make<ast::VarStatement>();
     statement->token = currentToken;
 
     if (!expectPeek(token::IDENT))
@@ -140,7 +162,7 @@ ast::VarStatement *Parser::parseVarStatement()
         return nullptr;
     }
 
-    statement->name = new ast::Identifier(currentToken, currentToken.literal);
+    statement->name = arena->make<ast::Identifier>(currentToken);
 
     if (!expectPeek(token::ASSIGN))
     {
@@ -161,7 +183,7 @@ ast::VarStatement *Parser::parseVarStatement()
 
 ast::ReturnStatement *Parser::parseReturnStatement()
 {
-    auto *statement = new ast::ReturnStatement();
+    auto *statement = arena->make<ast::ReturnStatement>();
     statement->token = currentToken;
 
     nextToken();
@@ -178,7 +200,7 @@ ast::ReturnStatement *Parser::parseReturnStatement()
 
 ast::ExpressionStatement *Parser::parseExpressionStatement()
 {
-    auto *statement = new ast::ExpressionStatement(currentToken, parseExpression(Precedence::LOWEST));
+    auto *statement = arena->make<ast::ExpressionStatement>(currentToken, parseExpression(Precedence::LOWEST));
 
     if (peekTokenIs(token::SEMICOLON))
     {
@@ -190,44 +212,192 @@ ast::ExpressionStatement *Parser::parseExpressionStatement()
 
 ast::Expression *Parser::parseExpression(Precedence precedence)
 {
-    prefixParseFn prefix = prefixParseFunctions[currentToken.type];
+    if (nestingDepth() >= nestingLimit)
+    {
+        throw NestingLimitExceeded{};
+    }
 
-    if (!prefix)
+    ++expressionDepth;
+    ast::Expression *expression = parseExpressionIteratively(precedence);
+    --expressionDepth;
+
+    return expression;
+}
+
+void Parser::pushExpressionFrame(ExpressionFrame frame)
+{
+    if (nestingDepth() >= nestingLimit)
     {
-        noPrefixParseFnError(currentToken.type);
-        return nullptr;
+        throw NestingLimitExceeded{};
     }
 
-    ast::Expression *leftExpression = prefix();
+    expressionFrames.push_back(frame);
+}
 
-    while (!peekTokenIs(token::SEMICOLON) && precedence < peekPrecedence())
+void Parser::checkLeftHeight(size_t height) const
+{
+    if (nestingDepth() + height >= nestingLimit)
     {
-        infixParseFn infix = infixParseFunctions[peekToken.type];
-        if (!infix)
+        throw NestingLimitExceeded{};
+    }
+}
+
+ast::Expression *Parser::parseExpressionIteratively(Precedence precedence)
+{
+    // The loop below is the recursive Pratt parser turned inside out. Where a parse function would call
+    // parseExpression for an operand, a frame is pushed and a new level starts. When a level is complete
+    // the frame on top receives the level's expression and the level it was pushed from continues.
+    enum class Step
+    {
+        OPERAND,    // currentToken starts the operand of the current level
+        OPERATORS,  // left is the operand, infix operators binding tighter than precedence extend it
+        LEVEL_DONE, // left is the whole expression of the current level
+    };
+
+    const size_t base = expressionFrames.size();
+    ast::Expression *left = nullptr;
+    size_t leftHeight = 0; // Height of the subtree of left, walks of the tree recurse this deep below its level
+    Step step = Step::OPERAND;
+
+    while (true)
+    {
+        switch (step)
         {
-            return leftExpression;
+        case Step::OPERAND:
+        {
+            const PrefixRule &rule = prefixRules[currentToken.type];
+            switch (rule.kind)
+            {
+            case PrefixKind::PREFIX_OPERATOR:
+            {
+                auto *expression = arena->make<ast::PrefixExpression>(currentToken, ast::operatorOf(currentToken.type), nullptr);
+                pushExpressionFrame({ExpressionFrame::PREFIX_OPERAND, precedence, expression, 1});
+                precedence = Precedence::PREFIX;
+                nextToken();
+                break;
+            }
+            case PrefixKind::GROUP:
+                pushExpressionFrame({ExpressionFrame::GROUP, precedence, nullptr, 0});
+                precedence = Precedence::LOWEST;
+                nextToken();
+                break;
+            case PrefixKind::OPERAND:
+                left = (this->*rule.parse)();
+                leftHeight = 1;
+                step = Step::OPERATORS;
+                break;
+            case PrefixKind::NONE:
+                // Like a failed parseExpression, the level ends without looking for operators
+                noPrefixParseFnError(currentToken.type);
+                left = nullptr;
+                step = Step::LEVEL_DONE;
+                break;
+            }
+            break;
+        }
+        case Step::OPERATORS:
+        {
+            if (peekTokenIs(token::SEMICOLON) || precedence >= peekPrecedence() || infixKinds[peekToken.type] == InfixKind::NONE)
+            {
+                step = Step::LEVEL_DONE;
+                break;
+            }
+
+            nextToken();
+            checkLeftHeight(leftHeight);
+            if (infixKinds[currentToken.type] == InfixKind::CALL)
+            {
+                auto *call = arena->make<ast::CallExpression>(currentToken, left, arena->list<ast::Expression>());
+                if (peekTokenIs(token::RPAREN))
+                {
+                    nextToken();
+                    left = call;
+                    ++leftHeight;
+                    break;
+                }
+
+                pushExpressionFrame({ExpressionFrame::CALL_ARGUMENT, precedence, call, leftHeight + 1});
+                precedence = Precedence::LOWEST;
+            }
+            else
+            {
+                auto *expression = arena->make<ast::InfixExpression>(currentToken, left, ast::operatorOf(currentToken.type), nullptr);
+                pushExpressionFrame({ExpressionFrame::INFIX_OPERAND, precedence, expression, leftHeight + 1});
+                precedence = currentPrecedence();
+            }
+
+            nextToken();
+            step = Step::OPERAND;
+            break;
+        }
+        case Step::LEVEL_DONE:
+        {
+            if (expressionFrames.size() == base)
+            {
+                return left;
+            }
+
+            const ExpressionFrame frame = expressionFrames.back();
+            expressionFrames.pop_back();
+            precedence = frame.precedence;
+            step = Step::OPERATORS;
+
+            // The node of the frame is one level above the expression completed, and as tall as its other children
+            leftHeight = std::max(frame.height, frame.node ? leftHeight + 1 : leftHeight);
+
+            switch (frame.kind)
+            {
+            case ExpressionFrame::PREFIX_OPERAND:
+                static_cast<ast::PrefixExpression *>(frame.node)->right = left;
+                left = frame.node;
+                break;
+            case ExpressionFrame::GROUP:
+                left = expectPeek(token::RPAREN) ? left : nullptr;
+                break;
+            case ExpressionFrame::INFIX_OPERAND:
+                static_cast<ast::InfixExpression *>(frame.node)->right = left;
+                left = frame.node;
+                break;
+            case ExpressionFrame::CALL_ARGUMENT:
+            {
+                auto *call = static_cast<ast::CallExpression *>(frame.node);
+                call->arguments.push_back(left);
+                if (peekTokenIs(token::COMMA))
+                {
+                    nextToken();
+                    nextToken();
+                    pushExpressionFrame({ExpressionFrame::CALL_ARGUMENT, frame.precedence, call, leftHeight});
+                    precedence = Precedence::LOWEST;
+                    step = Step::OPERAND;
+                    break;
+                }
+
+                if (!expectPeek(token::RPAREN))
+                {
+                    call->arguments.clear();
+                }
+
+                left = call;
+                break;
+            }
+            }
+            break;
+        }
         }
-
-        nextToken();
-        leftExpression = infix(leftExpression);
     }
-
-    return leftExpression;
 }
 
 ast::Expression *Parser::parseIdentifier()
 {
-    return new ast::Identifier(currentToken, currentToken.literal);
+    return arena->make<ast::Identifier>(currentToken);
 }
 
 ast::Expression *Parser::parseIntegerLiteral()
 {
     int64_t val{};
-    try
-    {
-        val = std::stoi(currentToken.literal);
-    }
-    catch (const std::exception &e)
+    const std::string_view literal = currentToken.literal;
+    const auto [end, status] = std::from_chars(literal.data(), literal.data() + literal.size(), val);
+    if (status != std::errc() || end != literal.data() + literal.size())
     {
         std::ostringstream oss;
         oss << "Could not parse literal " << currentToken.literal << " to INT literal.";
@@ -236,56 +406,17 @@ ast::Expression *Parser::parseIntegerLiteral()
         return nullptr;
     }
 
-    return new ast::IntegerLiteral(currentToken, val);
-}
-
-ast::Expression *Parser::parsePrefixExpression()
-{
-    auto *expression = new ast::PrefixExpression(currentToken, currentToken.literal, nullptr);
-
-    nextToken();
-    expression->right = parseExpression(Precedence::PREFIX);
-
-    return expression;
-}
-
-ast::Expression *Parser::parseInfixExpression(ast::Expression *left)
-{
-    auto *expression = new ast::InfixExpression(
-        currentToken,
-        left,
-        currentToken.literal,
-        nullptr);
-
-    const Precedence precedence = currentPrecedence();
-    nextToken();
-    expression->right = parseExpression(precedence);
-
-    return expression;
+    return arena->make<ast::IntegerLiteral>(currentToken, val);
 }
 
-ast::Boolean *Parser::parseBoolean()
+ast::Expression *Parser::parseBoolean()
 {
-    return new ast::Boolean(currentToken, currentTokenIs(token::TRUE));
-}
-
-ast::Expression *Parser::parseGroupedExpression()
-{
-    nextToken();
-
-    ast::Expression *expression = parseExpression(Precedence::LOWEST);
-
-    if (!expectPeek(token::RPAREN))
-    {
-        return nullptr;
-    }
-
-    return expression;
+    return arena->make<ast::Boolean>(currentToken, currentTokenIs(token::TRUE));
 }
 
 ast::Expression *Parser::parseIfExpression()
 {
-    auto *expression = new ast::IfExpression(currentToken, nullptr, nullptr, nullptr);
+    auto *expression = arena->make<ast::IfExpression>(currentToken, nullptr, nullptr, nullptr);
 
     if (!expectPeek(token::LPAREN))
     {
@@ -324,7 +455,7 @@ ast::Expression *Parser::parseIfExpression()
 
 ast::BlockStatement *Parser::parseBlockStatement()
 {
-    auto *block = new ast::BlockStatement(currentToken, std::vector<ast::Statement *>());
+    auto *block = arena->make<ast::BlockStatement>(currentToken, arena->list<ast::Statement>());
 
     nextToken();
 
@@ -350,7 +481,7 @@ ast::Expression *Parser::parseFunctionLiteral()
         return nullptr;
     }
 
-    std::vector<ast::Identifier *> parameters = parseFunctionParameters();
+    ast::NodeList<ast::Identifier> parameters = parseFunctionParameters();
 
     if (!expectPeek(token::LBRACE))
     {
@@ -359,12 +490,12 @@ ast::Expression *Parser::parseFunctionLiteral()
 
     ast::BlockStatement *functionBody = parseBlockStatement();
 
-    return new ast::FunctionLiteral(cachedToken, parameters, functionBody);
+    return arena->make<ast::FunctionLiteral>(cachedToken, std::move(parameters), functionBody);
 }
 
-std::vector<ast::Identifier *> Parser::parseFunctionParameters()
+ast::NodeList<ast::Identifier> Parser::parseFunctionParameters()
 {
-    std::vector<ast::Identifier *> parameters{};
+    ast::NodeList<ast::Identifier> parameters = arena->list<ast::Identifier>();
 
     if (peekTokenIs(token::RPAREN))
     {
@@ -372,68 +503,29 @@ std::vector<ast::Identifier *> Parser::parseFunctionParameters()
         return parameters;
     }
 
-    nextToken();
-
-    auto *identifier = new ast::Identifier(currentToken, currentToken.literal);
-    parameters.push_back(identifier);
-
-    while (peekTokenIs(token::COMMA))
-    {
-        nextToken();
-        nextToken();
-        auto *identifier = new ast::Identifier(currentToken, currentToken.literal);
-        parameters.push_back(identifier);
-    }
-
-    if (!expectPeek(token::RPAREN))
-    {
-        return std::vector<ast::Identifier *>{};
-    }
-
-    return parameters;
-}
-
-ast::Expression *Parser::parseCallExpression(ast::Expression *function)
-{
-    return new ast::CallExpression(currentToken, function, parseCallArguments());
-}
-
-std::vector<ast::Expression *> Parser::parseCallArguments()
-{
-    std::vector<ast::Expression *> args;
-
-    if (peekTokenIs(token::RPAREN))
+    // Parameters have to be identifiers, any other token would bind no name
+    if (!expectPeek(token::IDENT))
     {
-        nextToken();
-        return args;
+        return arena->list<ast::Identifier>();
     }
-
-    nextToken();
-    args.push_back(parseExpression(Precedence::LOWEST));
+    parameters.push_back(arena->make<ast::Identifier>(currentToken));
 
     while (peekTokenIs(token::COMMA))
     {
         nextToken();
-        nextToken();
-        args.push_back(parseExpression(Precedence::LOWEST));
+        if (!expectPeek(token::IDENT))
+        {
+            return arena->list<ast::Identifier>();
+        }
+        parameters.push_back(arena->make<ast::Identifier>(currentToken));
     }
 
     if (!expectPeek(token::RPAREN))
     {
-        return std::vector<ast::Expression *>();
+        return arena->list<ast::Identifier>();
     }
 
-    return args;
-}
-
-void Parser::registerPrefix(token::TokenType tokenType, prefixParseFn fn)
-{
-    prefixParseFunctions[tokenType] = fn;
-}
-
-void Parser::registerInfix(token::TokenType tokenType, infixParseFn fn)
-{
-    infixParseFunctions[tokenType] = fn;
+    return parameters;
 }
 
 bool Parser::expectPeek(token::TokenType type)
@@ -462,20 +554,10 @@ bool Parser::currentTokenIs(token::TokenType type)
 
 Precedence Parser::peekPrecedence() const
 {
-    if (precedences.count(peekToken.type))
-    {
-        return precedences.at(peekToken.type);
-    }
-
-    return Precedence::LOWEST;
+    return precedences[peekToken.type];
 }
 
 Precedence Parser::currentPrecedence() const
 {
-    if (precedences.count(currentToken.type))
-    {
-        return precedences.at(currentToken.type);
-    }
-
-    return Precedence::LOWEST;
+    return precedences[currentToken.type];
 }
@@ -2,11 +2,40 @@
 
 #include "token.hpp"
 #include "lexer.hpp"
+#include "token_buffer.hpp"
 #include "ast.hpp"
-#include <functional>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
-using prefixParseFn = std::function<ast::Expression *()>;
-using infixParseFn = std::function<ast::Expression *(ast::Expression *)>;
+class Parser;
+
+using prefixParseFn = ast::Expression *(Parser::*)();
+
+// What a token starts when it begins an operand. Operands are parsed whole by their parse function, prefix
+// operators and groups are opened on the expression loop's frames.
+enum class PrefixKind : uint8_t
+{
+    NONE, // The token can't start an expression
+    OPERAND,
+    PREFIX_OPERATOR,
+    GROUP,
+};
+
+// How the expression loop continues an operand with a token that follows it
+enum class InfixKind : uint8_t
+{
+    NONE, // The token doesn't continue an expression
+    OPERATOR,
+    CALL,
+};
+
+struct PrefixRule
+{
+    PrefixKind kind;
+    prefixParseFn parse; // Only set for OPERAND
+};
 
 enum class Precedence
 {
@@ -29,23 +58,94 @@ private:
 
     void noPrefixParseFnError(token::TokenType type);
 
+    // Index in tokens of the token after peekToken, only used when parsing from a token buffer
+    size_t nextTokenIndex = 0;
+
+    // A construct waiting for the expression being parsed. Operators, groups and call arguments are kept
+    // on this explicit stack instead of the native one, so their nesting depth doesn't cost native stack.
+    struct ExpressionFrame
+    {
+        enum Kind : uint8_t
+        {
+            PREFIX_OPERAND, // node is a prefix expression waiting for its operand
+            GROUP,          // an opening parenthesis waiting for the grouped expression
+            INFIX_OPERAND,  // node is an infix expression waiting for its right operand
+            CALL_ARGUMENT,  // node is a call expression waiting for its next argument
+        } kind;
+
+        Precedence precedence; // Precedence of the level to continue once the construct is complete
+        ast::Expression *node;
+        size_t height;         // Height of node's subtree so far, its left operand or callee and arguments
+    };
+
+    std::vector<ExpressionFrame> expressionFrames{};
+
+    // Number of parseExpression calls active on the native stack, if and function literals nest through them
+    size_t expressionDepth = 0;
+
+    // Thrown to abandon the program once the nesting limit is exceeded, parseProgram turns it into an error
+    struct NestingLimitExceeded
+    {
+    };
+
+    // Returns how deep the construct being parsed is nested
+    size_t nestingDepth() const { return expressionDepth + expressionFrames.size(); }
+
+    // Pushes a frame onto expressionFrames, throws NestingLimitExceeded if that nests too deep
+    void pushExpressionFrame(ExpressionFrame frame);
+
+    // Throws NestingLimitExceeded if an operator or call whose left operand or callee is height levels tall, at the
+    // current depth, would nest too deep. Left associative chains nest the tree without nesting the parse.
+    void checkLeftHeight(size_t height) const;
+
+    // Parses an expression like parseExpression, with operators, groups and calls unrolled onto expressionFrames
+    ast::Expression *parseExpressionIteratively(Precedence precedence);
+
+    Parser(lexer::Lexer *lexer, lexer::TokenBuffer *tokens);
+
 public:
-    lexer::Lexer *lexer;
+    // Exactly one of the two token sources is set, the parser owns it
+    lexer::Lexer *lexer = nullptr;
+    lexer::TokenBuffer *tokens = nullptr;
 
     token::Token currentToken;
     token::Token peekToken;
 
-    std::unordered_map<token::TokenType, prefixParseFn> prefixParseFunctions;
-    std::unordered_map<token::TokenType, infixParseFn> infixParseFunctions;
+    // Arena the parsed nodes are allocated in, handed over to the programs the parser returns
+    std::shared_ptr<ast::Arena> arena;
+
+    static constexpr size_t DEFAULT_NESTING_LIMIT = 1000;
 
+    // How deep parentheses, operators, calls, blocks and if and function literals may nest, where every operator
+    // of a left associative chain such as 1 + 2 + 3 counts as a level too. Deeper input is reported as an error
+    // instead of parsed. The parser itself handles any depth of operators, groups and calls, the limit protects
+    // evaluating and printing the tree, which recurse. If and function literals also nest on the native stack while
+    // parsing.
+    size_t nestingLimit = DEFAULT_NESTING_LIMIT;
+
+    // What every token type does before and after an operand, indexed by token type.
+    // Built once at compile time and shared by every parser, so constructing a parser costs nothing extra.
+    static const std::array<PrefixRule, token::TOKEN_TYPE_COUNT> prefixRules;
+    static const std::array<InfixKind, token::TOKEN_TYPE_COUNT> infixKinds;
+
+    // Parses tokens as the lexer produces them
     Parser(lexer::Lexer *lexer);
 
+    // Parses a source lexed up front, which gives the parser free lookahead over any distance
+    Parser(lexer::TokenBuffer *tokens);
+
     ~Parser()
     {
         delete lexer;
+        delete tokens;
     }
 
     void nextToken();
+
+    // Returns the token the given distance after the current token, lookahead(1) is the peek token.
+    // Only available when parsing from a token buffer, a lexer fed parser gets an ILLEGAL token beyond the peek token.
+    token::Token lookahead(size_t distance) const;
+
     ast::Program *parseProgram();
     ast::Statement *parseStatement();
     ast::VarStatement *parseVarStatement();
@@ -56,24 +156,13 @@ public:
     ast::Expression *parseIdentifier();
     ast::Expression *parseIntegerLiteral();
 
-    ast::Expression *parsePrefixExpression();
-    ast::Expression *parseInfixExpression(ast::Expression *left);
-
-    ast::Boolean *parseBoolean();
+    ast::Expression *parseBoolean();
     ast::Expression *parseIfExpression();
-    ast::Expression *parseGroupedExpression();
 
     ast::BlockStatement *parseBlockStatement();
 
     ast::Expression *parseFunctionLiteral();
-    std::vector<ast::Identifier *> parseFunctionParameters();
-    ast::Expression *parseCallExpression(ast::Expression *function);
-    std::vector<ast::Expression *> parseCallArguments();
-    // Registers the prefix parsing function for the given token type
-    void registerPrefix(token::TokenType tokenType, prefixParseFn fn);
-
-    // Register the infix parsing function for the given token type
-    void registerInfix(token::TokenType tokenType, infixParseFn fn);
+    ast::NodeList<ast::Identifier> parseFunctionParameters();
 
     // checks the type of the peekToken and only if the type is correct does it
     // advances the tokens by calling nextToken
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "lexer.hpp"
+#include "token_buffer.hpp"
+#include "parser.hpp"
+#include "flat_ast.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Number of times every measurement is repeated, the fastest run is reported
+constexpr int RUNS = 5;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Builds a source of roughly the given size by repeating a typical script snippet
+std::string generateSource(size_t targetSize)
+{
+    const std::string snippet = R"(var shuma = funksion(a, b) { kthen a + b * (a - b) / 2; };
+var rezultati = shuma(10, 25) * 3 - 7 / 2;
+nese (rezultati > 100) { kthen !vertet; } perndryshe { kthen -rezultati; }
+var krahaso = rezultati != 42 == (5 < 9);
+)";
+
+    std::string source;
+    source.reserve(targetSize + snippet.size());
+    while (source.size() < targetSize)
+    {
+        source += snippet;
+    }
+
+    return source;
+}
+
+void benchmarkLexerParser(const std::string &source)
+{
+    double best = 1e300;
+    double bestTeardown = 1e300;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        const auto start = Clock::now();
+
+        auto *parser = new Parser(new lexer::Lexer(source));
+        ast::Program *program = parser->parseProgram();
+
+        best = std::min(best, millisecondsSince(start));
+        delete parser;
+
+        const auto teardownStart = Clock::now();
+        delete program;
+        bestTeardown = std::min(bestTeardown, millisecondsSince(teardownStart));
+    }
+
+    std::cout << "parse from lexer:        " << best << " ms\n"
+              << "\tteardown:  " << bestTeardown << " ms\n";
+}
+
+void benchmarkTokenBufferParser(const std::string &source)
+{
+    double bestTokenize = 1e300;
+    double bestParse = 1e300;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        const auto start = Clock::now();
+
+        lexer::Lexer lexer(source);
+        auto *tokens = new lexer::TokenBuffer(lexer);
+        bestTokenize = std::min(bestTokenize, millisecondsSince(start));
+
+        const auto parseStart = Clock::now();
+        Parser parser(tokens);
+        ast::Program *program = parser.parseProgram();
+        bestParse = std::min(bestParse, millisecondsSince(parseStart));
+
+        delete program;
+    }
+
+    std::cout << "parse from token buffer: " << bestTokenize + bestParse << " ms\n"
+              << "\ttokenize:  " << bestTokenize << " ms\n"
+              << "\tparse:     " << bestParse << " ms" << std::endl;
+}
+
+// Parses one short line per parser, the way the REPL builds a fresh parser for every line it reads
+void benchmarkParserConstruction()
+{
+    constexpr int LINES = 200000;
+    const std::string line = "var x = 5 + 3;";
+
+    double best = 1e300;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        const auto start = Clock::now();
+        for (int i = 0; i < LINES; ++i)
+        {
+            Parser parser(new lexer::Lexer(line));
+            delete parser.parseProgram();
+        }
+
+        best = std::min(best, millisecondsSince(start));
+    }
+
+    std::cout << "parser per line:         " << best * 1e6 / LINES << " ns/line" << std::endl;
+}
+
+// Flattens the parsed program and reports the footprint of the flat arrays
+void benchmarkFlatten(const std::string &source)
+{
+    Parser parser(new lexer::Lexer(source));
+    ast::Program *program = parser.parseProgram();
+
+    double best = 1e300;
+    size_t bytes = 0;
+    size_t nodes = 0;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        const auto start = Clock::now();
+        const ast::FlatProgram flat = ast::flatten(*program);
+        best = std::min(best, millisecondsSince(start));
+
+        nodes = flat.nodes.size();
+        bytes = nodes * sizeof(ast::FlatNode) + flat.lists.size() * sizeof(ast::NodeIndex) +
+                flat.integers.size() * sizeof(ast::IntegerConstant);
+    }
+
+    std::cout << "flatten:                 " << best << " ms\n"
+              << "\tnodes:     " << nodes << "\n"
+              << "\tbytes/node: " << static_cast<double>(bytes) / nodes << std::endl;
+
+    delete program;
+}
+
+// Pass "lexer", "buffer", "line" or "flat" to run one variant per process, the heap left behind by one variant skews the other
+int main(int argc, char *argv[])
+{
+    const std::string variant = argc > 1 ? argv[1] : "";
+    const std::string source = generateSource(16 * 1024 * 1024);
+
+    if (variant.empty() || variant == "lexer")
+    {
+        benchmarkLexerParser(source);
+    }
+
+    if (variant.empty() || variant == "buffer")
+    {
+        benchmarkTokenBufferParser(source);
+    }
+
+    if (variant.empty() || variant == "line")
+    {
+        benchmarkParserConstruction();
+    }
+
+    if (variant.empty() || variant == "flat")
+    {
+        benchmarkFlatten(source);
+    }
+
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <assert.h>
+#include <sys/mman.h>
 #include <iostream>
 #include "parser.hpp"
+#include "flat_ast.hpp"
 #include <any>
 
 void checkParserErrors(Parser *parser)
@@ -45,7 +47,7 @@ void testIdentifier(ast::Expression *expression, std::string expected)
 
 void testVarStatement(ast::Statement *statement, std::string_view expectedIdentifier)
 {
-    assert(token::keywords[statement->tokenLiteral()] == token::VAR && "Token literal not var");
+    assert(token::LookupIdentifier(statement->tokenLiteral()) == token::VAR && "Token literal not var");
 
     ast::VarStatement *varStatement = dynamic_cast<ast::VarStatement *>(statement);
     assert(varStatement && "Statement not ast::VarStatement*");
@@ -86,7 +88,7 @@ void testInfixExpression(ast::Expression *expression, std::any left, std::string
     assert(infixExpression && "expression is not a ast::InfixExpression*");
 
     testLiteralExpression(infixExpression->left, left);
-    assert(infixExpression->op == op && "infixExpression operator does not match with the expected operator");
+    assert(ast::toString(infixExpression->op) == op && "infixExpression operator does not match with the expected operator");
     testLiteralExpression(infixExpression->right, right);
 }
 
@@ -284,6 +286,19 @@ void testParseFunctionParameter()
         std::cout << "\tPASSED!\n";
     }
 
+    // Parameters and var names that aren't identifiers are errors, not bindings of some other name
+    for (const std::string input : {"funksion(5) { a }", "var a = 2; var f = funksion(5) { a }; f(7)",
+                                    "funksion(1) { 1 }", "funksion(x, 2) { x }", "var 5 = 1;"})
+    {
+        std::cout << "TEST: " << input;
+        Parser parser(new lexer::Lexer(input));
+        parser.parseProgram();
+
+        const auto &errors = parser.getErrors();
+        assert(!errors.empty() && errors[0].find("Expected next token to be IDENT") != std::string::npos);
+        std::cout << "\tPASSED!\n";
+    }
+
     std::cout << "ALL FUNCTION PARAMETER PARSING PASSED!\n";
     std::cout << "--------------------------------------------" << std::endl;
 }
@@ -431,7 +446,7 @@ void testParseReturnStatements()
         auto *statement = program->statements[0];
         auto *returnStatement = dynamic_cast<ast::ReturnStatement *>(program->statements[0]);
         assert(returnStatement && "Statement is not a ast::ReturnStatement*");
-        assert(token::keywords[returnStatement->tokenLiteral()] == token::RETURN && "Token literal is not \"kthen\"");
+        assert(token::LookupIdentifier(returnStatement->tokenLiteral()) == token::RETURN && "Token literal is not \"kthen\"");
 
         testLiteralExpression(returnStatement->returnValue, test.expected);
         std::cout << "\tPASSED!\n";
@@ -476,7 +491,7 @@ void testParsePrefixExpression()
         auto *expression = dynamic_cast<ast::PrefixExpression *>(statement->expression);
         assert(expression && "Statement is not a ast::PrefixExpression!");
 
-        assert(expression->op == test.op && "Expression operator doesn't match with the expected operator");
+        assert(ast::toString(expression->op) == test.op && "Expression operator doesn't match with the expected operator");
 
         testLiteralExpression(expression->right, test.value);
 
@@ -531,7 +546,7 @@ void testParseInfixExpression()
         assert(expression && "Expression is not a ast::InfixExpression");
 
         testLiteralExpression(expression->left, test.leftOperand);
-        assert(expression->op == test.op && "Expression operator doesn't match with the expected operator");
+        assert(ast::toString(expression->op) == test.op && "Expression operator doesn't match with the expected operator");
         testLiteralExpression(expression->right, test.rightOperand);
 
         std::cout << "\tPASSED!\n";
@@ -671,6 +686,326 @@ void testOperatorPrecedenceParsing()
     std::cout << "---------------------------------------------------" << std::endl;
 }
 
+void testParseFromTokenBuffer()
+{
+    std::vector<std::string> inputs{
+        "var x = 5 * (3 + y);",
+        "kthen add(1, 2 * 3);",
+        "nese (x < y) { x } perndryshe { kthen -y; }",
+        "var f = funksion(a, b) { a + b * c == !d; }; f(1, 2);",
+    };
+
+    std::cout << "-------------[Token Buffer Test]------------\n";
+    for (const auto &input : inputs)
+    {
+        std::cout << "TEST: " << input;
+
+        auto *streamed = new Parser(new lexer::Lexer(input));
+        auto *expected = streamed->parseProgram();
+        checkParserErrors(streamed);
+
+        lexer::Lexer lexer(input);
+        auto *buffered = new Parser(new lexer::TokenBuffer(lexer));
+        auto *program = buffered->parseProgram();
+        checkParserErrors(buffered);
+
+        assert(program->toString() == expected->toString() && "token buffer parse differs from lexer parse");
+
+        std::cout << "\tPASSED!\n";
+    }
+
+    // Lookahead reaches any distance and stops at EOF
+    lexer::Lexer lexer("var x = 5;");
+    Parser parser(new lexer::TokenBuffer(lexer));
+    assert(parser.lookahead(0).type == token::VAR);
+    assert(parser.lookahead(1).type == token::IDENT);
+    assert(parser.lookahead(3).literal == "5");
+    assert(parser.lookahead(5).type == token::EOF_);
+    assert(parser.lookahead(50).type == token::EOF_);
+
+    // Offsets past 4 GB don't fit, such sources are rejected before anything is read. The pages are reserved only.
+    const size_t tooLarge = lexer::TokenBuffer::MAX_SOURCE_SIZE + size_t{1};
+    void *pages = mmap(nullptr, tooLarge, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    assert(pages != MAP_FAILED);
+    lexer::Lexer huge(std::string_view(static_cast<const char *>(pages), tooLarge), nullptr);
+    bool threw = false;
+    try
+    {
+        lexer::TokenBuffer tokens(huge);
+    }
+    catch (const std::length_error &)
+    {
+        threw = true;
+    }
+    munmap(pages, tooLarge);
+    assert(threw && "sources over 4 GB are rejected");
+
+    std::cout << "\t ALL TOKEN BUFFER TESTS PASSED!\n";
+    std::cout << "---------------------------------------------------" << std::endl;
+}
+
+void testFlattenRoundTrip()
+{
+    std::vector<std::string> inputs{
+        "var x = 5 * (3 + y); kthen x;",
+        "-a * b != !vertet == falso",
+        "a + add(b * c, 007) + d",
+        "nese (x < y) { x } perndryshe { kthen -y; }",
+        "nese (x > y) { var z = x; z }",
+        "var f = funksion(a, b) { a + b * c == !d; }; f(1, 2)(3); funksion() {}();",
+        "var vlerë = 1; vlerë",
+    };
+
+    std::cout << "-------------[Flat AST Test]------------\n";
+    for (const auto &input : inputs)
+    {
+        std::cout << "TEST: " << input;
+
+        auto *parser = new Parser(new lexer::Lexer(input));
+        auto *program = parser->parseProgram();
+        checkParserErrors(parser);
+
+        const ast::FlatProgram flat = ast::flatten(*program);
+        assert(flat.toString() == program->toString() && "flat program prints differently");
+
+        // Nodes are in pre-order, children always come after their parent
+        assert(flat.root == 0);
+        for (ast::NodeIndex index = 0; index < flat.nodes.size(); ++index)
+        {
+            const ast::FlatNode &node = flat[index];
+            if (node.kind == ast::FlatKind::INFIX)
+            {
+                assert(node.a > index && node.b > node.a);
+            }
+        }
+
+        auto *rebuilt = ast::unflatten(flat);
+        assert(rebuilt->toString() == program->toString() && "unflattened program prints differently");
+        assert(ast::flatten(*rebuilt).nodes.size() == flat.nodes.size());
+
+        delete rebuilt;
+        delete program;
+        delete parser;
+
+        std::cout << "\tPASSED!\n";
+    }
+
+    std::cout << "\t ALL FLAT AST TESTS PASSED!\n";
+    std::cout << "---------------------------------------------------" << std::endl;
+}
+
+// Returns the single expression of a program that parsed without errors
+ast::Expression *onlyExpression(Parser *parser, ast::Program *program)
+{
+    checkParserErrors(parser);
+    assert(program->statements.size() == 1);
+
+    auto *statement = dynamic_cast<ast::ExpressionStatement *>(program->statements[0]);
+    assert(statement != nullptr);
+    return statement->expression;
+}
+
+void testDeeplyNestedExpressions()
+{
+    // The trees are walked with loops, toString and the destructors of the tree would recurse as deep as they are
+    constexpr size_t DEPTH = 100000;
+
+    std::cout << "-------------[Deep Nesting Test]------------\n";
+    {
+        std::cout << "TEST: " << DEPTH << " nested groups";
+
+        auto *parser = new Parser(new lexer::Lexer(std::string(DEPTH, '(') + "x" + std::string(DEPTH, ')')));
+        parser->nestingLimit = 2 * DEPTH;
+        auto *program = parser->parseProgram();
+        testIdentifier(onlyExpression(parser, program), "x");
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+    {
+        std::cout << "TEST: " << DEPTH << " prefix operators";
+
+        std::string input;
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            input += i % 2 ? "!" : "-";
+        }
+
+        auto *parser = new Parser(new lexer::Lexer(input + "5"));
+        parser->nestingLimit = 2 * DEPTH;
+        auto *program = parser->parseProgram();
+
+        ast::Expression *expression = onlyExpression(parser, program);
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            auto *prefix = dynamic_cast<ast::PrefixExpression *>(expression);
+            assert(prefix != nullptr && prefix->op == (i % 2 ? ast::Operator::NOT : ast::Operator::MINUS));
+            expression = prefix->right;
+        }
+        testIntegerLiteral(expression, 5);
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+    {
+        std::cout << "TEST: " << DEPTH << " right nested operands";
+
+        std::string input;
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            input += "1 + (";
+        }
+        input += "2" + std::string(DEPTH, ')');
+
+        auto *parser = new Parser(new lexer::Lexer(input));
+        parser->nestingLimit = 3 * DEPTH;
+        auto *program = parser->parseProgram();
+
+        ast::Expression *expression = onlyExpression(parser, program);
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            auto *infix = dynamic_cast<ast::InfixExpression *>(expression);
+            assert(infix != nullptr && infix->op == ast::Operator::PLUS);
+            testIntegerLiteral(infix->left, 1);
+            expression = infix->right;
+        }
+        testIntegerLiteral(expression, 2);
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+    {
+        std::cout << "TEST: " << DEPTH << " nested call arguments";
+
+        std::string input;
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            input += "f(a, ";
+        }
+        input += "b" + std::string(DEPTH, ')');
+
+        auto *parser = new Parser(new lexer::Lexer(input));
+        parser->nestingLimit = 2 * DEPTH;
+        auto *program = parser->parseProgram();
+
+        ast::Expression *expression = onlyExpression(parser, program);
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            auto *call = dynamic_cast<ast::CallExpression *>(expression);
+            assert(call != nullptr && call->arguments.size() == 2);
+            testIdentifier(call->function, "f");
+            testIdentifier(call->arguments[0], "a");
+            expression = call->arguments[1];
+        }
+        testIdentifier(expression, "b");
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+    {
+        std::cout << "TEST: " << DEPTH << " left nested operators";
+
+        // Left associative chains grow the tree without nesting the parse, the limit still counts every operator
+        std::string input = "0";
+        for (size_t i = 1; i <= DEPTH; ++i)
+        {
+            input += " + 1";
+        }
+
+        auto *parser = new Parser(new lexer::Lexer(input));
+        parser->nestingLimit = 2 * DEPTH;
+        auto *program = parser->parseProgram();
+
+        ast::Expression *expression = onlyExpression(parser, program);
+        for (size_t i = 0; i < DEPTH; ++i)
+        {
+            auto *infix = dynamic_cast<ast::InfixExpression *>(expression);
+            assert(infix != nullptr && infix->op == ast::Operator::PLUS);
+            testIntegerLiteral(infix->right, 1);
+            expression = infix->left;
+        }
+        testIntegerLiteral(expression, 0);
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+
+    std::vector<std::string> tooDeep{
+        std::string(DEPTH, '(') + "x" + std::string(DEPTH, ')'),
+        std::string(DEPTH, '-') + "x",
+        "var x = 1; kthen " + std::string(DEPTH, '(') + ";",
+        "1",
+        "f",
+        "(((1 + 1) + 1) + 1)",
+        "",
+    };
+    for (size_t i = 0; i < DEPTH; ++i)
+    {
+        tooDeep[3] += " + 1";
+        tooDeep[4] += "()";
+        tooDeep[5] += " * 2";
+    }
+    for (size_t i = 0; i < 2 * Parser::DEFAULT_NESTING_LIMIT; ++i)
+    {
+        tooDeep.back() += "nese (x) { ";
+    }
+
+    for (const auto &input : tooDeep)
+    {
+        std::cout << "TEST: input over the default limit";
+
+        auto *parser = new Parser(new lexer::Lexer(input));
+        auto *program = parser->parseProgram();
+
+        const auto &errors = parser->getErrors();
+        assert(errors.size() == 1 && errors[0].find("limit of 1000 levels") != std::string::npos);
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+
+    {
+        std::cout << "TEST: nesting right at the default limit";
+
+        // The statement takes one level, the group and its operand take one each
+        const size_t depth = Parser::DEFAULT_NESTING_LIMIT - 1;
+        auto *parser = new Parser(new lexer::Lexer(std::string(depth, '(') + "x" + std::string(depth, ')')));
+        auto *program = parser->parseProgram();
+        testIdentifier(onlyExpression(parser, program), "x");
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+    {
+        std::cout << "TEST: left associative chain right at the default limit";
+
+        // The statement takes one level, every operator one more
+        std::string input = "0";
+        for (size_t i = 2; i < Parser::DEFAULT_NESTING_LIMIT; ++i)
+        {
+            input += " - 1";
+        }
+
+        auto *parser = new Parser(new lexer::Lexer(input));
+        auto *program = parser->parseProgram();
+        assert(dynamic_cast<ast::InfixExpression *>(onlyExpression(parser, program)) != nullptr);
+
+        delete program;
+        delete parser;
+        std::cout << "\tPASSED!\n";
+    }
+
+    std::cout << "\t ALL DEEP NESTING TESTS PASSED!\n";
+    std::cout << "---------------------------------------------------" << std::endl;
+}
+
 int main()
 {
     testParseVarStatements();
@@ -687,6 +1022,9 @@ int main()
     testParseFunctionParameter();
     testParseCallExpression();
     testParseCallExpressionArguments();
+    testParseFromTokenBuffer();
+    testFlattenRoundTrip();
+    testDeeplyNestedExpressions();
 
     return 0;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "token.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "optimizer.hpp"
 #include "evaluator.hpp"
 #include "environment.hpp"
 
@@ -23,6 +24,7 @@ void repl::start(std::istream &in, std::ostream &out)
             continue;
         }
 
+        optimizer::optimize(*program);
         const object::Object *evaluatedStatement = evaluator::evaluate(program, env);
         if (evaluatedStatement)
         {
@@ -0,0 +1,279 @@
+#include "resolver.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // Walks a program or function literal, keeping the functions around the current node
+    class Resolver
+    {
+    public:
+        // Depth given to names no enclosing function declares
+        explicit Resolver(uint32_t outermostDepth) : outermostDepth{outermostDepth}
+        {
+        }
+
+        void resolveStatements(const ast::NodeList<ast::Statement> &statements);
+        void resolveFunction(ast::FunctionLiteral *function);
+
+    private:
+        // A function being resolved and the slots of the names it declares
+        struct Scope
+        {
+            ast::FunctionLiteral *function;
+            std::unordered_map<token::Symbol, uint32_t> slots;
+        };
+
+        const uint32_t outermostDepth;
+        std::vector<Scope> scopes;
+
+        // Gives the identifier a slot in the innermost function, the one it already has if the name was declared
+        void declare(ast::Identifier *identifier);
+
+        // Declares the var statements of the function the walk is in, without entering nested function literals
+        void hoistStatements(const ast::NodeList<ast::Statement> &statements);
+        void hoistExpression(ast::Expression *expression);
+
+        void resolveStatement(ast::Statement *statement);
+        void resolveExpression(ast::Expression *expression);
+        void resolveIdentifier(ast::Identifier *identifier);
+    };
+}
+
+void Resolver::declare(ast::Identifier *identifier)
+{
+    Scope &scope = scopes.back();
+    const auto [found, inserted] = scope.slots.try_emplace(identifier->symbol, scope.function->slotCount);
+    if (inserted)
+    {
+        ++scope.function->slotCount;
+    }
+
+    identifier->depth = 0;
+    identifier->slot = found->second;
+}
+
+void Resolver::hoistStatements(const ast::NodeList<ast::Statement> &statements)
+{
+    for (ast::Statement *statement : statements)
+    {
+        switch (statement->kind)
+        {
+        case ast::NodeKind::VAR_STATEMENT:
+        {
+            auto *varStatement = static_cast<ast::VarStatement *>(statement);
+            const bool isNew = !scopes.back().slots.count(varStatement->name->symbol);
+            declare(varStatement->name);
+            if (isNew)
+            {
+                scopes.back().function->locals.push_back(varStatement->name);
+            }
+
+            hoistExpression(varStatement->expression);
+            break;
+        }
+        case ast::NodeKind::RETURN_STATEMENT:
+            hoistExpression(static_cast<ast::ReturnStatement *>(statement)->returnValue);
+            break;
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            hoistExpression(static_cast<ast::ExpressionStatement *>(statement)->expression);
+            break;
+        case ast::NodeKind::BLOCK_STATEMENT:
+            hoistStatements(static_cast<ast::BlockStatement *>(statement)->statements);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Resolver::hoistExpression(ast::Expression *expression)
+{
+    if (!expression)
+    {
+        return;
+    }
+
+    // Var statements can only be nested in the blocks of if expressions, which may sit inside any expression
+    switch (expression->kind)
+    {
+    case ast::NodeKind::PREFIX_EXPRESSION:
+        hoistExpression(static_cast<ast::PrefixExpression *>(expression)->right);
+        break;
+    case ast::NodeKind::INFIX_EXPRESSION:
+    {
+        auto *infix = static_cast<ast::InfixExpression *>(expression);
+        hoistExpression(infix->left);
+        hoistExpression(infix->right);
+        break;
+    }
+    case ast::NodeKind::IF_EXPRESSION:
+    {
+        auto *ifExpression = static_cast<ast::IfExpression *>(expression);
+        hoistExpression(ifExpression->condition);
+        hoistStatements(ifExpression->consequence->statements);
+        if (ifExpression->alternative)
+        {
+            hoistStatements(ifExpression->alternative->statements);
+        }
+        break;
+    }
+    case ast::NodeKind::CALL_EXPRESSION:
+    {
+        auto *call = static_cast<ast::CallExpression *>(expression);
+        hoistExpression(call->function);
+        for (ast::Expression *argument : call->arguments)
+        {
+            hoistExpression(argument);
+        }
+        break;
+    }
+    default:
+        // Function literals declare their var statements in their own calls
+        break;
+    }
+}
+
+void Resolver::resolveFunction(ast::FunctionLiteral *function)
+{
+    if (function->resolved)
+    {
+        return;
+    }
+
+    scopes.push_back({function, {}});
+    for (ast::Identifier *parameter : function->parameters)
+    {
+        declare(parameter);
+    }
+    hoistStatements(function->body->statements);
+
+    resolveStatements(function->body->statements);
+    scopes.pop_back();
+
+    function->resolved = true;
+}
+
+void Resolver::resolveStatements(const ast::NodeList<ast::Statement> &statements)
+{
+    for (ast::Statement *statement : statements)
+    {
+        resolveStatement(statement);
+    }
+}
+
+void Resolver::resolveStatement(ast::Statement *statement)
+{
+    switch (statement->kind)
+    {
+    case ast::NodeKind::VAR_STATEMENT:
+    {
+        auto *varStatement = static_cast<ast::VarStatement *>(statement);
+        resolveExpression(varStatement->expression);
+
+        // Inside a function the name was declared while hoisting, the var statements of the program bind globals
+        if (scopes.empty())
+        {
+            varStatement->name->depth = outermostDepth;
+        }
+        break;
+    }
+    case ast::NodeKind::RETURN_STATEMENT:
+        resolveExpression(static_cast<ast::ReturnStatement *>(statement)->returnValue);
+        break;
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        resolveExpression(static_cast<ast::ExpressionStatement *>(statement)->expression);
+        break;
+    case ast::NodeKind::BLOCK_STATEMENT:
+        resolveStatements(static_cast<ast::BlockStatement *>(statement)->statements);
+        break;
+    default:
+        break;
+    }
+}
+
+void Resolver::resolveExpression(ast::Expression *expression)
+{
+    if (!expression)
+    {
+        return;
+    }
+
+    switch (expression->kind)
+    {
+    case ast::NodeKind::IDENTIFIER:
+        resolveIdentifier(static_cast<ast::Identifier *>(expression));
+        break;
+    case ast::NodeKind::PREFIX_EXPRESSION:
+        resolveExpression(static_cast<ast::PrefixExpression *>(expression)->right);
+        break;
+    case ast::NodeKind::INFIX_EXPRESSION:
+    {
+        auto *infix = static_cast<ast::InfixExpression *>(expression);
+        resolveExpression(infix->left);
+        resolveExpression(infix->right);
+        break;
+    }
+    case ast::NodeKind::IF_EXPRESSION:
+    {
+        auto *ifExpression = static_cast<ast::IfExpression *>(expression);
+        resolveExpression(ifExpression->condition);
+        resolveStatements(ifExpression->consequence->statements);
+        if (ifExpression->alternative)
+        {
+            resolveStatements(ifExpression->alternative->statements);
+        }
+        break;
+    }
+    case ast::NodeKind::FUNCTION_LITERAL:
+        resolveFunction(static_cast<ast::FunctionLiteral *>(expression));
+        break;
+    case ast::NodeKind::CALL_EXPRESSION:
+    {
+        auto *call = static_cast<ast::CallExpression *>(expression);
+        resolveExpression(call->function);
+        for (ast::Expression *argument : call->arguments)
+        {
+            resolveExpression(argument);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Resolver::resolveIdentifier(ast::Identifier *identifier)
+{
+    for (size_t depth = 0; depth < scopes.size(); ++depth)
+    {
+        const Scope &scope = scopes[scopes.size() - 1 - depth];
+        auto found = scope.slots.find(identifier->symbol);
+        if (found != scope.slots.end())
+        {
+            identifier->depth = static_cast<uint32_t>(depth);
+            identifier->slot = found->second;
+            return;
+        }
+    }
+
+    identifier->depth = outermostDepth;
+}
+
+void resolver::resolve(ast::Program &program)
+{
+    if (program.resolved)
+    {
+        return;
+    }
+
+    Resolver resolver(ast::GLOBAL_DEPTH);
+    resolver.resolveStatements(program.statements);
+    program.resolved = true;
+}
+
+void resolver::resolve(ast::FunctionLiteral &function)
+{
+    Resolver resolver(ast::UNRESOLVED_DEPTH);
+    resolver.resolveFunction(&function);
+}
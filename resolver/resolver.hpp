@@ -0,0 +1,17 @@
+#pragma once
+
+#include "ast.hpp"
+
+namespace resolver
+{
+    // Annotates every identifier of the program with where its variable lives, so the evaluator reads it by index
+    // instead of searching environments by name. Each function literal gets a slot for every name it declares:
+    // its parameters and the var statements anywhere in its body, hoisted to the top as blocks share the call's
+    // environment. An identifier refers to the innermost function declaring its name, or to the global
+    // environment when none does. Function literals resolved before are left as they are.
+    void resolve(ast::Program &program);
+
+    // Resolves a function literal on its own. Names it and its nested literals don't declare stay unresolved
+    // and are looked up by symbol, as nothing is known about the functions around it.
+    void resolve(ast::FunctionLiteral &function);
+}
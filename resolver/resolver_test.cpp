@@ -0,0 +1,165 @@
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "resolver.hpp"
+
+ast::Program *parse(const std::string &input)
+{
+    Parser parser(new lexer::Lexer(input));
+    ast::Program *program = parser.parseProgram();
+    assert(parser.getErrors().empty() && "input has parse errors");
+
+    return program;
+}
+
+ast::Expression *expressionOf(ast::Statement *statement)
+{
+    if (statement->kind == ast::NodeKind::VAR_STATEMENT)
+        return static_cast<ast::VarStatement *>(statement)->expression;
+
+    assert(statement->kind == ast::NodeKind::EXPRESSION_STATEMENT);
+    return static_cast<ast::ExpressionStatement *>(statement)->expression;
+}
+
+void testAnnotations()
+{
+    std::cout << "-------------[Resolver Annotation Test]------------\n";
+
+    ast::Program *program = parse("var g = 1;"
+                                  "var f = funksion(a, b, a) {"
+                                  "    var c = a;"
+                                  "    nese (b) { var d = c; var c = 2; }"
+                                  "    funksion(e) { a + e + d + g + h }"
+                                  "};");
+    resolver::resolve(*program);
+    assert(program->resolved);
+
+    auto *global = static_cast<ast::VarStatement *>(program->statements[0]);
+    assert(global->name->depth == ast::GLOBAL_DEPTH && "program var statements bind globals");
+
+    auto *outer = static_cast<ast::FunctionLiteral *>(expressionOf(program->statements[1]));
+    assert(outer->resolved);
+    assert(outer->slotCount == 4 && "a, b, c and d, the repeated a and c share their slot");
+    assert(outer->parameters[0]->slot == 0 && outer->parameters[1]->slot == 1 && outer->parameters[2]->slot == 0);
+    assert(outer->locals.size() == 2 && "c and d are hoisted out of the if block");
+    assert(outer->slotOf(outer->locals[0]->symbol) == 2);
+    assert(outer->slotOf(outer->locals[1]->symbol) == 3);
+    assert(outer->slotOf(token::intern("g")) == ast::NO_SLOT);
+
+    // a + e + d + g + h parses left to right, the rightmost operand sits at the top
+    auto *inner = static_cast<ast::FunctionLiteral *>(expressionOf(outer->body->statements[2]));
+    assert(inner->slotCount == 1 && inner->locals.empty());
+
+    auto *sum = static_cast<ast::InfixExpression *>(expressionOf(inner->body->statements[0]));
+    std::vector<ast::Identifier *> operands;
+    for (ast::Expression *node = sum; node->kind == ast::NodeKind::INFIX_EXPRESSION;)
+    {
+        auto *infix = static_cast<ast::InfixExpression *>(node);
+        operands.insert(operands.begin(), static_cast<ast::Identifier *>(infix->right));
+        node = infix->left;
+        if (node->kind == ast::NodeKind::IDENTIFIER)
+            operands.insert(operands.begin(), static_cast<ast::Identifier *>(node));
+    }
+    assert(operands.size() == 5);
+
+    assert(operands[0]->depth == 1 && operands[0]->slot == 0 && "a is the outer function's parameter");
+    assert(operands[1]->depth == 0 && operands[1]->slot == 0 && "e is the inner function's parameter");
+    assert(operands[2]->depth == 1 && operands[2]->slot == 3 && "d is the outer function's local");
+    assert(operands[3]->depth == ast::GLOBAL_DEPTH && "g is declared by no function");
+    assert(operands[4]->depth == ast::GLOBAL_DEPTH && "h is declared nowhere");
+
+    delete program;
+    std::cout << "RESOLVER ANNOTATION TESTS PASSED!" << std::endl;
+}
+
+void testFunctionLiteralOnItsOwn()
+{
+    std::cout << "-------------[Resolver Function Literal Test]------------\n";
+
+    ast::Program *program = parse("funksion(x) { funksion() { x + y } }");
+    auto *function = static_cast<ast::FunctionLiteral *>(expressionOf(program->statements[0]));
+    resolver::resolve(*function);
+    assert(function->resolved && !program->resolved);
+
+    auto *inner = static_cast<ast::FunctionLiteral *>(expressionOf(function->body->statements[0]));
+    auto *sum = static_cast<ast::InfixExpression *>(expressionOf(inner->body->statements[0]));
+    auto *x = static_cast<ast::Identifier *>(sum->left);
+    auto *y = static_cast<ast::Identifier *>(sum->right);
+    assert(x->depth == 1 && x->slot == 0);
+    assert(y->depth == ast::UNRESOLVED_DEPTH && "nothing is known about the functions around the literal");
+
+    // Evaluating the literal directly resolves it too, free names are found by symbol
+    ast::Program *direct = parse("funksion(x) { x + y }");
+    auto *literal = static_cast<ast::FunctionLiteral *>(expressionOf(direct->statements[0]));
+    auto *env = new object::Environment();
+    env->set(token::intern("y"), new object::Integer(30));
+    object::Object *value = evaluator::evaluate(literal, env);
+    assert(literal->resolved && value->type() == object::FUNC_OBJECT);
+
+    delete program;
+    std::cout << "RESOLVER FUNCTION LITERAL TESTS PASSED!" << std::endl;
+}
+
+void testResolvedEvaluation()
+{
+    struct ResolverTestCase
+    {
+        std::string input;
+        std::string expected; // inspect of the result
+    };
+
+    std::vector<ResolverTestCase> tests{
+        {"var a = 1; var a = 2; a", "1"},
+        {"var f = funksion(x) { var x = 2; x }; f(1)", "1"},
+        {"funksion(a, a) { a }(1, 2)", "1"},
+        {"var f = funksion(x) { var y = x * 2; nese (y > 4) { var z = y + 1; } z }; f(3)", "7"},
+        {"var y = 5; var f = funksion() { nese (falso) { var y = 1; } y }; f()", "5"},
+        {"var f = funksion() { funksion() { later } }; var later = 7; f()()", "7"},
+        {"var make = funksion(a) { funksion(b) { funksion(c) { a + b + c } } }; make(1)(20)(300)", "321"},
+        {"var counter = funksion(n) { nese (n < 1) { kthen 0; } n + counter(n - 1) }; counter(10)", "55"},
+        {"var a = funksion(x) { var y = x + 1; funksion(z) { var w = y * z; funksion() { w + x + y + z } } };"
+         "a(1)(2)()",
+         "9"},
+        {"var f = funksion() { missing }; f()", "GABIM: identifikuesi nuk gjindet: missing"},
+    };
+
+    std::cout << "-------------[Resolver Evaluation Test]------------\n";
+    for (const auto &test : tests)
+    {
+        std::cout << "TEST: " << test.input;
+
+        ast::Program *program = parse(test.input);
+        object::Object *result = evaluator::evaluate(program, new object::Environment());
+        const std::string got = result ? result->inspect() : "null";
+        if (got != test.expected)
+        {
+            std::cout << "\n\texpected: " << test.expected << "\n\tgot:      " << got << std::endl;
+        }
+        assert(got == test.expected && "resolved program evaluates differently");
+
+        std::cout << " ✓\n";
+    }
+
+    // Programs evaluated one after another in the same environment, like the lines of the REPL
+    auto *env = new object::Environment();
+    evaluator::evaluate(parse("var base = 10;"), env);
+    evaluator::evaluate(parse("var add = funksion(x) { x + base };"), env);
+    object::Object *result = evaluator::evaluate(parse("add(5)"), env);
+    assert(result->inspect() == "15" && "globals of earlier programs are visible");
+
+    std::cout << "RESOLVER EVALUATION TESTS PASSED!" << std::endl;
+}
+
+int main()
+{
+    testAnnotations();
+    testFunctionLiteralOnItsOwn();
+    testResolvedEvaluation();
+
+    return 0;
+}
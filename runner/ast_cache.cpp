@@ -0,0 +1,361 @@
+#include "ast_cache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "flat_ast.hpp"
+#include "runner.hpp"
+
+using namespace runner;
+
+namespace
+{
+    // "EAST" read as a little endian integer, a cache written on a machine of the other byte order does not match
+    constexpr uint32_t MAGIC = 0x54534145;
+
+    // The file starts with this header and is followed by the sections in the order of their counts below:
+    // nodes, integers, lists, symbols and the strings the integers and symbols point into.
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint32_t root;
+        uint32_t nodeCount;
+        uint32_t integerCount;
+        uint32_t listCount;
+        uint32_t symbolCount;
+        uint32_t stringSize;
+    };
+
+    // A string in the strings section
+    struct CachedString
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct CachedInteger
+    {
+        int64_t value;
+        CachedString literal;
+    };
+
+    static_assert(sizeof(ast::FlatNode) == 16 && std::is_trivially_copyable_v<ast::FlatNode>,
+                  "Flat nodes are written to the cache as they are in memory, bump AST_CACHE_VERSION on changes");
+
+    // Returns the size of a cache file with the given header, computed in 64 bits so bogus counts can't overflow it
+    uint64_t expectedSize(const CacheHeader &header)
+    {
+        return sizeof(CacheHeader) +
+               uint64_t{header.nodeCount} * sizeof(ast::FlatNode) +
+               uint64_t{header.integerCount} * sizeof(CachedInteger) +
+               uint64_t{header.listCount} * sizeof(ast::NodeIndex) +
+               uint64_t{header.symbolCount} * sizeof(CachedString) +
+               header.stringSize;
+    }
+
+    // Copies count elements of the section starting at cursor into a vector and moves the cursor past it. An empty
+    // section copies nothing, the data of an empty vector may be null which memcpy must not get.
+    template <class T>
+    std::vector<T> readSection(const char *&cursor, uint32_t count)
+    {
+        std::vector<T> section(count);
+        if (count != 0)
+        {
+            std::memcpy(section.data(), cursor, count * sizeof(T));
+            cursor += count * sizeof(T);
+        }
+        return section;
+    }
+
+    template <class T>
+    void writeSection(std::ofstream &file, const std::vector<T> &section)
+    {
+        file.write(reinterpret_cast<const char *>(section.data()), static_cast<std::streamsize>(section.size() * sizeof(T)));
+    }
+
+    bool isStatement(ast::FlatKind kind)
+    {
+        return kind == ast::FlatKind::VAR || kind == ast::FlatKind::RETURN || kind == ast::FlatKind::EXPRESSION;
+    }
+
+    bool isExpression(ast::FlatKind kind)
+    {
+        return kind >= ast::FlatKind::IDENTIFIER && kind <= ast::FlatKind::CALL;
+    }
+
+    bool isBlock(ast::FlatKind kind)
+    {
+        return kind == ast::FlatKind::BLOCK;
+    }
+
+    bool isIdentifier(ast::FlatKind kind)
+    {
+        return kind == ast::FlatKind::IDENTIFIER;
+    }
+
+    bool isOperator(token::TokenType type)
+    {
+        return type < token::TOKEN_TYPE_COUNT && ast::operatorOf(type) != ast::Operator::NONE;
+    }
+
+    // Checks that the flat program has the shape of a program the parser produced without errors, so rebuilding
+    // it can't go out of bounds or put a node where another kind is expected. Children have to come after their
+    // parent, as flatten lays them out, which also rules out cycles.
+    bool isWellFormed(const ast::FlatProgram &flat, size_t symbolCount)
+    {
+        const auto isChild = [&](ast::NodeIndex parent, ast::NodeIndex child, bool (*kindMatches)(ast::FlatKind))
+        {
+            return child > parent && child < flat.nodes.size() && kindMatches(flat[child].kind);
+        };
+
+        const auto isList = [&](ast::NodeIndex parent, ast::NodeIndex first, ast::NodeIndex count,
+                                bool (*kindMatches)(ast::FlatKind))
+        {
+            if (uint64_t{first} + count > flat.lists.size())
+            {
+                return false;
+            }
+
+            for (ast::NodeIndex i = first; i < first + count; ++i)
+            {
+                if (!isChild(parent, flat.lists[i], kindMatches))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        if (flat.root != 0 || flat.nodes.empty() || flat[flat.root].kind != ast::FlatKind::BLOCK)
+        {
+            return false;
+        }
+
+        for (ast::NodeIndex index = 0; index < flat.nodes.size(); ++index)
+        {
+            const ast::FlatNode &node = flat[index];
+            bool valid = false;
+            switch (node.kind)
+            {
+            case ast::FlatKind::VAR:
+                valid = node.a < symbolCount && isChild(index, node.b, isExpression);
+                break;
+            case ast::FlatKind::RETURN:
+            case ast::FlatKind::EXPRESSION:
+                valid = isChild(index, node.a, isExpression);
+                break;
+            case ast::FlatKind::BLOCK:
+                valid = isList(index, node.a, node.b, isStatement);
+                break;
+            case ast::FlatKind::IDENTIFIER:
+                valid = node.a < symbolCount;
+                break;
+            case ast::FlatKind::INTEGER:
+                valid = node.a < flat.integers.size();
+                break;
+            case ast::FlatKind::BOOLEAN:
+                valid = node.a <= 1;
+                break;
+            case ast::FlatKind::PREFIX:
+                valid = isOperator(node.op) && isChild(index, node.a, isExpression);
+                break;
+            case ast::FlatKind::INFIX:
+                valid = isOperator(node.op) && isChild(index, node.a, isExpression) &&
+                        isChild(index, node.b, isExpression);
+                break;
+            case ast::FlatKind::IF:
+                valid = isChild(index, node.a, isExpression) && isChild(index, node.b, isBlock) &&
+                        (node.c == ast::NO_NODE || isChild(index, node.c, isBlock));
+                break;
+            case ast::FlatKind::FUNCTION:
+                valid = isList(index, node.a, node.b, isIdentifier) && isChild(index, node.c, isBlock);
+                break;
+            case ast::FlatKind::CALL:
+                valid = isChild(index, node.a, isExpression) && isList(index, node.b, node.c, isExpression);
+                break;
+            }
+
+            if (!valid)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool isSymbolField(const ast::FlatNode &node)
+    {
+        return node.kind == ast::FlatKind::VAR || node.kind == ast::FlatKind::IDENTIFIER;
+    }
+}
+
+std::string runner::astCachePath(const std::string &scriptPath)
+{
+    return scriptPath + ".ast";
+}
+
+uint64_t runner::hashSource(std::string_view source)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char ch : source)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool runner::writeAstCache(const std::string &path, std::string_view source, const ast::Program &program)
+{
+    ast::FlatProgram flat = ast::flatten(program);
+
+    // Symbols are only meaningful inside this process, the cache stores their names and refers to them by position
+    std::unordered_map<token::Symbol, uint32_t> cachedSymbols;
+    std::vector<CachedString> symbols;
+    std::string strings;
+
+    const auto addString = [&](std::string_view text)
+    {
+        const CachedString cached{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+        strings += text;
+        return cached;
+    };
+
+    for (ast::FlatNode &node : flat.nodes)
+    {
+        if (isSymbolField(node))
+        {
+            const auto [it, inserted] = cachedSymbols.try_emplace(node.a, static_cast<uint32_t>(symbols.size()));
+            if (inserted)
+            {
+                symbols.push_back(addString(token::symbolName(node.a)));
+            }
+
+            node.a = it->second;
+        }
+    }
+
+    std::vector<CachedInteger> integers;
+    integers.reserve(flat.integers.size());
+    for (const ast::IntegerConstant &integer : flat.integers)
+    {
+        integers.push_back({integer.value, addString(integer.literal)});
+    }
+
+    const CacheHeader header{
+        MAGIC,
+        AST_CACHE_VERSION,
+        hashSource(source),
+        source.size(),
+        flat.root,
+        static_cast<uint32_t>(flat.nodes.size()),
+        static_cast<uint32_t>(integers.size()),
+        static_cast<uint32_t>(flat.lists.size()),
+        static_cast<uint32_t>(symbols.size()),
+        static_cast<uint32_t>(strings.size()),
+    };
+
+    // Written next to the cache and renamed over it, so a run never maps a half written cache
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writeSection(file, flat.nodes);
+        writeSection(file, integers);
+        writeSection(file, flat.lists);
+        writeSection(file, symbols);
+        file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+        if (!file)
+        {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+ast::Program *runner::loadAstCache(const std::string &path, std::string_view source)
+{
+    auto file = std::make_shared<const MappedFile>(path);
+    const std::string_view contents = file->contents();
+
+    CacheHeader header{};
+    if (!file->getError().empty() || contents.size() < sizeof(header))
+    {
+        return nullptr;
+    }
+
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != AST_CACHE_VERSION || expectedSize(header) != contents.size() ||
+        header.sourceSize != source.size() || header.sourceHash != hashSource(source))
+    {
+        return nullptr;
+    }
+
+    ast::FlatProgram flat;
+    const char *cursor = contents.data() + sizeof(header);
+    flat.nodes = readSection<ast::FlatNode>(cursor, header.nodeCount);
+    const std::vector<CachedInteger> integers = readSection<CachedInteger>(cursor, header.integerCount);
+    flat.lists = readSection<ast::NodeIndex>(cursor, header.listCount);
+    const std::vector<CachedString> symbols = readSection<CachedString>(cursor, header.symbolCount);
+    const std::string_view strings(cursor, header.stringSize);
+
+    const auto isInStrings = [&](CachedString string)
+    {
+        return uint64_t{string.offset} + string.length <= strings.size();
+    };
+
+    // Integer literals point straight into the mapping, which the program keeps alive as its source
+    flat.integers.reserve(integers.size());
+    for (const CachedInteger &integer : integers)
+    {
+        if (!isInStrings(integer.literal))
+        {
+            return nullptr;
+        }
+
+        flat.integers.push_back({integer.value, strings.substr(integer.literal.offset, integer.literal.length)});
+    }
+
+    flat.root = header.root;
+    flat.source = file;
+    if (!isWellFormed(flat, symbols.size()))
+    {
+        return nullptr;
+    }
+
+    std::vector<token::Symbol> interned;
+    interned.reserve(symbols.size());
+    for (const CachedString &symbol : symbols)
+    {
+        if (!isInStrings(symbol))
+        {
+            return nullptr;
+        }
+
+        interned.push_back(token::intern(strings.substr(symbol.offset, symbol.length)));
+    }
+
+    for (ast::FlatNode &node : flat.nodes)
+    {
+        if (isSymbolField(node))
+        {
+            node.a = interned[node.a];
+        }
+    }
+
+    return ast::unflatten(flat);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "ast.hpp"
+
+namespace runner
+{
+    // Version of the cache file layout, bumped whenever the layout or the meaning of a flat node field changes,
+    // or the cached program is processed differently before it is written (2: programs are optimized).
+    // Cache files of any other version are ignored and rewritten.
+    constexpr uint32_t AST_CACHE_VERSION = 2;
+
+    // Returns the path of the AST cache kept next to the given script
+    std::string astCachePath(const std::string &scriptPath);
+
+    // Returns the 64 bit FNV-1a hash of the given source, a cache is only used for the source it was written for
+    uint64_t hashSource(std::string_view source);
+
+    // Writes the program parsed from source to the cache file at path, replacing the old cache atomically.
+    // Returns false if the cache could not be written, the script runs fine without one.
+    bool writeAstCache(const std::string &path, std::string_view source, const ast::Program &program);
+
+    // Maps the cache file at path and rebuilds the program stored in it without lexing or parsing.
+    // Returns nullptr if there is no usable cache: it is missing, malformed, of another version
+    // or was written for a different source.
+    ast::Program *loadAstCache(const std::string &path, std::string_view source);
+}
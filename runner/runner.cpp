@@ -0,0 +1,211 @@
+#include "runner.hpp"
+#include <algorithm>
+#include <memory>
+#include "ast_cache.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "optimizer.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "repl.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace runner;
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path)
+{
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        fileHandle = nullptr;
+        error = "could not open " + path;
+        return;
+    }
+
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    if (size == 0)
+    {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle)
+    {
+        data = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+
+    if (!data)
+    {
+        size = 0;
+        error = "could not map " + path;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+}
+#else
+MappedFile::MappedFile(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "could not open " + path + ": " + std::strerror(errno);
+        return;
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0)
+    {
+        error = "could not stat " + path + ": " + std::strerror(errno);
+        close(fd);
+        return;
+    }
+
+    if (info.st_size > 0)
+    {
+        void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            error = "could not map " + path + ": " + std::strerror(errno);
+        }
+        else
+        {
+            data = static_cast<const char *>(mapped);
+            size = static_cast<size_t>(info.st_size);
+            // The lexer walks the script front to back exactly once
+            madvise(mapped, size, MADV_SEQUENTIAL);
+        }
+    }
+
+    // The mapping keeps the file alive on its own
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        munmap(const_cast<char *>(data), size);
+}
+#endif
+
+int runner::runFile(const std::string &path, std::ostream &out, std::ostream &err, bool useAstCache)
+{
+    auto file = std::make_shared<const MappedFile>(path);
+    if (!file->getError().empty())
+    {
+        err << file->getError() << std::endl;
+        return FILE_ERROR;
+    }
+
+    const std::string cachePath = astCachePath(path);
+    ast::Program *program = useAstCache ? loadAstCache(cachePath, file->contents()) : nullptr;
+    if (!program)
+    {
+        // The lexer reads the mapping in place, the program keeps the mapping alive through its source
+        Parser parser(new lexer::Lexer(file->contents(), file));
+        program = parser.parseProgram();
+
+        const std::vector<std::string> errors = parser.getErrors();
+        if (!errors.empty())
+        {
+            repl::printParseErrors(err, errors);
+            return PARSE_ERROR;
+        }
+
+        // The cache keeps the optimized program, loading it skips this pass too
+        optimizer::optimize(*program);
+
+        if (useAstCache)
+        {
+            writeAstCache(cachePath, file->contents(), *program);
+        }
+    }
+
+    auto *env = new object::Environment();
+    object::Object *result = evaluator::evaluate(program, env);
+
+    if (evaluator::isError(result))
+    {
+        err << result->inspect() << std::endl;
+        return RUNTIME_ERROR;
+    }
+
+    if (result)
+    {
+        out << result->inspect() << std::endl;
+    }
+
+    return SUCCESS;
+}
+
+namespace
+{
+    ParsedFile parseFile(const std::string &path)
+    {
+        ParsedFile result{path, nullptr, {}};
+
+        auto file = std::make_shared<const MappedFile>(path);
+        if (!file->getError().empty())
+        {
+            result.errors.push_back(file->getError());
+            return result;
+        }
+
+        try
+        {
+            Parser parser(new lexer::Lexer(file->contents(), file));
+            result.program = parser.parseProgram();
+            result.errors = parser.getErrors();
+        }
+        catch (const std::exception &exception)
+        {
+            result.errors.push_back(exception.what());
+        }
+
+        return result;
+    }
+}
+
+std::vector<ParsedFile> runner::parseFiles(const std::vector<std::string> &paths, ThreadPool &pool)
+{
+    std::vector<ParsedFile> results(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        // Every task writes only to its own slot, wait orders those writes before the results are read
+        pool.submit([&path = paths[i], &result = results[i]]
+                    { result = parseFile(path); });
+    }
+
+    pool.wait();
+    return results;
+}
+
+std::vector<ParsedFile> runner::parseFiles(const std::vector<std::string> &paths, size_t threadCount)
+{
+    ThreadPool pool(std::min(threadCount == 0 ? std::thread::hardware_concurrency() : threadCount,
+                             std::max<size_t>(paths.size(), 1)));
+    return parseFiles(paths, pool);
+}
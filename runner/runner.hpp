@@ -0,0 +1,67 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.hpp"
+#include "thread_pool.hpp"
+
+namespace runner
+{
+    // Exit codes of a script run
+    constexpr int SUCCESS = 0;
+    constexpr int FILE_ERROR = 1;    // The script could not be opened or mapped
+    constexpr int PARSE_ERROR = 2;   // The script has syntax errors, nothing was evaluated
+    constexpr int RUNTIME_ERROR = 3; // Evaluating the script produced an error object
+    constexpr int USAGE_ERROR = 4;   // The command line was not understood
+
+    // Read only memory mapping of a whole file, unmapped when destroyed.
+    // Mapping an empty file succeeds with empty contents.
+    class MappedFile
+    {
+    public:
+        MappedFile(const std::string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // The bytes of the file, valid for the lifetime of the mapping
+        std::string_view contents() const { return {data, size}; }
+
+        // Getter for the reason the file could not be mapped, empty if it was mapped
+        const std::string &getError() const { return error; }
+
+    private:
+        const char *data = nullptr;
+        size_t size = 0;
+        std::string error{};
+#ifdef _WIN32
+        void *fileHandle = nullptr;
+        void *mappingHandle = nullptr;
+#endif
+    };
+
+    // Maps the script at the given path, lexes and parses it as one program and evaluates it.
+    // With useAstCache the program is loaded from the AST cache next to the script when the cache matches it,
+    // otherwise the parsed program is written to the cache for the next run.
+    // The value of the program is written to out, parse and runtime errors are written to err.
+    // Returns one of the exit codes above.
+    int runFile(const std::string &path, std::ostream &out, std::ostream &err, bool useAstCache = true);
+
+    // Program parsed from one file by parseFiles
+    struct ParsedFile
+    {
+        std::string path;
+        ast::Program *program = nullptr; // Owned by the caller, nullptr if the file could not be mapped
+        std::vector<std::string> errors; // Mapping or parse errors, empty if the file parsed cleanly
+    };
+
+    // Lexes and parses every file into its own program, one file per task on the given pool.
+    // Results are in the order of paths. Files share nothing but the symbol table, which is safe to intern into concurrently.
+    std::vector<ParsedFile> parseFiles(const std::vector<std::string> &paths, ThreadPool &pool);
+
+    // Same as above on a pool of the given size, 0 uses one thread per hardware thread
+    std::vector<ParsedFile> parseFiles(const std::vector<std::string> &paths, size_t threadCount = 0);
+}
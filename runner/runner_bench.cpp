@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "runner.hpp"
+#include "ast_cache.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Writes a script of roughly the given size made of function definitions and calls
+std::string writeGeneratedScript(size_t targetSize, const std::string &name = "eaglecl_bench.ecl")
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream file(path, std::ios::binary);
+
+    size_t written = 0;
+    for (size_t i = 0; written < targetSize; ++i)
+    {
+        std::ostringstream line;
+        line << "var vlera_e_funksionit = funksion(a, b) { nese (a < b) { kthen a * b + " << i
+             << "; } perndryshe { kthen a - b; } };\n"
+             << "var rezultati = vlera_e_funksionit(" << i << ", 7) + (3 * 4 - 2) / 5;\n";
+        file << line.str();
+        written += line.str().size();
+    }
+
+    file << "rezultati;\n";
+    return path.string();
+}
+
+// Parses a directory worth of scripts with 1 up to N threads
+void benchmarkParseFiles()
+{
+    constexpr size_t FILES = 32;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < FILES; ++i)
+    {
+        paths.push_back(writeGeneratedScript(1024 * 1024, "eaglecl_bench_" + std::to_string(i) + ".ecl"));
+    }
+
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << FILES << " files of 1 MB, " << cores << " hardware threads\n";
+
+    double single = 0;
+    for (size_t threads = 1; threads <= std::max<size_t>(cores, 4); threads *= 2)
+    {
+        double best = 1e300;
+        for (int run = 0; run < 3; ++run)
+        {
+            const auto start = Clock::now();
+            std::vector<runner::ParsedFile> results = runner::parseFiles(paths, threads);
+            best = std::min(best, millisecondsSince(start));
+
+            for (runner::ParsedFile &result : results)
+            {
+                delete result.program;
+            }
+        }
+
+        single = threads == 1 ? best : single;
+        std::cout << threads << " threads: " << best << " ms, speedup " << single / best << "x\n";
+    }
+
+    for (const std::string &path : paths)
+    {
+        std::filesystem::remove(path);
+    }
+}
+
+// Pass "parallel" to run the parallel parsing benchmark instead of the single script startup one
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::string(argv[1]) == "parallel")
+    {
+        benchmarkParseFiles();
+        return 0;
+    }
+
+    const std::string path = writeGeneratedScript(10 * 1024 * 1024);
+    std::cout << "script: " << std::filesystem::file_size(path) / (1024.0 * 1024.0) << " MB\n";
+
+    // Same steps as runner::runFile, timed one by one
+    const auto start = Clock::now();
+
+    auto file = std::make_shared<const runner::MappedFile>(path);
+    const double mapped = millisecondsSince(start);
+
+    Parser parser(new lexer::Lexer(file->contents(), file));
+    ast::Program *program = parser.parseProgram();
+    const double parsed = millisecondsSince(start);
+
+    auto *env = new object::Environment();
+    object::Object *result = evaluator::evaluate(program, env);
+    const double evaluated = millisecondsSince(start);
+
+    std::cout << "map:                  " << mapped << " ms\n"
+              << "lex + parse:          " << parsed - mapped << " ms\n"
+              << "start to first eval:  " << parsed << " ms\n"
+              << "evaluate:             " << evaluated - parsed << " ms\n"
+              << "result:               " << (result ? result->inspect() : "null") << std::endl;
+
+    // A second run finds the AST cache the first one left behind
+    const std::string cachePath = runner::astCachePath(path);
+    runner::writeAstCache(cachePath, file->contents(), *program);
+    std::cout << "cache:                " << std::filesystem::file_size(cachePath) / (1024.0 * 1024.0) << " MB\n";
+
+    const auto cachedStart = Clock::now();
+    auto cachedFile = std::make_shared<const runner::MappedFile>(path);
+    ast::Program *cached = runner::loadAstCache(cachePath, cachedFile->contents());
+    const double loaded = millisecondsSince(cachedStart);
+
+    std::cout << "cached start to first eval: " << loaded << " ms"
+              << (cached ? "" : " (cache was not used)") << std::endl;
+
+    std::filesystem::remove(cachePath);
+    std::filesystem::remove(path);
+    return 0;
+}
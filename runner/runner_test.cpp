@@ -0,0 +1,202 @@
+#include <assert.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "runner.hpp"
+#include "ast_cache.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+// Writes the script to a file in the temp directory and returns its path
+std::string writeScript(const std::string &name, const std::string &script)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream file(path, std::ios::binary);
+    file << script;
+
+    return path.string();
+}
+
+void testMappedFile()
+{
+    const std::string path = writeScript("eaglecl_mapped.ecl", "var a = 5;");
+
+    runner::MappedFile file(path);
+    assert(file.getError().empty() && "mapping an existing file failed");
+    assert(file.contents() == "var a = 5;" && "mapped contents differ from the file");
+
+    const std::string emptyPath = writeScript("eaglecl_empty.ecl", "");
+    runner::MappedFile empty(emptyPath);
+    assert(empty.getError().empty() && "mapping an empty file failed");
+    assert(empty.contents().empty() && "empty file has contents");
+
+    runner::MappedFile missing("/this/path/does/not/exist.ecl");
+    assert(!missing.getError().empty() && "missing file was mapped");
+
+    std::remove(path.c_str());
+    std::remove(emptyPath.c_str());
+    std::cout << "MAPPED FILE TESTS PASSED!" << std::endl;
+}
+
+void testRunFile()
+{
+    struct Test
+    {
+        std::string script;
+        int exitCode;
+        std::string out;
+        std::string err;
+    };
+
+    const std::vector<Test> tests{
+        {R"(var shuma = funksion(a, b) {
+    kthen a + b;
+};
+
+var x = shuma(2, 3);
+nese (x > 4) { x * 10 } perndryshe { 0 }
+)",
+         runner::SUCCESS, "50\n", ""},
+        {"", runner::SUCCESS, "", ""},
+        {"var x = 5;", runner::SUCCESS, "", ""},
+        {"var = 5;", runner::PARSE_ERROR, "", "\tExpected next token to be IDENT, got = instead.\n"},
+        {"var a = 5;\n5 + vertet;\n a;", runner::RUNTIME_ERROR, "", "GABIM: mospërputhje i tipit: INTEGJER + BOOLEAN\n"},
+    };
+
+    for (const auto &test : tests)
+    {
+        const std::string path = writeScript("eaglecl_run.ecl", test.script);
+        std::ostringstream out;
+        std::ostringstream err;
+
+        const int exitCode = runner::runFile(path, out, err);
+
+        assert(exitCode == test.exitCode && "wrong exit code");
+        assert(out.str() == test.out && "wrong output");
+        assert(err.str().rfind(test.err, 0) == 0 && "wrong error output");
+
+        // The second run loads the program from the AST cache the first run wrote
+        std::ostringstream cachedOut;
+        std::ostringstream cachedErr;
+        assert(runner::runFile(path, cachedOut, cachedErr) == test.exitCode && "wrong exit code from cache");
+        assert(cachedOut.str() == test.out && "wrong output from cache");
+        assert(cachedErr.str().rfind(test.err, 0) == 0 && "wrong error output from cache");
+
+        std::remove(path.c_str());
+        std::remove(runner::astCachePath(path).c_str());
+    }
+
+    std::ostringstream out;
+    std::ostringstream err;
+    assert(runner::runFile("/this/path/does/not/exist.ecl", out, err) == runner::FILE_ERROR);
+
+    std::cout << "RUN FILE TESTS PASSED!" << std::endl;
+}
+
+void testAstCache()
+{
+    const std::string script = R"(var shuma = funksion(a, b) { kthen a + b * 007; };
+nese (shuma(1, 2) > 4) { -shuma(vertet, !falso) } perndryshe { var vlerë = 3; vlerë }
+)";
+    const std::string path = writeScript("eaglecl_cache.ecl", script);
+    const std::string cachePath = runner::astCachePath(path);
+
+    Parser parser(new lexer::Lexer(script));
+    ast::Program *parsed = parser.parseProgram();
+
+    assert(runner::loadAstCache(cachePath, script) == nullptr && "loaded a cache that was never written");
+    assert(runner::writeAstCache(cachePath, script, *parsed) && "writing the cache failed");
+
+    ast::Program *loaded = runner::loadAstCache(cachePath, script);
+    assert(loaded && "loading the cache failed");
+    assert(loaded->toString() == parsed->toString() && "cached program differs from the parsed one");
+
+    // A cache is only used for the exact source it was written for
+    assert(runner::loadAstCache(cachePath, script + " ") == nullptr && "cache used for a longer source");
+    std::string edited = script;
+    edited[edited.find("007")] = '1';
+    assert(runner::loadAstCache(cachePath, edited) == nullptr && "cache used for an edited source");
+
+    // A truncated cache is rejected instead of being read past its end
+    std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath) - 1);
+    assert(runner::loadAstCache(cachePath, script) == nullptr && "truncated cache was loaded");
+
+    // Sections can be empty, this program has no integer literals
+    const std::string noIntegers = "var x = vertet;\nx;";
+    Parser noIntegersParser(new lexer::Lexer(noIntegers));
+    ast::Program *noIntegersParsed = noIntegersParser.parseProgram();
+    assert(runner::writeAstCache(cachePath, noIntegers, *noIntegersParsed) && "writing the cache failed");
+    ast::Program *noIntegersLoaded = runner::loadAstCache(cachePath, noIntegers);
+    assert(noIntegersLoaded && noIntegersLoaded->toString() == noIntegersParsed->toString() &&
+           "cached program without integers differs from the parsed one");
+
+    delete noIntegersLoaded;
+    delete noIntegersParsed;
+    delete loaded;
+    delete parsed;
+    std::remove(path.c_str());
+    std::remove(cachePath.c_str());
+    std::cout << "AST CACHE TESTS PASSED!" << std::endl;
+}
+
+void testParseFiles()
+{
+    std::vector<std::string> paths;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 12; ++i)
+    {
+        const std::string name = "vlera_" + std::string(1, static_cast<char>('a' + i));
+        std::ostringstream script;
+        script << "var " << name << " = funksion(a) { nese (a < " << i << ") { a * 2 } perndryshe { -a } };\n"
+               << name << "(" << i * 3 << ") + shuma_" << static_cast<char>('a' + i % 3) << ";";
+
+        paths.push_back(writeScript("eaglecl_parallel_" + std::to_string(i) + ".ecl", script.str()));
+
+        Parser parser(new lexer::Lexer(script.str()));
+        ast::Program *program = parser.parseProgram();
+        expected.push_back(program->toString());
+        delete program;
+    }
+
+    paths.push_back(writeScript("eaglecl_parallel_error.ecl", "var = 5;"));
+    paths.push_back("/this/path/does/not/exist.ecl");
+
+    for (size_t threadCount : {1, 4})
+    {
+        std::vector<runner::ParsedFile> results = runner::parseFiles(paths, threadCount);
+        assert(results.size() == paths.size() && "one result per file");
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            assert(results[i].path == paths[i] && "results are out of order");
+            assert(results[i].errors.empty() && "clean file has errors");
+            assert(results[i].program->toString() == expected[i] && "parallel parse differs from a sequential one");
+            delete results[i].program;
+        }
+
+        const runner::ParsedFile &syntaxError = results[expected.size()];
+        assert(syntaxError.program && !syntaxError.errors.empty() && "parse error was not reported");
+        delete syntaxError.program;
+
+        const runner::ParsedFile &missing = results.back();
+        assert(!missing.program && !missing.errors.empty() && "missing file was not reported");
+    }
+
+    for (const std::string &path : paths)
+    {
+        std::remove(path.c_str());
+    }
+
+    std::cout << "PARSE FILES TESTS PASSED!" << std::endl;
+}
+
+int main()
+{
+    testMappedFile();
+    testRunFile();
+    testAstCache();
+    testParseFiles();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+using namespace runner;
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back([this]
+                             { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    taskAvailable.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        ++unfinished;
+    }
+
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasksFinished.wait(lock, [this]
+                       { return unfinished == 0; });
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]
+                               { return stopping || !tasks.empty(); });
+
+            if (tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--unfinished == 0)
+        {
+            tasksFinished.notify_all();
+        }
+    }
+}
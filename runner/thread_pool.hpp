@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace runner
+{
+    // Fixed set of worker threads running submitted tasks in the order they were submitted
+    class ThreadPool
+    {
+    public:
+        // Starts the given number of workers, 0 starts one per hardware thread
+        explicit ThreadPool(size_t threadCount = 0);
+
+        // Runs the tasks still queued and joins the workers
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Queues the task for the next free worker. Tasks must not throw.
+        void submit(std::function<void()> task);
+
+        // Blocks until every task submitted so far has finished
+        void wait();
+
+        // Returns the number of worker threads
+        size_t size() const { return workers.size(); }
+
+    private:
+        std::vector<std::thread> workers{};
+        std::deque<std::function<void()>> tasks{};
+        std::mutex mutex{};
+        std::condition_variable taskAvailable{};
+        std::condition_variable tasksFinished{};
+        size_t unfinished = 0; // Tasks queued or running
+        bool stopping = false;
+
+        // Loop of every worker, takes tasks off the queue until the pool stops
+        void work();
+    };
+}
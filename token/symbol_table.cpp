@@ -0,0 +1,112 @@
+#include "symbol_table.hpp"
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace token
+{
+    namespace
+    {
+        // Interning locks only the shard the name hashes to, so threads lexing different names rarely wait
+        constexpr size_t SHARD_COUNT = 16;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::deque<std::string> names; // A deque never moves the strings the views below point into
+            std::unordered_map<std::string_view, Symbol> symbols;
+        };
+
+        std::array<Shard, SHARD_COUNT> shards;
+
+        // Names by symbol, kept in fixed size pages that never move once allocated so symbolName needs no lock
+        constexpr size_t PAGE_SIZE = 4096;
+        constexpr size_t MAX_PAGES = 4096;
+
+        std::array<std::atomic<std::string_view *>, MAX_PAGES> pages{};
+        std::mutex pagesMutex;
+        std::atomic<Symbol> nextSymbol{NO_SYMBOL + 1};
+
+        std::string_view *pageOf(Symbol symbol)
+        {
+            std::atomic<std::string_view *> &page = pages[symbol / PAGE_SIZE];
+            if (std::string_view *existing = page.load(std::memory_order_acquire))
+            {
+                return existing;
+            }
+
+            std::lock_guard<std::mutex> lock(pagesMutex);
+            if (!page.load(std::memory_order_relaxed))
+            {
+                page.store(new std::string_view[PAGE_SIZE], std::memory_order_release);
+            }
+
+            return page.load(std::memory_order_relaxed);
+        }
+
+        Symbol internShared(std::string_view name)
+        {
+            Shard &shard = shards[std::hash<std::string_view>{}(name) % SHARD_COUNT];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            auto found = shard.symbols.find(name);
+            if (found != shard.symbols.end())
+            {
+                return found->second;
+            }
+
+            const Symbol symbol = nextSymbol.fetch_add(1, std::memory_order_relaxed);
+            if (symbol / PAGE_SIZE >= MAX_PAGES)
+            {
+                throw std::length_error("too many distinct identifiers");
+            }
+
+            // The name is in place before the symbol is published through the shard
+            const std::string_view stored = shard.names.emplace_back(name);
+            pageOf(symbol)[symbol % PAGE_SIZE] = stored;
+            shard.symbols.emplace(stored, symbol);
+
+            return symbol;
+        }
+    }
+
+    Symbol intern(std::string_view name)
+    {
+        // Every thread remembers the symbols it has seen, after warming up lexing takes no locks at all
+        thread_local std::unordered_map<std::string_view, Symbol> seen;
+
+        auto found = seen.find(name);
+        if (found != seen.end())
+        {
+            return found->second;
+        }
+
+        const Symbol symbol = internShared(name);
+        seen.emplace(symbolName(symbol), symbol);
+
+        return symbol;
+    }
+
+    std::string_view symbolName(Symbol symbol)
+    {
+        // Pages are allocated as symbols are handed out, a page that isn't there yet holds no names
+        if (symbol / PAGE_SIZE >= MAX_PAGES)
+        {
+            return {};
+        }
+
+        const std::string_view *page = pages[symbol / PAGE_SIZE].load(std::memory_order_acquire);
+        return page ? page[symbol % PAGE_SIZE] : std::string_view{};
+    }
+
+    size_t symbolCount()
+    {
+        return nextSymbol.load(std::memory_order_acquire);
+    }
+}
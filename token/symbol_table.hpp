@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace token
+{
+    // Compact id of an interned identifier, equal names always get the same symbol.
+    // The table is shared by every thread, all functions below are safe to call concurrently.
+    using Symbol = uint32_t;
+
+    // Symbol of tokens that aren't identifiers, no name is ever interned as it
+    constexpr Symbol NO_SYMBOL = 0;
+
+    // Returns the symbol of the given name, interning the name the first time it is seen
+    Symbol intern(std::string_view name);
+
+    // Returns the name of an interned symbol, the view stays valid until the program exits. NO_SYMBOL and symbols
+    // that were never handed out have an empty name.
+    std::string_view symbolName(Symbol symbol);
+
+    // Returns the number of interned symbols, every symbol handed out so far is below it
+    size_t symbolCount();
+}
@@ -1,26 +1,65 @@
 #include "token.hpp"
-#include <stdexcept>
 
 namespace token
 {
-    std::unordered_map<std::string_view, TokenType> keywords = {
-        {"funksion", FUNCTION},
-        {"var", VAR},
-        {"vertet", TRUE},
-        {"falso", FALSE},
-        {"nese", IF},
-        {"perndryshe", ELSE},
-        {"kthen", RETURN}};
+    // Size of the keyword hash table, a power of two bigger than the number of keywords
+    constexpr size_t KEYWORD_TABLE_SIZE = 16;
 
-    TokenType LookupIdentifier(std::string_view identifier)
+    // Hashes an identifier from its length and its first and last characters
+    constexpr size_t keywordHash(std::string_view identifier)
+    {
+        return (identifier.size() +
+                static_cast<unsigned char>(identifier.front()) +
+                static_cast<unsigned char>(identifier.back())) %
+               KEYWORD_TABLE_SIZE;
+    }
+
+    // Every keyword placed at the slot of its hash, free slots have an empty literal
+    constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> keywordTable = []
     {
-        try
+        std::array<Keyword, KEYWORD_TABLE_SIZE> table{};
+        for (const Keyword &keyword : keywords)
         {
-            return keywords.at(identifier);
+            table[keywordHash(keyword.literal)] = keyword;
         }
-        catch (const std::out_of_range &e)
+
+        return table;
+    }();
+
+    // Checks that no two keywords landed in the same slot
+    constexpr bool isPerfectHash()
+    {
+        for (const Keyword &keyword : keywords)
+        {
+            if (keywordTable[keywordHash(keyword.literal)].literal != keyword.literal)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(isPerfectHash(), "Keywords collide in keywordTable, adjust keywordHash or KEYWORD_TABLE_SIZE");
+
+    TokenType LookupIdentifier(std::string_view identifier)
+    {
+        if (identifier.empty())
         {
             return IDENT;
         }
+
+        const Keyword &candidate = keywordTable[keywordHash(identifier)];
+        if (candidate.literal == identifier)
+        {
+            return candidate.type;
+        }
+
+        return IDENT;
+    }
+
+    std::ostream &operator<<(std::ostream &out, TokenType type)
+    {
+        return out << toString(type);
     }
-}
\ No newline at end of file
+}
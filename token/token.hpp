@@ -1,63 +1,107 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include "symbol_table.hpp"
 
 namespace token
 {
-    using TokenType = std::string_view;
-
-    // Status
-    constexpr TokenType ILLEGAL = "ILLEGAL";
-    constexpr TokenType EOF_ = "EOF";
-
-    // Identifiers
-    constexpr TokenType IDENT = "IDENT";
-    constexpr TokenType INT = "INT";
-
-    // Operators
-    constexpr TokenType ASSIGN = "=";
-    constexpr TokenType PLUS = "+";
-    constexpr TokenType MINUS = "-";
-    constexpr TokenType BANG = "!";
-    constexpr TokenType ASTERISK = "*";
-    constexpr TokenType SLASH = "/";
-    constexpr TokenType LT = "<";
-    constexpr TokenType GT = ">";
-    constexpr TokenType EQ = "==";
-    constexpr TokenType NOT_EQ = "!=";
-    constexpr TokenType LT_EQ = "<=";
-    constexpr TokenType GT_EQ = ">=";
-
-    // Delimiters
-    constexpr TokenType COMMA = ",";
-    constexpr TokenType SEMICOLON = ";";
-    constexpr TokenType LPAREN = "(";
-    constexpr TokenType RPAREN = ")";
-    constexpr TokenType LBRACE = "{";
-    constexpr TokenType RBRACE = "}";
-
-    // Keywords
-    constexpr TokenType FUNCTION = "FUNCTION";
-    constexpr TokenType VAR = "VAR";
-    constexpr TokenType TRUE = "TRUE";
-    constexpr TokenType FALSE = "FALSE";
-    constexpr TokenType IF = "IF";
-    constexpr TokenType ELSE = "ELSE";
-    constexpr TokenType RETURN = "RETURN";
-
-    extern std::unordered_map<std::string_view, TokenType> keywords;
+    // Every kind of token the lexer produces. The values are dense so a type can index the metadata tables below
+    enum TokenType : uint8_t
+    {
+        // Status
+        ILLEGAL,
+        EOF_,
+
+        // Identifiers
+        IDENT,
+        INT,
+
+        // Operators
+        ASSIGN,
+        PLUS,
+        MINUS,
+        BANG,
+        ASTERISK,
+        SLASH,
+        LT,
+        GT,
+        EQ,
+        NOT_EQ,
+        LT_EQ,
+        GT_EQ,
+
+        // Delimiters
+        COMMA,
+        SEMICOLON,
+        LPAREN,
+        RPAREN,
+        LBRACE,
+        RBRACE,
+
+        // Keywords
+        FUNCTION,
+        VAR,
+        TRUE,
+        FALSE,
+        IF,
+        ELSE,
+        RETURN,
+
+        TOKEN_TYPE_COUNT
+    };
+
+    // Human readable name of every TokenType, indexed by the type
+    constexpr std::array<std::string_view, TOKEN_TYPE_COUNT> tokenTypeNames{
+        "ILLEGAL", "EOF",
+        "IDENT", "INT",
+        "=", "+", "-", "!", "*", "/", "<", ">", "==", "!=", "<=", ">=",
+        ",", ";", "(", ")", "{", "}",
+        "FUNCTION", "VAR", "TRUE", "FALSE", "IF", "ELSE", "RETURN"};
+
+    // Returns the human readable name of the given TokenType
+    constexpr std::string_view toString(TokenType type)
+    {
+        return tokenTypeNames[type];
+    }
+
+    // Writes the human readable name of the given TokenType
+    std::ostream &operator<<(std::ostream &out, TokenType type);
+
+    struct Keyword
+    {
+        std::string_view literal;
+        TokenType type;
+    };
+
+    // Every keyword of the language with its TokenType, new keywords are added here
+    constexpr std::array<Keyword, 7> keywords{{
+        {"funksion", FUNCTION},
+        {"var", VAR},
+        {"vertet", TRUE},
+        {"falso", FALSE},
+        {"nese", IF},
+        {"perndryshe", ELSE},
+        {"kthen", RETURN},
+    }};
 
+    // A token produced by the lexer. The literal is a view into the source buffer the token was read from,
+    // so the buffer has to outlive every token (and AST node) that refers to it.
+    // Identifiers are interned while lexing and carry their symbol, other tokens have NO_SYMBOL.
     struct Token
     {
         TokenType type;
-        std::string literal;
+        std::string_view literal;
+        Symbol symbol = NO_SYMBOL;
     };
 
     // Returns the TokenType for the given identifier.
     // If the identifier is a keywords it return one of the available keyword TokenType
     // If not it returns TokenType::IDENT
+    // The lookup is a single probe into a perfect hash table built at compile time, it never allocates or throws
     TokenType LookupIdentifier(std::string_view identifier);
 
 }
@@ -0,0 +1,481 @@
+#include "register_vm.hpp"
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include "evaluator.hpp"
+
+using namespace vm;
+using code::RegisterOpcode;
+
+namespace
+{
+    // Reads RK(operand): a register of the call, or an integer constant from CONSTANT_OPERAND on
+    inline const Value &readOperand(uint16_t operand, const Value *base, const Value *constants)
+    {
+        // Picking the array instead of branching on the operand, constants and registers mix unpredictably
+        const Value *values = operand < code::CONSTANT_OPERAND ? base : constants - code::CONSTANT_OPERAND;
+        return values[operand];
+    }
+
+    // Looks up an unbound slot an operand names further out, the way GET_LOCAL does. Temporaries holding nothing
+    // are left as they are, nothing is a value of its own there.
+    object::Error *resolveOperand(Value &value, uint16_t operand, const code::RegisterFunction *function,
+                                  const Scope *scope, const std::vector<Value> &globals)
+    {
+        const uint32_t slotRegisters = function->hasScope ? 0 : function->slotCount;
+        if (value.type != ValueType::NOTHING || operand >= slotRegisters)
+        {
+            return nullptr;
+        }
+
+        const token::Symbol name = function->slotSymbols[operand];
+        value = lookup(scope, name, globals);
+        return value.type == ValueType::NOTHING ? unknownIdentifier(name) : nullptr;
+    }
+
+    // Result of the operator on two integers
+    Value applyToIntegers(ast::Operator op, int64_t left, int64_t right)
+    {
+        switch (op)
+        {
+        case ast::Operator::PLUS:
+            return integerValue(left + right);
+        case ast::Operator::MINUS:
+            return integerValue(left - right);
+        case ast::Operator::MULTIPLY:
+            return integerValue(left * right);
+        case ast::Operator::DIVIDE:
+            return integerValue(left / right);
+        case ast::Operator::LESS:
+            return booleanValue(left < right);
+        case ast::Operator::GREATER:
+            return booleanValue(left > right);
+        case ast::Operator::EQUAL:
+            return booleanValue(left == right);
+        case ast::Operator::NOT_EQUAL:
+            return booleanValue(left != right);
+        case ast::Operator::LESS_EQUAL:
+            return booleanValue(left <= right);
+        default:
+            return booleanValue(left >= right);
+        }
+    }
+
+    // Writes RK(b) op RK(c) to R(a) for operands that aren't both integers, or weren't before the unbound slots
+    // among them were looked up. Kept apart from binary so its fast path stays small enough to inline.
+    object::Error *binarySlowPath(ast::Operator op, const code::RegisterInstruction &instruction, Value *base,
+                                  const Value *constants, const code::RegisterFunction *function, const Scope *scope,
+                                  const std::vector<Value> &globals)
+    {
+        Value left = readOperand(instruction.b, base, constants);
+        Value right = readOperand(instruction.c, base, constants);
+
+        if (object::Error *error = resolveOperand(left, instruction.b, function, scope, globals))
+            return error;
+        if (object::Error *error = resolveOperand(right, instruction.c, function, scope, globals))
+            return error;
+
+        if (left.type == ValueType::INTEGER && right.type == ValueType::INTEGER)
+        {
+            base[instruction.a] = applyToIntegers(op, left.integer, right.integer);
+            return nullptr;
+        }
+
+        if (object::Error *error = binaryFallback(op, left, right))
+            return error;
+
+        base[instruction.a] = left;
+        return nullptr;
+    }
+
+    // Writes RK(b) op RK(c) to R(a), returns the error if there is one
+    template <class Operation, ast::Operator op>
+    inline object::Error *binary(const code::RegisterInstruction &instruction, Value *base, const Value *constants,
+                                 const code::RegisterFunction *function, const Scope *scope,
+                                 const std::vector<Value> &globals)
+    {
+        const Value &left = readOperand(instruction.b, base, constants);
+        const Value &right = readOperand(instruction.c, base, constants);
+        if (left.type != ValueType::INTEGER || right.type != ValueType::INTEGER)
+        {
+            return binarySlowPath(op, instruction, base, constants, function, scope, globals);
+        }
+
+        const auto result = Operation{}(left.integer, right.integer);
+        if constexpr (std::is_same_v<decltype(result), const bool>)
+        {
+            base[instruction.a] = booleanValue(result);
+        }
+        else
+        {
+            base[instruction.a] = integerValue(result);
+        }
+        return nullptr;
+    }
+}
+
+RegisterVM::RegisterVM() : registers{new Value[STACK_SIZE]}
+{
+}
+
+object::Object *RegisterVM::run(const code::RegisterBytecode &bytecode)
+{
+    instructionCount = 0;
+    return countingInstructions ? execute<true>(bytecode) : execute<false>(bytecode);
+}
+
+#ifdef EAGLECL_THREADED_DISPATCH
+// Labels the handler of an opcode as a case of the switch and as a target of the handler table
+#define TARGET(op) \
+    TARGET_##op:   \
+    case RegisterOpcode::op:
+
+// Ends a handler by jumping to the handler of the next instruction
+#define DISPATCH()          \
+    if constexpr (counting) \
+    {                       \
+        ++instructionCount; \
+    }                       \
+    instruction = ip++;     \
+    goto *handlers[static_cast<size_t>(instruction->op)]
+#else
+#define TARGET(op) case RegisterOpcode::op:
+#define DISPATCH() continue
+#endif
+
+template <bool counting>
+object::Object *RegisterVM::execute(const code::RegisterBytecode &bytecode)
+{
+    // Every symbol of the program was interned while parsing it, globals are read without a bounds check
+    if (globals.size() < token::symbolCount())
+    {
+        globals.resize(token::symbolCount(), nothing());
+    }
+
+    constants.clear();
+    for (const int64_t constant : bytecode.constants)
+    {
+        constants.push_back(integerValue(constant));
+    }
+
+    const Value *constantValues = constants.data();
+    const Value *registersEnd = registers.get() + STACK_SIZE;
+
+    frames.clear();
+    Frame frame{&bytecode.program, nullptr, registers.get(), nullptr};
+    const code::RegisterInstruction *code = frame.function->instructions.data();
+    const code::RegisterInstruction *ip = code;
+
+    if (frame.base + frame.function->registerCount > registersEnd)
+    {
+        return new object::Error(std::string(STACK_OVERFLOW));
+    }
+
+#ifdef EAGLECL_THREADED_DISPATCH
+    // Handler of every opcode, in the order of the opcodes. Compiled code holds no opcode past COUNT.
+    static const void *const handlers[static_cast<size_t>(RegisterOpcode::COUNT) + 1]{
+        &&TARGET_LOAD_CONSTANT, &&TARGET_LOAD_BOOLEAN, &&TARGET_LOAD_NULL, &&TARGET_LOAD_NOTHING, &&TARGET_MOVE,
+        &&TARGET_ADD, &&TARGET_SUBTRACT, &&TARGET_MULTIPLY, &&TARGET_DIVIDE, &&TARGET_LESS, &&TARGET_GREATER,
+        &&TARGET_EQUAL, &&TARGET_NOT_EQUAL, &&TARGET_LESS_EQUAL, &&TARGET_GREATER_EQUAL, &&TARGET_MINUS,
+        &&TARGET_NOT, &&TARGET_JUMP, &&TARGET_JUMP_IF_FALSE, &&TARGET_GET_GLOBAL, &&TARGET_SET_GLOBAL,
+        &&TARGET_GET_LOCAL, &&TARGET_SET_LOCAL, &&TARGET_GET_SCOPED, &&TARGET_SET_SCOPED, &&TARGET_GET_NAME,
+        &&TARGET_CLOSURE, &&TARGET_CALL, &&TARGET_RETURN, &&TARGET_COUNT};
+#endif
+
+    Value *base = frame.base;
+    const code::RegisterInstruction *instruction;
+
+    // Threaded dispatch goes through the switch for the first instruction only
+    for (;;)
+    {
+        if constexpr (counting)
+        {
+            ++instructionCount;
+        }
+
+        instruction = ip++;
+        switch (instruction->op)
+        {
+        TARGET(LOAD_CONSTANT)
+            base[instruction->a] = constantValues[instruction->bx()];
+            DISPATCH();
+
+        TARGET(LOAD_BOOLEAN)
+            base[instruction->a] = booleanValue(instruction->b != 0);
+            DISPATCH();
+
+        TARGET(LOAD_NULL)
+            base[instruction->a] = Value{ValueType::NULL_VALUE, {0}};
+            DISPATCH();
+
+        TARGET(LOAD_NOTHING)
+            base[instruction->a] = nothing();
+            DISPATCH();
+
+        TARGET(MOVE)
+            base[instruction->a] = base[instruction->b];
+            DISPATCH();
+
+        TARGET(ADD)
+            if (object::Error *error = binary<std::plus<int64_t>, ast::Operator::PLUS>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(SUBTRACT)
+            if (object::Error *error = binary<std::minus<int64_t>, ast::Operator::MINUS>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(MULTIPLY)
+            if (object::Error *error = binary<std::multiplies<int64_t>, ast::Operator::MULTIPLY>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(DIVIDE)
+            if (object::Error *error = binary<std::divides<int64_t>, ast::Operator::DIVIDE>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(LESS)
+            if (object::Error *error = binary<std::less<int64_t>, ast::Operator::LESS>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(GREATER)
+            if (object::Error *error = binary<std::greater<int64_t>, ast::Operator::GREATER>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(EQUAL)
+            if (object::Error *error = binary<std::equal_to<int64_t>, ast::Operator::EQUAL>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(NOT_EQUAL)
+            if (object::Error *error = binary<std::not_equal_to<int64_t>, ast::Operator::NOT_EQUAL>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(LESS_EQUAL)
+            if (object::Error *error = binary<std::less_equal<int64_t>, ast::Operator::LESS_EQUAL>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(GREATER_EQUAL)
+            if (object::Error *error = binary<std::greater_equal<int64_t>, ast::Operator::GREATER_EQUAL>(
+                    *instruction, base, constantValues, frame.function, frame.scope, globals))
+                return error;
+            DISPATCH();
+
+        TARGET(MINUS)
+        {
+            const Value &right = base[instruction->b];
+            if (right.type != ValueType::INTEGER)
+            {
+                return evaluator::newError(object::UNKNOWN_OP_ERR, "-", objectType(right));
+            }
+
+            base[instruction->a] = integerValue(-right.integer);
+            DISPATCH();
+        }
+
+        TARGET(NOT)
+            base[instruction->a] = negate(base[instruction->b]);
+            DISPATCH();
+
+        TARGET(JUMP)
+            ip = code + instruction->bx();
+            DISPATCH();
+
+        TARGET(JUMP_IF_FALSE)
+            if (!isTruthy(base[instruction->a]))
+            {
+                ip = code + instruction->bx();
+            }
+            DISPATCH();
+
+        TARGET(GET_GLOBAL)
+        {
+            const Value &value = globals[instruction->bx()];
+            if (value.type == ValueType::NOTHING)
+            {
+                return unknownIdentifier(instruction->bx());
+            }
+
+            base[instruction->a] = value;
+            DISPATCH();
+        }
+
+        TARGET(SET_GLOBAL)
+        {
+            Value &global = globals[instruction->bx()];
+            if (global.type == ValueType::NOTHING)
+            {
+                global = base[instruction->a];
+            }
+            DISPATCH();
+        }
+
+        TARGET(GET_LOCAL)
+        {
+            Value value = base[instruction->b];
+            if (value.type == ValueType::NOTHING)
+            {
+                // The var statement binding the slot hasn't run, the name may still be bound further out
+                const token::Symbol name = frame.function->slotSymbols[instruction->b];
+                value = lookup(frame.scope, name, globals);
+                if (value.type == ValueType::NOTHING)
+                {
+                    return unknownIdentifier(name);
+                }
+            }
+
+            base[instruction->a] = value;
+            DISPATCH();
+        }
+
+        TARGET(SET_LOCAL)
+        {
+            Value &local = base[instruction->a];
+            if (local.type == ValueType::NOTHING)
+            {
+                local = base[instruction->b];
+            }
+            DISPATCH();
+        }
+
+        TARGET(GET_SCOPED)
+        {
+            const Scope *scope = frame.scope;
+            for (uint16_t depth = instruction->b; depth > 0; --depth)
+            {
+                scope = scope->outer;
+            }
+
+            Value value = scope->slots[instruction->c];
+            if (value.type == ValueType::NOTHING)
+            {
+                const token::Symbol name = scope->function->slotSymbols[instruction->c];
+                value = lookup(scope->outer, name, globals);
+                if (value.type == ValueType::NOTHING)
+                {
+                    return unknownIdentifier(name);
+                }
+            }
+
+            base[instruction->a] = value;
+            DISPATCH();
+        }
+
+        TARGET(SET_SCOPED)
+        {
+            Value &local = frame.scope->slots[instruction->a];
+            if (local.type == ValueType::NOTHING)
+            {
+                local = base[instruction->b];
+            }
+            DISPATCH();
+        }
+
+        TARGET(GET_NAME)
+        {
+            const token::Symbol name = instruction->bx();
+            const Value value = lookup(frame.scope, name, globals);
+            if (value.type == ValueType::NOTHING)
+            {
+                return unknownIdentifier(name);
+            }
+
+            base[instruction->a] = value;
+            DISPATCH();
+        }
+
+        TARGET(CLOSURE)
+            closures.push_back(std::make_unique<Closure>(bytecode.functions[instruction->bx()].get(), frame.scope));
+            base[instruction->a] = closureValue(closures.back().get());
+            DISPATCH();
+
+        TARGET(CALL)
+        {
+            const Value &callee = base[instruction->a];
+            if (callee.type != ValueType::CLOSURE)
+            {
+                return evaluator::newError(object::NOT_A_FUNC, objectType(callee));
+            }
+
+            // Closures of this machine are made from the functions of its bytecode
+            const auto *function = static_cast<const code::RegisterFunction *>(callee.closure->function);
+            Scope *scope = callee.closure->scope;
+            Value *calleeBase = base + instruction->a + 1;
+            if (calleeBase + function->registerCount > registersEnd)
+            {
+                return new object::Error(std::string(STACK_OVERFLOW));
+            }
+
+            frame.ip = ip;
+            frames.push_back(frame);
+
+            const uint16_t argumentCount = instruction->b;
+            if (function->hasScope)
+            {
+                scopes.push_back(std::make_unique<Scope>(
+                    Scope{scope, function, std::vector<Value>(function->slotCount, nothing())}));
+                scope = scopes.back().get();
+                bindArguments(function, calleeBase, argumentCount, scope->slots.data());
+            }
+            else if (function->argumentsInSlots)
+            {
+                // The arguments already are in their slots, the remaining slots start out unbound
+                const uint32_t bound = std::min<uint32_t>(argumentCount, function->parameterCount);
+                std::fill(calleeBase + bound, calleeBase + function->slotCount, nothing());
+            }
+            else
+            {
+                const std::vector<Value> arguments(calleeBase, calleeBase + argumentCount);
+                std::fill(calleeBase, calleeBase + function->slotCount, nothing());
+                bindArguments(function, arguments.data(), arguments.size(), calleeBase);
+            }
+
+            frame = Frame{function, nullptr, calleeBase, scope};
+            base = calleeBase;
+            code = function->instructions.data();
+            ip = code;
+            DISPATCH();
+        }
+
+        TARGET(RETURN)
+        {
+            const Value result = base[instruction->a];
+            if (frames.empty())
+            {
+                return toObject(result);
+            }
+
+            // The result takes the place of the callee
+            base[-1] = result;
+
+            frame = frames.back();
+            frames.pop_back();
+            base = frame.base;
+            code = frame.function->instructions.data();
+            ip = frame.ip;
+            DISPATCH();
+        }
+
+        TARGET(COUNT)
+            return new object::Error("unknown opcode");
+        }
+    }
+}
+
+#undef TARGET
+#undef DISPATCH
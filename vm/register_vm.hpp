@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "object.hpp"
+#include "register_code.hpp"
+#include "value.hpp"
+#include "vm.hpp"
+
+namespace vm
+{
+    // Register machine running programs compiled by compiler::compileToRegisters. Every call works on a window of
+    // one register file, starting right after the register of its callee. Globals stay bound from one run to the
+    // next, like the global environment the evaluator is given.
+    class RegisterVM
+    {
+    public:
+        RegisterVM();
+
+        RegisterVM(const RegisterVM &) = delete;
+        RegisterVM &operator=(const RegisterVM &) = delete;
+
+        // Runs the program and returns its value as a new object, the error that stopped it or nullptr if the
+        // program has no value. Closures stay owned by the machine, the bytecode has to outlive them.
+        object::Object *run(const code::RegisterBytecode &bytecode);
+
+        // Makes the runs from now on count the instructions they execute, which slows them down
+        void setCountingInstructions(bool counting) { countingInstructions = counting; }
+
+        // Getter for the number of instructions the last run executed, 0 unless it was counting them
+        uint64_t getInstructionCount() const { return instructionCount; }
+
+    private:
+        template <bool counting>
+        object::Object *execute(const code::RegisterBytecode &bytecode);
+
+        // Call in progress, the ones the current call was made from are kept in frames
+        struct Frame
+        {
+            const code::RegisterFunction *function;
+            const code::RegisterInstruction *ip;
+            Value *base;  // Register 0 of the call
+            Scope *scope; // Scope of the call, or the one its closure was made in for functions without one
+        };
+
+        std::unique_ptr<Value[]> registers; // STACK_SIZE of them
+        std::vector<Frame> frames;
+        std::vector<Value> globals; // Indexed by symbol
+        std::vector<Value> constants;
+
+        std::vector<std::unique_ptr<Scope>> scopes;
+        std::vector<std::unique_ptr<Closure>> closures;
+
+        bool countingInstructions = false;
+        uint64_t instructionCount = 0;
+    };
+}
@@ -0,0 +1,131 @@
+#include "value.hpp"
+#include <algorithm>
+#include "evaluator.hpp"
+
+using namespace vm;
+
+namespace
+{
+    // Object standing in for a value while the evaluator builds an error message about it
+    class Operand
+    {
+    public:
+        explicit Operand(const Value &value)
+        {
+            switch (value.type)
+            {
+            case ValueType::INTEGER:
+                integer.value = value.integer;
+                object = &integer;
+                break;
+            case ValueType::BOOLEAN:
+                boolean.value = value.boolean;
+                object = &boolean;
+                break;
+            case ValueType::CLOSURE:
+                object = value.closure;
+                break;
+            default:
+                object = &null;
+                break;
+            }
+        }
+
+        object::Object *get() const { return object; }
+
+    private:
+        object::Integer integer;
+        object::Boolean boolean;
+        object::Null null;
+        object::Object *object;
+    };
+}
+
+object::ObjectType Closure::type() const
+{
+    return object::FUNC_OBJECT;
+}
+
+std::string Closure::inspect() const
+{
+    return object::Function(function->literal, nullptr).inspect();
+}
+
+object::ObjectType vm::objectType(const Value &value)
+{
+    switch (value.type)
+    {
+    case ValueType::INTEGER:
+        return object::INTEGER_OBJ;
+    case ValueType::BOOLEAN:
+        return object::BOOLEAN_OBJ;
+    case ValueType::CLOSURE:
+        return object::FUNC_OBJECT;
+    default:
+        return object::NULL_OBJ;
+    }
+}
+
+object::Object *vm::toObject(const Value &value)
+{
+    switch (value.type)
+    {
+    case ValueType::INTEGER:
+        return new object::Integer(value.integer);
+    case ValueType::BOOLEAN:
+        return new object::Boolean(value.boolean);
+    case ValueType::NULL_VALUE:
+        return new object::Null();
+    case ValueType::CLOSURE:
+        return value.closure;
+    default:
+        return nullptr;
+    }
+}
+
+object::Error *vm::binaryFallback(ast::Operator op, Value &left, const Value &right)
+{
+    if (left.type == ValueType::BOOLEAN && right.type == ValueType::BOOLEAN &&
+        (op == ast::Operator::EQUAL || op == ast::Operator::NOT_EQUAL))
+    {
+        left.boolean = (left.boolean == right.boolean) == (op == ast::Operator::EQUAL);
+        return nullptr;
+    }
+
+    const Operand leftOperand(left), rightOperand(right);
+    return static_cast<object::Error *>(evaluator::evaluateInfixExpression(op, leftOperand.get(), rightOperand.get()));
+}
+
+object::Error *vm::unknownIdentifier(token::Symbol name)
+{
+    return evaluator::newError(object::UNKNOWN_IDENT, token::symbolName(name));
+}
+
+void vm::bindArguments(const code::FunctionPrototype *function, const Value *arguments, size_t argumentCount,
+                       Value *slots)
+{
+    const size_t count = std::min<size_t>(argumentCount, function->parameterCount);
+    for (size_t index = 0; index < count; ++index)
+    {
+        Value &slot = slots[function->literal->parameters[index]->slot];
+        if (slot.type == ValueType::NOTHING)
+        {
+            slot = arguments[index];
+        }
+    }
+}
+
+Value vm::lookup(const Scope *scope, token::Symbol name, const std::vector<Value> &globals)
+{
+    for (; scope; scope = scope->outer)
+    {
+        const std::vector<token::Symbol> &symbols = scope->function->slotSymbols;
+        const auto found = std::find(symbols.begin(), symbols.end(), name);
+        if (found != symbols.end() && scope->slots[found - symbols.begin()].type != ValueType::NOTHING)
+        {
+            return scope->slots[found - symbols.begin()];
+        }
+    }
+
+    return name < globals.size() ? globals[name] : nothing();
+}
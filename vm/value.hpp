@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "code.hpp"
+#include "object.hpp"
+#include "symbol_table.hpp"
+
+namespace vm
+{
+    struct Closure;
+
+    // Type of a value on the stack. NOTHING is the value of statements without one and of unbound variables,
+    // the evaluator's nullptr.
+    enum class ValueType : uint8_t
+    {
+        INTEGER,
+        BOOLEAN,
+        NULL_VALUE,
+        CLOSURE,
+        NOTHING,
+    };
+
+    // A value on the stack or in a variable. Integers and booleans are held directly, without allocating objects.
+    struct Value
+    {
+        ValueType type;
+        union
+        {
+            int64_t integer;
+            bool boolean;
+            Closure *closure;
+        };
+    };
+
+    constexpr Value nothing()
+    {
+        return Value{ValueType::NOTHING, {0}};
+    }
+
+    inline Value integerValue(int64_t integer)
+    {
+        Value value{ValueType::INTEGER, {}};
+        value.integer = integer;
+        return value;
+    }
+
+    inline Value booleanValue(bool boolean)
+    {
+        Value value{ValueType::BOOLEAN, {}};
+        value.boolean = boolean;
+        return value;
+    }
+
+    inline Value closureValue(Closure *closure)
+    {
+        Value value{ValueType::CLOSURE, {}};
+        value.closure = closure;
+        return value;
+    }
+
+    // Same as evaluator::isTruthy: null and falso are false, anything else is true
+    inline bool isTruthy(const Value &value)
+    {
+        return value.type == ValueType::BOOLEAN ? value.boolean : value.type != ValueType::NULL_VALUE;
+    }
+
+    // Same as evaluator::evaluateBangOperatorExpression: nothing negates to vertet, other values to falso
+    inline Value negate(const Value &value)
+    {
+        return booleanValue(value.type == ValueType::BOOLEAN ? !value.boolean : value.type == ValueType::NOTHING);
+    }
+
+    // Slots of one call of a function with nested function literals, enclosed by the scope its closure was made in
+    struct Scope
+    {
+        Scope *outer;
+        const code::FunctionPrototype *function;
+        std::vector<Value> slots;
+    };
+
+    // A compiled function and the scope it was made in. Its type and inspect are those of object::Function.
+    struct Closure final : public object::Object
+    {
+        const code::FunctionPrototype *function;
+        Scope *scope;
+
+        Closure(const code::FunctionPrototype *compiledFunction, Scope *enclosingScope)
+            : function{compiledFunction}, scope{enclosingScope}
+        {
+        }
+
+        object::ObjectType type() const override;
+        std::string inspect() const override;
+    };
+
+    // Type the value has as an object, nothing passes for null in error messages
+    object::ObjectType objectType(const Value &value);
+
+    // Returns the value as an object the caller owns, closures stay owned by the machine. nullptr for nothing.
+    object::Object *toObject(const Value &value);
+
+    // Applies an operator to operands that aren't both integers, writing the result over the left operand.
+    // Apart from comparing booleans every such operation is an error, the evaluator makes it so the messages match.
+    object::Error *binaryFallback(ast::Operator op, Value &left, const Value &right);
+
+    object::Error *unknownIdentifier(token::Symbol name);
+
+    // Binds the arguments to the slots of the parameters, the first of a repeated parameter wins like in the
+    // evaluator. Parameters without an argument stay unbound, arguments without a parameter are dropped.
+    void bindArguments(const code::FunctionPrototype *function, const Value *arguments, size_t argumentCount,
+                       Value *slots);
+
+    // Looks the name up in the scope and the ones around it by symbol, then among the globals
+    Value lookup(const Scope *scope, token::Symbol name, const std::vector<Value> &globals);
+}
@@ -0,0 +1,511 @@
+#include "vm.hpp"
+#include <algorithm>
+#include <functional>
+#include "evaluator.hpp"
+
+using namespace vm;
+
+namespace
+{
+    // Pops the right operand and replaces the left one with the result, returns the error if there is one
+    template <class Operation, ast::Operator op>
+    object::Error *arithmetic(Value *&sp)
+    {
+        Value &left = sp[-2];
+        const Value &right = sp[-1];
+        --sp;
+
+        if (left.type == ValueType::INTEGER && right.type == ValueType::INTEGER)
+        {
+            left.integer = Operation{}(left.integer, right.integer);
+            return nullptr;
+        }
+
+        return binaryFallback(op, left, right);
+    }
+
+    template <class Comparison, ast::Operator op>
+    object::Error *comparison(Value *&sp)
+    {
+        Value &left = sp[-2];
+        const Value &right = sp[-1];
+        --sp;
+
+        if (left.type == ValueType::INTEGER && right.type == ValueType::INTEGER)
+        {
+            left = booleanValue(Comparison{}(left.integer, right.integer));
+            return nullptr;
+        }
+
+        return binaryFallback(op, left, right);
+    }
+
+    // Pushes the slot of the current call. If the var statement binding it hasn't run the name may still be bound
+    // further out, the error is returned if it isn't.
+    inline object::Error *pushLocal(Value *&sp, const Value *slots, const code::FunctionPrototype *function,
+                                    const Scope *scope, uint16_t slot, const std::vector<Value> &globals)
+    {
+        Value value = slots[slot];
+        if (value.type == ValueType::NOTHING)
+        {
+            const token::Symbol name = function->slotSymbols[slot];
+            value = lookup(scope, name, globals);
+            if (value.type == ValueType::NOTHING)
+            {
+                return unknownIdentifier(name);
+            }
+        }
+
+        *sp++ = value;
+        return nullptr;
+    }
+
+    // Pushes the slot of the scope many scopes out from the current one
+    inline object::Error *pushScoped(Value *&sp, const Scope *scope, uint16_t depth, uint16_t slot,
+                                     const std::vector<Value> &globals)
+    {
+        for (; depth > 0; --depth)
+        {
+            scope = scope->outer;
+        }
+
+        return pushLocal(sp, scope->slots.data(), scope->function, scope->outer, slot, globals);
+    }
+}
+
+VM::VM() : stack{new Value[STACK_SIZE]}
+{
+}
+
+object::Object *VM::run(const code::Bytecode &bytecode)
+{
+    instructionCount = 0;
+    previousOpcode = code::OPCODE_COUNT;
+    return countingInstructions || profile ? execute<true>(bytecode) : execute<false>(bytecode);
+}
+
+#ifdef EAGLECL_THREADED_DISPATCH
+// Labels the handler of an opcode as a case of the switch and as a target of the handler table
+#define TARGET(op) \
+    TARGET_##op:   \
+    case code::op:
+
+// Ends a handler by jumping to the handler of the next instruction
+#define DISPATCH()             \
+    if constexpr (counting)    \
+    {                          \
+        countInstruction(*ip); \
+    }                          \
+    goto *handlers[*ip++]
+#else
+#define TARGET(op) case code::op:
+#define DISPATCH() continue
+#endif
+
+template <bool counting>
+object::Object *VM::execute(const code::Bytecode &bytecode)
+{
+    // Every symbol of the program was interned while parsing it, globals are read without a bounds check
+    if (globals.size() < token::symbolCount())
+    {
+        globals.resize(token::symbolCount(), nothing());
+    }
+
+    const int64_t *constants = bytecode.constants.data();
+    const Value *stackEnd = stack.get() + STACK_SIZE;
+
+    frames.clear();
+    Frame frame{&bytecode.program, nullptr, stack.get(), nullptr};
+    const uint8_t *code = frame.function->instructions.data();
+    const uint8_t *ip = code;
+    Value *sp = frame.base;
+
+    if (frame.base + frame.function->maxStackDepth > stackEnd)
+    {
+        return new object::Error(std::string(STACK_OVERFLOW));
+    }
+
+#ifdef EAGLECL_THREADED_DISPATCH
+    // Handler of every opcode, in the order of the opcodes. Compiled code holds no opcode past OPCODE_COUNT.
+    static const void *const handlers[code::OPCODE_COUNT + 1]{
+        &&TARGET_CONSTANT, &&TARGET_TRUE_VALUE, &&TARGET_FALSE_VALUE, &&TARGET_NULL_VALUE, &&TARGET_NOTHING,
+        &&TARGET_POP, &&TARGET_ADD, &&TARGET_SUBTRACT, &&TARGET_MULTIPLY, &&TARGET_DIVIDE, &&TARGET_LESS,
+        &&TARGET_GREATER, &&TARGET_EQUAL, &&TARGET_NOT_EQUAL, &&TARGET_LESS_EQUAL, &&TARGET_GREATER_EQUAL,
+        &&TARGET_MINUS, &&TARGET_NOT, &&TARGET_JUMP, &&TARGET_JUMP_IF_FALSE, &&TARGET_GET_GLOBAL,
+        &&TARGET_SET_GLOBAL, &&TARGET_GET_LOCAL, &&TARGET_SET_LOCAL, &&TARGET_GET_SCOPED, &&TARGET_SET_SCOPED,
+        &&TARGET_GET_NAME, &&TARGET_CLOSURE, &&TARGET_CALL, &&TARGET_RETURN_VALUE, &&TARGET_GET_LOCAL_GET_LOCAL,
+        &&TARGET_ADD_CONSTANT, &&TARGET_SUBTRACT_CONSTANT, &&TARGET_MULTIPLY_CONSTANT, &&TARGET_LESS_JUMP_IF_FALSE,
+        &&TARGET_GET_LOCAL_ADD_CONSTANT, &&TARGET_GET_LOCAL_SUBTRACT_CONSTANT,
+        &&TARGET_GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE, &&TARGET_GET_SCOPED_ADD, &&TARGET_GET_SCOPED_SUBTRACT,
+        &&TARGET_OPCODE_COUNT};
+#endif
+
+    // Threaded dispatch goes through the switch for the first instruction only
+    for (;;)
+    {
+        if constexpr (counting)
+        {
+            countInstruction(*ip);
+        }
+
+        switch (static_cast<code::Opcode>(*ip++))
+        {
+        TARGET(CONSTANT)
+            *sp++ = integerValue(constants[code::readUint32(ip)]);
+            ip += 4;
+            DISPATCH();
+
+        TARGET(TRUE_VALUE)
+            *sp++ = booleanValue(true);
+            DISPATCH();
+
+        TARGET(FALSE_VALUE)
+            *sp++ = booleanValue(false);
+            DISPATCH();
+
+        TARGET(NULL_VALUE)
+            *sp++ = Value{ValueType::NULL_VALUE, {0}};
+            DISPATCH();
+
+        TARGET(NOTHING)
+            *sp++ = nothing();
+            DISPATCH();
+
+        TARGET(POP)
+            --sp;
+            DISPATCH();
+
+        TARGET(ADD)
+            if (object::Error *error = arithmetic<std::plus<int64_t>, ast::Operator::PLUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(SUBTRACT)
+            if (object::Error *error = arithmetic<std::minus<int64_t>, ast::Operator::MINUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(MULTIPLY)
+            if (object::Error *error = arithmetic<std::multiplies<int64_t>, ast::Operator::MULTIPLY>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(DIVIDE)
+            if (object::Error *error = arithmetic<std::divides<int64_t>, ast::Operator::DIVIDE>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(LESS)
+            if (object::Error *error = comparison<std::less<int64_t>, ast::Operator::LESS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(GREATER)
+            if (object::Error *error = comparison<std::greater<int64_t>, ast::Operator::GREATER>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(EQUAL)
+            if (object::Error *error = comparison<std::equal_to<int64_t>, ast::Operator::EQUAL>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(NOT_EQUAL)
+            if (object::Error *error = comparison<std::not_equal_to<int64_t>, ast::Operator::NOT_EQUAL>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(LESS_EQUAL)
+            if (object::Error *error = comparison<std::less_equal<int64_t>, ast::Operator::LESS_EQUAL>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(GREATER_EQUAL)
+            if (object::Error *error = comparison<std::greater_equal<int64_t>, ast::Operator::GREATER_EQUAL>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(MINUS)
+        {
+            Value &right = sp[-1];
+            if (right.type != ValueType::INTEGER)
+            {
+                return evaluator::newError(object::UNKNOWN_OP_ERR, "-", objectType(right));
+            }
+
+            right.integer = -right.integer;
+            DISPATCH();
+        }
+
+        TARGET(NOT)
+            sp[-1] = negate(sp[-1]);
+            DISPATCH();
+
+        TARGET(JUMP)
+            ip = code + code::readUint32(ip);
+            DISPATCH();
+
+        TARGET(JUMP_IF_FALSE)
+            ip = isTruthy(*--sp) ? ip + 4 : code + code::readUint32(ip);
+            DISPATCH();
+
+        TARGET(GET_GLOBAL)
+        {
+            const token::Symbol name = code::readUint32(ip);
+            ip += 4;
+
+            const Value &value = globals[name];
+            if (value.type == ValueType::NOTHING)
+            {
+                return unknownIdentifier(name);
+            }
+
+            *sp++ = value;
+            DISPATCH();
+        }
+
+        TARGET(SET_GLOBAL)
+        {
+            Value &global = globals[code::readUint32(ip)];
+            ip += 4;
+
+            --sp;
+            if (global.type == ValueType::NOTHING)
+            {
+                global = *sp;
+            }
+            DISPATCH();
+        }
+
+        TARGET(GET_LOCAL)
+            if (object::Error *error =
+                    pushLocal(sp, frame.base, frame.function, frame.scope, code::readUint16(ip), globals))
+                return error;
+            ip += 2;
+            DISPATCH();
+
+        TARGET(SET_LOCAL)
+        {
+            Value &local = frame.base[code::readUint16(ip)];
+            ip += 2;
+
+            --sp;
+            if (local.type == ValueType::NOTHING)
+            {
+                local = *sp;
+            }
+            DISPATCH();
+        }
+
+        TARGET(GET_SCOPED)
+            if (object::Error *error =
+                    pushScoped(sp, frame.scope, code::readUint16(ip), code::readUint16(ip + 2), globals))
+                return error;
+            ip += 4;
+            DISPATCH();
+
+        TARGET(SET_SCOPED)
+        {
+            Value &local = frame.scope->slots[code::readUint16(ip)];
+            ip += 2;
+
+            --sp;
+            if (local.type == ValueType::NOTHING)
+            {
+                local = *sp;
+            }
+            DISPATCH();
+        }
+
+        TARGET(GET_NAME)
+        {
+            const token::Symbol name = code::readUint32(ip);
+            ip += 4;
+
+            const Value value = lookup(frame.scope, name, globals);
+            if (value.type == ValueType::NOTHING)
+            {
+                return unknownIdentifier(name);
+            }
+
+            *sp++ = value;
+            DISPATCH();
+        }
+
+        TARGET(CLOSURE)
+        {
+            const code::CompiledFunction *function = bytecode.functions[code::readUint32(ip)].get();
+            ip += 4;
+
+            closures.push_back(std::make_unique<Closure>(function, frame.scope));
+            *sp++ = closureValue(closures.back().get());
+            DISPATCH();
+        }
+
+        TARGET(CALL)
+        {
+            const uint16_t argumentCount = code::readUint16(ip);
+            ip += 2;
+
+            const Value &callee = sp[-argumentCount - 1];
+            if (callee.type != ValueType::CLOSURE)
+            {
+                return evaluator::newError(object::NOT_A_FUNC, objectType(callee));
+            }
+
+            // Closures of this machine are made from the functions of its bytecode
+            const auto *function = static_cast<const code::CompiledFunction *>(callee.closure->function);
+            Value *base = sp - argumentCount;
+            if (base + function->slotCount + function->maxStackDepth > stackEnd)
+            {
+                return new object::Error(std::string(STACK_OVERFLOW));
+            }
+
+            frame.ip = ip;
+            frames.push_back(frame);
+
+            Scope *scope = callee.closure->scope;
+            if (function->hasScope)
+            {
+                scopes.push_back(std::make_unique<Scope>(
+                    Scope{scope, function, std::vector<Value>(function->slotCount, nothing())}));
+                scope = scopes.back().get();
+                bindArguments(function, base, argumentCount, scope->slots.data());
+                sp = base;
+            }
+            else
+            {
+                if (function->argumentsInSlots)
+                {
+                    // The arguments already are in their slots, the remaining slots start out unbound
+                    const uint32_t bound = std::min<uint32_t>(argumentCount, function->parameterCount);
+                    std::fill(base + bound, base + function->slotCount, nothing());
+                }
+                else
+                {
+                    const std::vector<Value> arguments(base, base + argumentCount);
+                    std::fill(base, base + function->slotCount, nothing());
+                    bindArguments(function, arguments.data(), arguments.size(), base);
+                }
+                sp = base + function->slotCount;
+            }
+
+            frame = Frame{function, nullptr, base, scope};
+            code = function->instructions.data();
+            ip = code;
+            DISPATCH();
+        }
+
+        TARGET(RETURN_VALUE)
+        {
+            const Value result = sp[-1];
+            if (frames.empty())
+            {
+                return toObject(result);
+            }
+
+            // The result takes the place of the callee
+            sp = frame.base - 1;
+            *sp++ = result;
+
+            frame = frames.back();
+            frames.pop_back();
+            code = frame.function->instructions.data();
+            ip = frame.ip;
+            DISPATCH();
+        }
+
+        // Superinstructions run the handlers of their sequence one after the other, without dispatching in between
+        TARGET(GET_LOCAL_GET_LOCAL)
+            if (object::Error *error =
+                    pushLocal(sp, frame.base, frame.function, frame.scope, code::readUint16(ip), globals))
+                return error;
+            if (object::Error *error =
+                    pushLocal(sp, frame.base, frame.function, frame.scope, code::readUint16(ip + 2), globals))
+                return error;
+            ip += 4;
+            DISPATCH();
+
+        TARGET(ADD_CONSTANT)
+            *sp++ = integerValue(constants[code::readUint32(ip)]);
+            ip += 4;
+            if (object::Error *error = arithmetic<std::plus<int64_t>, ast::Operator::PLUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(SUBTRACT_CONSTANT)
+            *sp++ = integerValue(constants[code::readUint32(ip)]);
+            ip += 4;
+            if (object::Error *error = arithmetic<std::minus<int64_t>, ast::Operator::MINUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(MULTIPLY_CONSTANT)
+            *sp++ = integerValue(constants[code::readUint32(ip)]);
+            ip += 4;
+            if (object::Error *error = arithmetic<std::multiplies<int64_t>, ast::Operator::MULTIPLY>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(LESS_JUMP_IF_FALSE)
+            if (object::Error *error = comparison<std::less<int64_t>, ast::Operator::LESS>(sp))
+                return error;
+            ip = isTruthy(*--sp) ? ip + 4 : code + code::readUint32(ip);
+            DISPATCH();
+
+        TARGET(GET_LOCAL_ADD_CONSTANT)
+            if (object::Error *error =
+                    pushLocal(sp, frame.base, frame.function, frame.scope, code::readUint16(ip), globals))
+                return error;
+            *sp++ = integerValue(constants[code::readUint32(ip + 2)]);
+            ip += 6;
+            if (object::Error *error = arithmetic<std::plus<int64_t>, ast::Operator::PLUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(GET_LOCAL_SUBTRACT_CONSTANT)
+            if (object::Error *error =
+                    pushLocal(sp, frame.base, frame.function, frame.scope, code::readUint16(ip), globals))
+                return error;
+            *sp++ = integerValue(constants[code::readUint32(ip + 2)]);
+            ip += 6;
+            if (object::Error *error = arithmetic<std::minus<int64_t>, ast::Operator::MINUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(GET_LOCAL_LESS_CONSTANT_JUMP_IF_FALSE)
+            if (object::Error *error =
+                    pushLocal(sp, frame.base, frame.function, frame.scope, code::readUint16(ip), globals))
+                return error;
+            *sp++ = integerValue(constants[code::readUint32(ip + 2)]);
+            if (object::Error *error = comparison<std::less<int64_t>, ast::Operator::LESS>(sp))
+                return error;
+            ip = isTruthy(*--sp) ? ip + 10 : code + code::readUint32(ip + 6);
+            DISPATCH();
+
+        TARGET(GET_SCOPED_ADD)
+            if (object::Error *error =
+                    pushScoped(sp, frame.scope, code::readUint16(ip), code::readUint16(ip + 2), globals))
+                return error;
+            ip += 4;
+            if (object::Error *error = arithmetic<std::plus<int64_t>, ast::Operator::PLUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(GET_SCOPED_SUBTRACT)
+            if (object::Error *error =
+                    pushScoped(sp, frame.scope, code::readUint16(ip), code::readUint16(ip + 2), globals))
+                return error;
+            ip += 4;
+            if (object::Error *error = arithmetic<std::minus<int64_t>, ast::Operator::MINUS>(sp))
+                return error;
+            DISPATCH();
+
+        TARGET(OPCODE_COUNT)
+            return new object::Error("unknown opcode");
+        }
+    }
+}
+
+#undef TARGET
+#undef DISPATCH
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "code.hpp"
+#include "object.hpp"
+#include "value.hpp"
+
+// Instruction handlers jump straight to the handler of the next instruction through a table of label addresses,
+// a GCC and Clang extension. Building with EAGLECL_SWITCH_DISPATCH defined makes every instruction go back
+// through one switch instead, as it does with other compilers.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(EAGLECL_SWITCH_DISPATCH)
+#define EAGLECL_THREADED_DISPATCH
+#endif
+
+namespace vm
+{
+    // How the machines dispatch instructions, decided when building
+#ifdef EAGLECL_THREADED_DISPATCH
+    constexpr std::string_view DISPATCH_MODE = "threaded";
+#else
+    constexpr std::string_view DISPATCH_MODE = "switch";
+#endif
+
+    // Error message of a call nested deeper than the stack has room for
+    constexpr std::string_view STACK_OVERFLOW = "stiva e thirrjeve u tejmbush";
+
+    // Most values the stack holds across all calls
+    constexpr size_t STACK_SIZE = 1 << 20;
+
+    // Stack machine running compiled programs. Globals stay bound from one run to the next, like the global
+    // environment the evaluator is given.
+    class VM
+    {
+    public:
+        VM();
+
+        VM(const VM &) = delete;
+        VM &operator=(const VM &) = delete;
+
+        // Runs the program and returns its value as a new object, the error that stopped it or nullptr if the
+        // program has no value. Closures stay owned by the machine, the bytecode has to outlive them.
+        object::Object *run(const code::Bytecode &bytecode);
+
+        // Makes the runs from now on count the instructions they execute, which slows them down
+        void setCountingInstructions(bool counting) { countingInstructions = counting; }
+
+        // Getter for the number of instructions the last run executed, 0 unless it was counting them
+        uint64_t getInstructionCount() const { return instructionCount; }
+
+        // Makes the runs from now on add the opcode pairs they execute to the profile, counting instructions as
+        // well. nullptr stops recording.
+        void setProfile(code::Profile *recordTo) { profile = recordTo; }
+
+    private:
+        template <bool counting>
+        object::Object *execute(const code::Bytecode &bytecode);
+
+        // Counts the instruction about to run, and the pair it makes with the one before when profiling
+        void countInstruction(uint8_t op)
+        {
+            ++instructionCount;
+            if (profile && previousOpcode != code::OPCODE_COUNT)
+            {
+                ++profile->pairs[previousOpcode][op];
+            }
+            previousOpcode = op;
+        }
+
+        // Call in progress, the ones the current call was made from are kept in frames
+        struct Frame
+        {
+            const code::CompiledFunction *function;
+            const uint8_t *ip;
+            Value *base;  // First slot of the call, the operand stack follows the slots
+            Scope *scope; // Scope of the call, or the one its closure was made in for functions without one
+        };
+
+        std::unique_ptr<Value[]> stack;
+        std::vector<Frame> frames;
+        std::vector<Value> globals; // Indexed by symbol
+
+        std::vector<std::unique_ptr<Scope>> scopes;
+        std::vector<std::unique_ptr<Closure>> closures;
+
+        bool countingInstructions = false;
+        uint64_t instructionCount = 0;
+
+        code::Profile *profile = nullptr;
+        uint8_t previousOpcode = code::OPCODE_COUNT;
+    };
+}
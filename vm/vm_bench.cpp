@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "compiler.hpp"
+#include "register_compiler.hpp"
+#include "superinstructions.hpp"
+#include "vm.hpp"
+#include "register_vm.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Number of times every script is run, the fastest run is reported
+constexpr int RUNS = 3;
+
+// Fastest run of a program, its result and the instructions it executed
+struct Measurement
+{
+    double milliseconds = 1e300;
+    std::string result;
+    uint64_t instructions = 0;
+};
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+Measurement measureEvaluator(ast::Program *program)
+{
+    Measurement measurement;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        auto *env = new object::Environment();
+
+        const auto start = Clock::now();
+        object::Object *evaluated = evaluator::evaluate(program, env);
+        measurement.milliseconds = std::min(measurement.milliseconds, millisecondsSince(start));
+
+        measurement.result = evaluated ? evaluated->inspect() : "null";
+    }
+
+    return measurement;
+}
+
+template <class Machine, class Bytecode>
+Measurement measureMachine(const Bytecode &bytecode)
+{
+    Measurement measurement;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        Machine machine;
+
+        const auto start = Clock::now();
+        object::Object *result = machine.run(bytecode);
+        measurement.milliseconds = std::min(measurement.milliseconds, millisecondsSince(start));
+
+        measurement.result = result ? result->inspect() : "null";
+    }
+
+    // Counting slows the machine down, the instructions are counted in a run of their own
+    Machine machine;
+    machine.setCountingInstructions(true);
+    machine.run(bytecode);
+    measurement.instructions = machine.getInstructionCount();
+
+    return measurement;
+}
+
+void report(const std::string &name, const Measurement &evaluator, const Measurement &stack,
+            const Measurement &registers)
+{
+    std::cout << name << ":\n"
+              << "\tevaluator:   " << evaluator.milliseconds << " ms (result " << evaluator.result << ")\n"
+              << "\tstack vm:    " << stack.milliseconds << " ms (result " << stack.result << "), "
+              << stack.instructions << " instructions, " << evaluator.milliseconds / stack.milliseconds << "x\n"
+              << "\tregister vm: " << registers.milliseconds << " ms (result " << registers.result << "), "
+              << registers.instructions << " instructions, " << evaluator.milliseconds / registers.milliseconds
+              << "x, " << static_cast<double>(registers.instructions) / stack.instructions
+              << " of the stack vm's instructions" << std::endl;
+}
+
+// Number of superinstructions a training run picks for a script
+constexpr size_t SUPERINSTRUCTIONS = 6;
+
+// Profiles a run of the script's bytecode, fuses the sequences that ran most and measures the stack machine on
+// the result, reporting how many fewer instructions it dispatched
+void reportSuperinstructions(ast::Program *program, const Measurement &stack)
+{
+    code::Bytecode bytecode = compiler::compile(*program);
+
+    code::Profile profile;
+    vm::VM training;
+    training.setProfile(&profile);
+    training.run(bytecode);
+
+    const std::vector<code::Opcode> selected = compiler::selectSuperinstructions(profile, SUPERINSTRUCTIONS);
+    compiler::fuseSuperinstructions(bytecode, selected);
+    const Measurement fused = measureMachine<vm::VM>(bytecode);
+
+    std::cout << "\tsuperinstructions: " << fused.milliseconds << " ms (result " << fused.result << "), "
+              << fused.instructions << " instructions, " << stack.milliseconds / fused.milliseconds
+              << "x the stack vm, " << static_cast<double>(fused.instructions) / stack.instructions
+              << " of its instructions\n\t\tpicked:";
+    for (const code::Opcode op : selected)
+    {
+        std::cout << " " << code::definitions[op].name;
+    }
+    std::cout << std::endl;
+}
+
+ast::Program *parse(const std::string &name, const std::string &script)
+{
+    Parser parser(new lexer::Lexer(script));
+    ast::Program *program = parser.parseProgram();
+    if (!parser.getErrors().empty())
+    {
+        std::cout << name << ": parse error " << parser.getErrors()[0] << std::endl;
+        return nullptr;
+    }
+
+    return program;
+}
+
+// Runs the script with the evaluator and with both machines, then with superinstructions, and reports their times
+void benchmarkScript(const std::string &name, const std::string &script)
+{
+    ast::Program *program = parse(name, script);
+    if (!program)
+    {
+        return;
+    }
+
+    const Measurement evaluator = measureEvaluator(program);
+    const code::Bytecode bytecode = compiler::compile(*program);
+    const code::RegisterBytecode registerBytecode = compiler::compileToRegisters(*program);
+
+    const Measurement stack = measureMachine<vm::VM>(bytecode);
+    report(name, evaluator, stack, measureMachine<vm::RegisterVM>(registerBytecode));
+    reportSuperinstructions(program, stack);
+}
+
+// Runs every input of evaluator_test.cpp and reports the totals, they are too short to time one by one
+void benchmarkTestPrograms()
+{
+    const std::vector<std::string> inputs{
+        "5", "10", "-5", "-15", "5 + 5 + 5 + 5 - 10", "2 * 2 * 2 * 2 * 2", "-50 + 100 + -50", "5 * 2 + 10",
+        "5 + 2 * 10", "20 + 2 * -10", "50 / 2 * 2 + 10", "2 * (5 + 10)", "3 * 3 * 3 + 10", "3 * (3 * 3) + 10",
+        "(5 + 10 * 2 + 15 / 3) * 2 + -10",
+
+        "vertet", "falso", "1 < 2", "1 > 2", "1 < 1", "1 > 1", "1 == 1", "1 != 1", "1 == 2", "1 != 2",
+        "vertet == vertet", "falso == falso", "vertet == falso", "vertet != falso", "falso != vertet",
+        "(1 < 2) == vertet", "(1 < 2) == falso", "(1 > 2) == vertet", "(1 > 2) == falso",
+
+        "!vertet", "!falso", "!5", "!!vertet", "!!falso", "!!5",
+
+        "nese (vertet) { 10 }", "nese  (falso) { 10 }", "nese (1) { 10 }", "nese (1 < 2) { 10 }",
+        "nese (1 > 2) { 10 }", "nese (1 > 2) { 10 } perndryshe { 20 }", "nese (1 < 2) { 10 } perndryshe { 20 }",
+
+        "kthen 10;", "kthen 10; 9;", "kthen 2 * 5; 9;", "9; kthen 2 * 5; 9;",
+        "nese (10 > 1) { nese (10 > 1) {kthen 10;} kthen 1;}",
+
+        "var a = 5; a;", "var a = 5 * 5; a;", "var a = 5; var b = a; b;", "var a = 5; var b = a; var c = a + b + 5; c;",
+
+        "funksion(x) { x + 2; };",
+
+        "var identity = funksion(x) { x; }; identity(5);", "var identity = funksion(x) { kthen x; }; identity(5);",
+        "var double = funksion(x) { x * 2; }; double(5);", "var add = funksion(x, y) { x + y; }; add(5, 5);",
+        "var add = funksion(x, y) { x + y; }; add(5 + 5, add(5, 5));", "funksion(x) { x; }(5)",
+
+        "var newAdder = funksion(x) { funksion(y) { x + y; } }; var addTwo = newAdder(2); addTwo(2);",
+    };
+
+    Measurement evaluator, stack, registers;
+    evaluator.milliseconds = stack.milliseconds = registers.milliseconds = 0;
+    for (const std::string &input : inputs)
+    {
+        ast::Program *program = parse(input, input);
+        if (!program)
+        {
+            continue;
+        }
+
+        const code::Bytecode bytecode = compiler::compile(*program);
+        const code::RegisterBytecode registerBytecode = compiler::compileToRegisters(*program);
+
+        const Measurement evaluated = measureEvaluator(program);
+        const Measurement ran = measureMachine<vm::VM>(bytecode);
+        const Measurement ranOnRegisters = measureMachine<vm::RegisterVM>(registerBytecode);
+
+        evaluator.milliseconds += evaluated.milliseconds;
+        stack.milliseconds += ran.milliseconds;
+        stack.instructions += ran.instructions;
+        registers.milliseconds += ranOnRegisters.milliseconds;
+        registers.instructions += ranOnRegisters.instructions;
+    }
+
+    evaluator.result = stack.result = registers.result = std::to_string(inputs.size()) + " programs";
+    report("evaluator tests", evaluator, stack, registers);
+}
+
+int main()
+{
+    // Build with -DEAGLECL_SWITCH_DISPATCH to compare with the switch
+    std::cout << "dispatch: " << vm::DISPATCH_MODE << std::endl;
+
+    benchmarkTestPrograms();
+
+    benchmarkScript("fib(30)", R"(
+var fib = funksion(n) {
+    nese (n < 2) { kthen n; }
+    kthen fib(n - 1) + fib(n - 2);
+};
+fib(30);
+)");
+
+    // Many locals and parameters, a closure made on every call
+    benchmarkScript("variable heavy recursion", R"(
+var hapi = 3;
+var llogarit = funksion(a, b, c, d) {
+    var x = a + b;
+    var y = c * d;
+    var z = x - y + hapi;
+    var ndihmes = funksion(p) { p + x + y + z + hapi; };
+    nese (a < 1) { kthen ndihmes(z); }
+    kthen llogarit(a - 1, b + 1, c, d) + llogarit(a - 1, b, c + 1, d) - ndihmes(x);
+};
+llogarit(15, 1, 2, 3);
+)");
+
+    // Variables of six enclosing calls and a global read at every step of a recursion
+    benchmarkScript("deeply nested closures", R"(
+var hapi = 1;
+var niveli = funksion(a) { funksion(b) { funksion(c) { funksion(d) { funksion(e) { funksion(f) {
+    var ecje = funksion(n) {
+        nese (n < 2) { kthen a + b + c + d + e + f + hapi; }
+        ecje(n - 1) + ecje(n - 2) - a - b - c - d - e - f - hapi
+    };
+    ecje(22)
+} } } } } };
+niveli(1)(2)(3)(4)(5)(6);
+)");
+
+    // Long arithmetic on locals and constants in every call, what three address code is best at
+    benchmarkScript("arithmetic heavy recursion", R"(
+var polinom = funksion(x, n) {
+    nese (n < 1) { kthen 0; }
+    var y = x * x * 3 + x * 2 - 7;
+    var z = (y - x * 5) / 2 + y * y - (x + 1) * (x - 1);
+    z - y + polinom(x + 1, n - 1) - polinom(x - 1, n - 1)
+};
+polinom(3, 16);
+)");
+
+    return 0;
+}
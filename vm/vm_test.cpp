@@ -0,0 +1,323 @@
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "evaluator.hpp"
+#include "environment.hpp"
+#include "compiler.hpp"
+#include "register_compiler.hpp"
+#include "superinstructions.hpp"
+#include "vm.hpp"
+#include "register_vm.hpp"
+
+ast::Program *parse(const std::string &input)
+{
+    Parser parser(new lexer::Lexer(input));
+    ast::Program *program = parser.parseProgram();
+    assert(parser.getErrors().empty() && "input has parse errors");
+
+    return program;
+}
+
+// Results are compared printed, a program without a value prints as nothing
+std::string inspect(const object::Object *result)
+{
+    return result ? result->inspect() : "nothing";
+}
+
+std::string evaluateToString(const std::string &input)
+{
+    return inspect(evaluator::evaluate(parse(input), new object::Environment()));
+}
+
+std::string runToString(const std::string &input)
+{
+    ast::Program *program = parse(input);
+    const code::Bytecode bytecode = compiler::compile(*program);
+    delete program;
+
+    vm::VM machine;
+    return inspect(machine.run(bytecode));
+}
+
+std::string runOnRegistersToString(const std::string &input)
+{
+    ast::Program *program = parse(input);
+    const code::RegisterBytecode bytecode = compiler::compileToRegisters(*program);
+    delete program;
+
+    vm::RegisterVM machine;
+    return inspect(machine.run(bytecode));
+}
+
+// Every superinstruction, so each gets used wherever its sequence occurs
+std::vector<code::Opcode> allSuperinstructions()
+{
+    std::vector<code::Opcode> all;
+    for (const code::Superinstruction &superinstruction : code::superinstructions)
+    {
+        all.push_back(superinstruction.op);
+    }
+
+    return all;
+}
+
+std::string runFusedToString(const std::string &input)
+{
+    ast::Program *program = parse(input);
+    code::Bytecode bytecode = compiler::compile(*program);
+    delete program;
+    compiler::fuseSuperinstructions(bytecode, allSuperinstructions());
+
+    vm::VM machine;
+    return inspect(machine.run(bytecode));
+}
+
+// Runs the input on both machines, the stack machine with and without superinstructions, and checks that each
+// gives the expected result
+void assertBothMachines(const std::string &input, const std::string &expected)
+{
+    for (const std::string &got : {runToString(input), runOnRegistersToString(input), runFusedToString(input)})
+    {
+        if (got != expected)
+        {
+            std::cout << "\n\texpected: " << expected << "\n\tgot:      " << got << std::endl;
+        }
+        assert(got == expected && "program runs to a different result");
+    }
+}
+
+// Every input of evaluator_test.cpp, the machine has to give the same result for each
+void testSameResultsAsEvaluator()
+{
+    const std::vector<std::string> inputs{
+        "5", "10", "-5", "-15", "5 + 5 + 5 + 5 - 10", "2 * 2 * 2 * 2 * 2", "-50 + 100 + -50", "5 * 2 + 10",
+        "5 + 2 * 10", "20 + 2 * -10", "50 / 2 * 2 + 10", "2 * (5 + 10)", "3 * 3 * 3 + 10", "3 * (3 * 3) + 10",
+        "(5 + 10 * 2 + 15 / 3) * 2 + -10",
+
+        "vertet", "falso", "1 < 2", "1 > 2", "1 < 1", "1 > 1", "1 == 1", "1 != 1", "1 == 2", "1 != 2",
+        "vertet == vertet", "falso == falso", "vertet == falso", "vertet != falso", "falso != vertet",
+        "(1 < 2) == vertet", "(1 < 2) == falso", "(1 > 2) == vertet", "(1 > 2) == falso",
+
+        "!vertet", "!falso", "!5", "!!vertet", "!!falso", "!!5",
+
+        "nese (vertet) { 10 }", "nese  (falso) { 10 }", "nese (1) { 10 }", "nese (1 < 2) { 10 }",
+        "nese (1 > 2) { 10 }", "nese (1 > 2) { 10 } perndryshe { 20 }", "nese (1 < 2) { 10 } perndryshe { 20 }",
+
+        "kthen 10;", "kthen 10; 9;", "kthen 2 * 5; 9;", "9; kthen 2 * 5; 9;",
+        "nese (10 > 1) { nese (10 > 1) {kthen 10;} kthen 1;}",
+
+        "var a = 5; a;", "var a = 5 * 5; a;", "var a = 5; var b = a; b;", "var a = 5; var b = a; var c = a + b + 5; c;",
+
+        "funksion(x) { x + 2; };",
+
+        "var identity = funksion(x) { x; }; identity(5);", "var identity = funksion(x) { kthen x; }; identity(5);",
+        "var double = funksion(x) { x * 2; }; double(5);", "var add = funksion(x, y) { x + y; }; add(5, 5);",
+        "var add = funksion(x, y) { x + y; }; add(5 + 5, add(5, 5));", "funksion(x) { x; }(5)",
+
+        "var newAdder = funksion(x) { funksion(y) { x + y; } }; var addTwo = newAdder(2); addTwo(2);",
+
+        "5 + vertet", "5 + vertet; 5;", "-vertet", "vertet + falso", "5; vertet + falso; 5",
+        "nese (10 > 1) {vertet + falso}", "nese (10 > 1) { nese (10 > 1) {kthen vertet + falso;} kthen 1;}",
+        "foobar;",
+    };
+
+    std::cout << "-------------[VM Evaluator Equivalence Test]------------\n";
+    for (const std::string &input : inputs)
+    {
+        std::cout << "TEST: " << input;
+
+        assertBothMachines(input, evaluateToString(input));
+
+        std::cout << " ✓\n";
+    }
+
+    std::cout << "VM EVALUATOR EQUIVALENCE TESTS PASSED!" << std::endl;
+}
+
+void testPrograms()
+{
+    struct VMTestCase
+    {
+        std::string input;
+        std::string expected; // inspect of the result
+    };
+
+    std::vector<VMTestCase> tests{
+        // Bindings keep their first value, like set in the evaluator's environments
+        {"var a = 1; var a = 2; a", "1"},
+        {"var f = funksion(x) { var x = 2; x }; f(1)", "1"},
+        {"funksion(a, a) { a }(1, 2)", "1"},
+        {"funksion(a, b, a) { a * 10 + b }(1, 2, 3)", "12"},
+
+        // Statements without a value
+        {"var a = 5;", "nothing"},
+        {"", "nothing"},
+        {"var f = funksion() { var a = 1; }; f()", "nothing"},
+        {"var f = funksion() { }; f()", "nothing"},
+        {"nese (vertet) { }", "nothing"},
+        {"!funksion() { }()", "true"},
+        {"nese (funksion() { }()) { 1 } perndryshe { 2 }", "1"},
+
+        // Vars in blocks belong to the whole call, reading one before it is bound looks further out
+        {"var f = funksion(x) { var y = x * 2; nese (y > 4) { var z = y + 1; } z }; f(3)", "7"},
+        {"var y = 5; var f = funksion() { nese (falso) { var y = 1; } y }; f()", "5"},
+        {"var f = funksion(y) { funksion() { nese (falso) { var y = 1; } y } }; f(8)()", "8"},
+        {"var f = funksion(y) { var g = funksion() { y + 1 }; nese (falso) { var y = 1; } g() }; f(8)", "9"},
+        {"var f = funksion() { var y = z; y }; f()", "GABIM: identifikuesi nuk gjindet: z"},
+
+        // Closures see the scope they were made in, bindings made after them included
+        {"var f = funksion() { funksion() { later } }; var later = 7; f()()", "7"},
+        {"var f = funksion() { var g = funksion() { x }; var x = 5; g() }; f()", "5"},
+        {"var make = funksion(a) { funksion(b) { funksion(c) { a + b + c } } }; make(1)(20)(300)", "321"},
+        {"var a = funksion(x) { var y = x + 1; funksion(z) { var w = y * z; funksion() { w + x + y + z } } };"
+         "a(1)(2)()",
+         "9"},
+        {"var twice = funksion(f) { funksion(x) { f(f(x)) } }; twice(funksion(x) { x * 3 })(2)", "18"},
+
+        // Calls and returns
+        {"var fib = funksion(n) { nese (n < 2) { kthen n; } fib(n - 1) + fib(n - 2) }; fib(15)", "610"},
+        {"var f = funksion(n) { nese (n > 0) { kthen 1; } 0 }; f(1) + f(0) * 10", "1"},
+        {"var f = funksion(x) { x }; f(1, 2, 3)", "1"},
+        {"var f = funksion(x) { kthen x; 5 }; f(3) + 1", "4"},
+
+        // Errors stop the program wherever they happen
+        {"var f = funksion(x) { x + vertet }; f(1) * 2", "GABIM: mospërputhje i tipit: INTEGJER + BOOLEAN"},
+        {"var f = funksion() { -falso }; f(); 5", "GABIM: operator i panjohur: - BOOLEAN"},
+        {"5(1)", "GABIM: nuk eshte funksion identifikuesi: INTEGJER"},
+        {"vertet < falso", "GABIM: operator i panjohur: BOOLEAN < BOOLEAN"},
+        {"var f = funksion() { 1 }; f == f", "GABIM: operator i panjohur: FUNKSION == FUNKSION"},
+        {"var f = funksion(n) { f(n + 1) }; f(0)", "GABIM: " + std::string(vm::STACK_OVERFLOW)},
+
+        // Binary operators of the register machine read slots in place, unbound ones are looked up all the same
+        {"var b = 10; var f = funksion(a, b) { a * b }; f(3)", "30"},
+        {"var f = funksion(a, q) { a + q }; f(1)", "GABIM: identifikuesi nuk gjindet: q"},
+        {"var f = funksion(a) { var a = 4; a + a }; f()", "8"},
+        {"var x = 2; var f = funksion() { x + nese (vertet) { var x = 5; 0 } }; f()", "2"},
+        {"var f = funksion() { nese (vertet) { var y = 5; 0 } + y }; f()", "5"},
+        {"var f = funksion(n) { n - 1 + 100000 }; f(5)", "100004"},
+        {"var f = funksion(a, b) { var c = (a + b) * (a - b); c / (b - a) }; f(7, 3)", "-10"},
+
+        // Superinstructions fail like their sequences do
+        {"var f = funksion(n) { nese (n < 2) { 1 } perndryshe { 2 } }; f(vertet)",
+         "GABIM: mospërputhje i tipit: BOOLEAN < INTEGJER"},
+        {"var f = funksion(n) { n - 1 }; f(falso)", "GABIM: mospërputhje i tipit: BOOLEAN - INTEGJER"},
+        {"var f = funksion(a, b) { a + b }; f(1)", "GABIM: identifikuesi nuk gjindet: b"},
+        {"var f = funksion(a) { funksion(b) { b - a } }; f(vertet)(1)",
+         "GABIM: mospërputhje i tipit: INTEGJER - BOOLEAN"},
+        {"var f = funksion(a) { funksion(b) { b + a } }; f(2)(3) * 2", "10"},
+        {"var f = funksion(x, c) { x + nese (c) { 1 } perndryshe { 2 } }; f(10, vertet) * 100 + f(10, falso)",
+         "1112"},
+    };
+
+    std::cout << "-------------[VM Program Test]------------\n";
+    for (const auto &test : tests)
+    {
+        std::cout << "TEST: " << test.input;
+
+        assertBothMachines(test.input, test.expected);
+
+        std::cout << " ✓\n";
+    }
+
+    std::cout << "VM PROGRAM TESTS PASSED!" << std::endl;
+}
+
+void testGlobalsAcrossRuns()
+{
+    std::cout << "-------------[VM Globals Test]------------\n";
+
+    // Programs run one after another on the same machine, like the lines of the REPL
+    std::vector<code::Bytecode> programs;
+    vm::VM machine;
+    for (const char *line : {"var base = 10;", "var add = funksion(x) { x + base };", "var base = 1;"})
+    {
+        programs.push_back(compiler::compile(*parse(line)));
+        assert(machine.run(programs.back()) == nullptr);
+    }
+
+    programs.push_back(compiler::compile(*parse("add(5)")));
+    object::Object *result = machine.run(programs.back());
+    assert(result && result->inspect() == "15" && "globals of earlier runs are visible");
+
+    std::vector<code::RegisterBytecode> registerPrograms;
+    vm::RegisterVM registerMachine;
+    for (const char *line : {"var base = 10;", "var add = funksion(x) { x + base };", "var base = 1;"})
+    {
+        registerPrograms.push_back(compiler::compileToRegisters(*parse(line)));
+        assert(registerMachine.run(registerPrograms.back()) == nullptr);
+    }
+
+    registerPrograms.push_back(compiler::compileToRegisters(*parse("add(5)")));
+    result = registerMachine.run(registerPrograms.back());
+    assert(result && result->inspect() == "15" && "globals of earlier runs are visible on the register machine");
+
+    std::cout << "VM GLOBALS TESTS PASSED!" << std::endl;
+}
+
+void testInstructionCounts()
+{
+    std::cout << "-------------[VM Instruction Count Test]------------\n";
+
+    const std::string input = "var f = funksion(x, y) { x * y + 1 }; f(2, 3)";
+
+    const code::Bytecode bytecode = compiler::compile(*parse(input));
+    vm::VM machine;
+    machine.run(bytecode);
+    assert(machine.getInstructionCount() == 0 && "runs don't count unless asked to");
+
+    // CLOSURE SET_GLOBAL GET_GLOBAL CONSTANT CONSTANT CALL, GET_LOCAL GET_LOCAL MULTIPLY CONSTANT ADD RETURN_VALUE,
+    // RETURN_VALUE
+    machine.setCountingInstructions(true);
+    assert(inspect(machine.run(bytecode)) == "7" && machine.getInstructionCount() == 13);
+
+    // CLOSURE SET_GLOBAL GET_GLOBAL LOAD_CONSTANT LOAD_CONSTANT CALL, MULTIPLY ADD RETURN, RETURN
+    const code::RegisterBytecode registerBytecode = compiler::compileToRegisters(*parse(input));
+    vm::RegisterVM registerMachine;
+    registerMachine.setCountingInstructions(true);
+    assert(inspect(registerMachine.run(registerBytecode)) == "7" && registerMachine.getInstructionCount() == 10);
+
+    std::cout << "VM INSTRUCTION COUNT TESTS PASSED!" << std::endl;
+}
+
+void testProfiledSuperinstructions()
+{
+    std::cout << "-------------[VM Superinstruction Test]------------\n";
+
+    const std::string input =
+        "var fib = funksion(n) { nese (n < 2) { kthen n; } fib(n - 1) + fib(n - 2) }; fib(10)";
+
+    // A training run records the opcode pairs, the hottest sequences become superinstructions
+    code::Bytecode bytecode = compiler::compile(*parse(input));
+    code::Profile profile;
+    vm::VM machine;
+    machine.setProfile(&profile);
+    assert(inspect(machine.run(bytecode)) == "55");
+    const uint64_t unfused = machine.getInstructionCount();
+    assert(profile.pairs[code::LESS][code::JUMP_IF_FALSE] == 177 && "fib(n) runs n < 2 177 times for n = 10");
+
+    const std::vector<code::Opcode> selected = compiler::selectSuperinstructions(profile, 3);
+    assert(selected.size() == 3);
+    compiler::fuseSuperinstructions(bytecode, selected);
+
+    // fib(n - 1) and fib(n - 2) both fuse, as does the n < 2 test
+    machine.setProfile(nullptr);
+    machine.setCountingInstructions(true);
+    assert(inspect(machine.run(bytecode)) == "55");
+    assert(machine.getInstructionCount() < unfused * 3 / 4 && "superinstructions save dispatches");
+
+    std::cout << "VM SUPERINSTRUCTION TESTS PASSED!" << std::endl;
+}
+
+int main()
+{
+    testSameResultsAsEvaluator();
+    testPrograms();
+    testGlobalsAcrossRuns();
+    testInstructionCounts();
+    testProfiledSuperinstructions();
+
+    return 0;
+}